@@ -0,0 +1,495 @@
+/**
+ * @file dirlist.c
+ *
+ * Directory listing. Entries are read in large blocks (getdents64
+ * when available) directly to an arena and sorted by name prefix
+ * keys. Only directories store their full path, other entries store
+ * the name, i.e. the caller decides how paths are stored. Recursive
+ * listing reads subdirectories in parallel, but the output order is
+ * still deterministic: each directory is followed by its content and
+ * entries are in ascending order.
+ *
+ */
+
+
+#include "config.h"
+
+#ifdef HAVE_GETDENTS64
+# define _GNU_SOURCE
+#else
+# define _DEFAULT_SOURCE
+#endif
+
+#include "mc.h"
+#include "global.h"
+#include "mcp.h"
+#include "mca.h"
+#include "worker.h"
+#include "dirlist.h"
+
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+
+#include <stdint.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_PTHREAD
+# include <pthread.h>
+#endif
+
+
+/** Directory entry for sorting. */
+typedef struct dirlist_key_s {
+  uint64_t key;          /**< Name prefix (big endian), i.e. primary sort key. */
+  char* path;            /**< Entry path (directory) or name. */
+  char* name;            /**< Name (after common prefix). */
+  bool_t dir;            /**< Entry is directory. */
+} dirlist_key_t;
+
+
+/** Listed directory type. */
+typedef struct dirlist_dir_s dirlist_dir_t;
+
+
+/** Listed entry. */
+typedef struct dirlist_entry_s {
+  char* name;            /**< Entry name. */
+  dirlist_dir_t* sub;    /**< Subdirectory content (or NULL). */
+} dirlist_entry_t;
+
+
+/** Listed directory. */
+struct dirlist_dir_s {
+  char* path;                  /**< Directory path. */
+  dirlist_entry_t* entries;    /**< Sorted entries. */
+  mc_size_t count;             /**< Entry count. */
+};
+
+
+/** Listing state shared by workers. */
+typedef struct dirlist_s {
+  bool_t recursive;            /**< List subdirectories. */
+  mcp_p queue;                 /**< Directories waiting to be read. */
+  int active;                  /**< Number of workers reading a directory. */
+  mca_p paths[ WORKER_MAX ];   /**< Path storage per worker. */
+  mca_p meta[ WORKER_MAX ];    /**< Directory structure storage per worker. */
+#ifdef HAVE_PTHREAD
+  pthread_mutex_t lock;        /**< Lock for queue and active. */
+  pthread_cond_t cond;         /**< Signal for queue and active change. */
+#endif
+} dirlist_t;
+
+
+/** Directory reading state. */
+typedef struct dirlist_scan_s {
+  dirlist_t* dl;               /**< Listing. */
+  int worker;                  /**< Worker index. */
+  int fd;                      /**< Directory file descriptor. */
+  dirlist_dir_t* dir;          /**< Directory. */
+  mc_size_t dirlen;            /**< Directory path length. */
+  dirlist_key_t* keys;         /**< Entries found so far. */
+  mc_size_t count;             /**< Entry count. */
+  mc_size_t size;              /**< Entry allocation size. */
+} dirlist_scan_t;
+
+
+/**
+ * Return sort key for name, i.e. 8 first chars as big endian number,
+ * which compares the same way as strcmp does.
+ *
+ * @param name Entry name.
+ *
+ * @return Key.
+ */
+static inline uint64_t dirlist_prefix_key( const char* name )
+{
+  uint64_t key = 0;
+
+  for ( int i = 0; i < 8 && name[ i ]; i++ )
+    key |= (uint64_t) (unsigned char) name[ i ] << ( 56 - 8 * i );
+
+  return key;
+}
+
+
+/**
+ * qsort callback for entries. Names are compared with strcmp only
+ * if prefix keys are same.
+ */
+static int dirlist_key_cmp( const void* a, const void* b )
+{
+  const dirlist_key_t* ka = a;
+  const dirlist_key_t* kb = b;
+
+  if ( ka->key < kb->key )
+    return -1;
+  else if ( ka->key > kb->key )
+    return 1;
+  else
+    return strcmp( ka->name, kb->name );
+}
+
+
+/**
+ * Add entry to directory (unless "." or "..").
+ *
+ * @param scan Directory reading state.
+ * @param name Entry name.
+ * @param type Entry type (dirent d_type).
+ */
+static void dirlist_add_entry( dirlist_scan_t* scan, const char* name, int type )
+{
+  dirlist_key_t* k;
+  mc_size_t namelen;
+  struct stat st;
+
+  /* Skip pwd and upper dir. */
+  if ( name[0] == '.' &&
+       ( name[1] == 0 || ( name[1] == '.' && name[2] == 0 ) ) )
+    return;
+
+  if ( scan->count >= scan->size )
+    {
+      scan->size = scan->size ? scan->size * 2 : 256;
+      scan->keys = mc_realloc( scan->keys, scan->size * sizeof( dirlist_key_t ) );
+    }
+
+  k = &scan->keys[ scan->count++ ];
+
+  k->dir = mc_false;
+  if ( scan->dl->recursive )
+    {
+      if ( type == DT_DIR )
+        k->dir = mc_true;
+      else if ( type == DT_UNKNOWN )
+        /* File system does not report types. Symbolic links are not
+           followed. */
+        k->dir = ( fstatat( scan->fd, name, &st, AT_SYMLINK_NOFOLLOW ) == 0 &&
+                   S_ISDIR( st.st_mode ) );
+    }
+
+  /* Directory path is needed for reading the directory. */
+  namelen = strlen( name );
+  if ( k->dir )
+    {
+      k->path = mca_alloc( scan->dl->paths[ scan->worker ],
+                           scan->dirlen + 1 + namelen + 1 );
+      mc_memcpy( scan->dir->path, k->path, scan->dirlen );
+      k->path[ scan->dirlen ] = '/';
+      k->name = k->path + scan->dirlen + 1;
+    }
+  else
+    {
+      k->path = mca_alloc( scan->dl->paths[ scan->worker ], namelen + 1 );
+      k->name = k->path;
+    }
+  mc_memcpy( name, k->name, namelen + 1 );
+}
+
+
+/**
+ * Read directory entries in sorted order. Found subdirectories are
+ * added to subdirs (in recursive mode).
+ *
+ * @param dl Listing.
+ * @param dir Directory.
+ * @param worker Worker index.
+ * @param subdirs Found subdirectories.
+ */
+static void dirlist_read_dir( dirlist_t* dl, dirlist_dir_t* dir, int worker, mcp_p subdirs )
+{
+  dirlist_scan_t scan;
+  mca_p meta;
+
+  if ( !dl->paths[ worker ] )
+    {
+      dl->paths[ worker ] = mca_new();
+      dl->meta[ worker ] = mca_new();
+    }
+  meta = dl->meta[ worker ];
+
+  scan.dl = dl;
+  scan.worker = worker;
+  scan.dir = dir;
+  scan.dirlen = strlen( dir->path );
+  scan.keys = NULL;
+  scan.count = 0;
+  scan.size = 0;
+
+  scan.fd = open( dir->path, O_RDONLY | O_DIRECTORY );
+
+  if ( scan.fd < 0 )
+    /* Can't read, directory is listed as empty. */
+    return;
+
+#ifdef HAVE_GETDENTS64
+
+  char buf[ DIRLIST_READ_SIZE ];
+  ssize_t len;
+  struct dirent64* entry;
+
+  while ( ( len = getdents64( scan.fd, buf, DIRLIST_READ_SIZE ) ) > 0 )
+    {
+      for ( ssize_t pos = 0; pos < len; pos += entry->d_reclen )
+        {
+          entry = (struct dirent64*) ( buf + pos );
+          dirlist_add_entry( &scan, entry->d_name, entry->d_type );
+        }
+    }
+
+  close( scan.fd );
+
+# else
+
+  DIR* dh;
+  struct dirent* entry;
+
+  dh = fdopendir( scan.fd );
+  if ( !dh )
+    {
+      close( scan.fd );
+      return;
+    }
+
+  while ( ( entry = readdir( dh ) ) != NULL )
+    {
+# ifdef _DIRENT_HAVE_D_TYPE
+      dirlist_add_entry( &scan, entry->d_name, entry->d_type );
+# else
+      dirlist_add_entry( &scan, entry->d_name, DT_UNKNOWN );
+# endif
+    }
+
+  /* Closes also the descriptor. */
+  closedir( dh );
+
+#endif
+
+  /* Keys are taken after the common prefix of names, since names
+     often share prefix. */
+  mc_size_t common = 0;
+  if ( scan.count > 0 )
+    {
+      char* first = scan.keys[ 0 ].name;
+      common = strlen( first );
+      for ( mc_size_t i = 1; i < scan.count && common > 0; i++ )
+        {
+          mc_size_t j = 0;
+          while ( j < common && scan.keys[ i ].name[ j ] == first[ j ] )
+            j++;
+          common = j;
+        }
+    }
+
+  for ( mc_size_t i = 0; i < scan.count; i++ )
+    {
+      scan.keys[ i ].name += common;
+      scan.keys[ i ].key = dirlist_prefix_key( scan.keys[ i ].name );
+    }
+
+  /* Sort entries into alphabetical order. */
+  qsort( scan.keys, scan.count, sizeof( dirlist_key_t ), dirlist_key_cmp );
+
+  dir->count = scan.count;
+  dir->entries = mca_alloc( meta, scan.count * sizeof( dirlist_entry_t ) + 1 );
+
+  for ( mc_size_t i = 0; i < scan.count; i++ )
+    {
+      if ( scan.keys[ i ].dir )
+        dir->entries[ i ].name = scan.keys[ i ].path + scan.dirlen + 1;
+      else
+        dir->entries[ i ].name = scan.keys[ i ].path;
+      dir->entries[ i ].sub = NULL;
+
+      if ( scan.keys[ i ].dir )
+        {
+          dirlist_dir_t* sub;
+
+          sub = mca_alloc( meta, sizeof( dirlist_dir_t ) );
+          sub->path = scan.keys[ i ].path;
+          sub->entries = NULL;
+          sub->count = 0;
+
+          dir->entries[ i ].sub = sub;
+          mcp_append( subdirs, sub );
+        }
+    }
+
+  mc_free( scan.keys );
+}
+
+
+/**
+ * Worker for reading directories from listing queue until all
+ * directories are read.
+ *
+ * @param context Listing.
+ * @param worker Worker index.
+ * @param task Task index (not used).
+ */
+static void dirlist_worker( void* context, int worker, int task )
+{
+  dirlist_t* dl = context;
+  dirlist_dir_t* dir;
+  mcp_p subdirs;
+
+  subdirs = mcp_new_size( 16 );
+
+  mc_loop
+    {
+#ifdef HAVE_PTHREAD
+      pthread_mutex_lock( &dl->lock );
+
+      /* Active workers might still find more directories. */
+      while ( dl->queue->used == 0 && dl->active > 0 )
+        pthread_cond_wait( &dl->cond, &dl->lock );
+#endif
+
+      if ( dl->queue->used == 0 )
+        {
+#ifdef HAVE_PTHREAD
+          pthread_mutex_unlock( &dl->lock );
+#endif
+          break;
+        }
+
+      dir = mcp_pop( dl->queue );
+      dl->active++;
+
+#ifdef HAVE_PTHREAD
+      pthread_mutex_unlock( &dl->lock );
+#endif
+
+      mcp_reset( subdirs );
+      dirlist_read_dir( dl, dir, worker, subdirs );
+
+#ifdef HAVE_PTHREAD
+      pthread_mutex_lock( &dl->lock );
+#endif
+
+      for ( mc_size_t i = 0; i < subdirs->used; i++ )
+        mcp_push( dl->queue, mcp_nth( subdirs, i ) );
+      dl->active--;
+
+#ifdef HAVE_PTHREAD
+      pthread_cond_broadcast( &dl->cond );
+      pthread_mutex_unlock( &dl->lock );
+#endif
+    }
+
+  mcp_del( subdirs );
+}
+
+
+/**
+ * Return number of entries in directory (including subdirectory
+ * content).
+ *
+ * @param dir Directory.
+ *
+ * @return Entry count.
+ */
+static mc_size_t dirlist_count( dirlist_dir_t* dir )
+{
+  mc_size_t cnt = dir->count;
+
+  for ( mc_size_t i = 0; i < dir->count; i++ )
+    {
+      if ( dir->entries[ i ].sub )
+        cnt += dirlist_count( dir->entries[ i ].sub );
+    }
+
+  return cnt;
+}
+
+
+/**
+ * Pass directory entries to callback, subdirectory content after the
+ * subdirectory.
+ *
+ * @param dir Directory.
+ * @param add Callback.
+ * @param context Callback context.
+ */
+static void dirlist_output( dirlist_dir_t* dir, dirlist_add_func_t add, void* context )
+{
+  mc_size_t dirlen = strlen( dir->path );
+
+  for ( mc_size_t i = 0; i < dir->count; i++ )
+    {
+      add( context, dir->path, dirlen, dir->entries[ i ].name );
+      if ( dir->entries[ i ].sub )
+        dirlist_output( dir->entries[ i ].sub, add, context );
+    }
+}
+
+
+/**
+ * List directory entries in ascending order as "dirname/entry". "."
+ * and ".." are not used. In recursive mode subdirectory content
+ * follows the subdirectory entry. Symbolic links are not followed.
+ * Entries are passed as directory path and name, which are freed
+ * after listing, i.e. the callback stores the path.
+ *
+ * @param dirname Directory name for listing.
+ * @param recursive List subdirectories recursively.
+ * @param count Callback for entry count (or NULL).
+ * @param add Callback for each entry path.
+ * @param context Callback context.
+ */
+void dirlist_list( const char* dirname, bool_t recursive, dirlist_count_func_t count, dirlist_add_func_t add, void* context ) /*acfd*/
+{
+  dirlist_t dl;
+  dirlist_dir_t root;
+  int workers;
+
+  root.path = (char*) dirname;
+  root.entries = NULL;
+  root.count = 0;
+
+  dl.recursive = recursive;
+  dl.queue = mcp_new_size( 64 );
+  dl.active = 0;
+  for ( int i = 0; i < WORKER_MAX; i++ )
+    {
+      dl.paths[ i ] = NULL;
+      dl.meta[ i ] = NULL;
+    }
+
+  mcp_push( dl.queue, &root );
+
+  /* Directory reading is mostly waiting, hence workers are not
+     limited by CPU count. */
+  workers = recursive ? DIRLIST_WORKERS : 1;
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_init( &dl.lock, NULL );
+  pthread_cond_init( &dl.cond, NULL );
+#endif
+
+  worker_run( workers, workers, dirlist_worker, &dl );
+
+#ifdef HAVE_PTHREAD
+  pthread_cond_destroy( &dl.cond );
+  pthread_mutex_destroy( &dl.lock );
+#endif
+
+  if ( count )
+    count( context, dirlist_count( &root ) );
+
+  dirlist_output( &root, add, context );
+
+  for ( int i = 0; i < WORKER_MAX; i++ )
+    {
+      if ( dl.paths[ i ] )
+        {
+          mca_del( dl.paths[ i ] );
+          mca_del( dl.meta[ i ] );
+        }
+    }
+
+  mcp_del( dl.queue );
+}
@@ -0,0 +1,45 @@
+#ifndef DIRLIST_H
+#define DIRLIST_H
+
+/**
+ * @file dirlist.h
+ *
+ * Directory listing defs.
+ */
+
+
+#include "mca.h"
+
+
+/** Number of parallel workers for recursive listing (IO bound). */
+#define DIRLIST_WORKERS 8
+
+/** Buffer size for reading directory entries. */
+#define DIRLIST_READ_SIZE (64*1024)
+
+
+/**
+ * Callback for listed entries. Entry path is "dir/name".
+ *
+ * @param context User context.
+ * @param dir Directory path (valid during listing).
+ * @param dirlen Directory path length.
+ * @param name Entry name (valid during listing).
+ */
+typedef void (*dirlist_add_func_t)( void* context, const char* dir, mc_size_t dirlen, const char* name );
+
+
+/**
+ * Callback for entry count, which is called before paths are passed.
+ *
+ * @param context User context.
+ * @param count Number of listed paths.
+ */
+typedef void (*dirlist_count_func_t)( void* context, mc_size_t count );
+
+
+/* autoc:c_func_decl:begin */
+void dirlist_list( const char* dirname, bool_t recursive, dirlist_count_func_t count, dirlist_add_func_t add, void* context );
+/* autoc:c_func_decl:end */
+
+#endif
@@ -0,0 +1,401 @@
+/**
+ * @file field.c
+ *
+ * Line field index. Lines are split to fields by delimiter once, when
+ * lines are added, and field operations (command escapes, field
+ * matching and sorting) use the stored field offsets. SPACE as
+ * delimiter means runs of SPACE and TAB chars (as awk), and leading
+ * whitespace is skipped. Other delimiters separate each field, i.e.
+ * fields may be empty (as cut).
+ *
+ */
+
+
+#include "mc.h"
+#include "global.h"
+#include "field.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+/** Field sort item. */
+typedef struct field_item_s {
+  double num;            /**< Numeric value (if numeric). */
+  const char* str;       /**< Field text (NULL if line has no field). */
+  mc_size_t len;         /**< Field length. */
+  mc_size_t idx;         /**< Line index. */
+  bool_t numeric;        /**< Field is number. */
+} field_item_t;
+
+
+/**
+ * Return true if char is delimiter.
+ *
+ * @param delim Delimiter.
+ * @param c Char.
+ */
+static inline bool_t field_is_delim( char delim, char c )
+{
+  if ( delim == ' ' )
+    return ( c == ' ' || c == '\t' );
+  else
+    return ( c == delim );
+}
+
+
+/**
+ * Create empty field index.
+ *
+ * @param delim Delimiter (SPACE for whitespace runs).
+ *
+ * @return Field index.
+ */
+field_index_t* field_index_new( char delim ) /*acfd*/
+{
+  field_index_t* fi;
+
+  fi = mc_new( field_index_t );
+  fi->delim = delim;
+  fi->lines = 0;
+  fi->line_size = FIELD_INIT_LINES;
+  fi->first = mc_new_n( mc_size_t, fi->line_size + 1 );
+  fi->first[ 0 ] = 0;
+  fi->used = 0;
+  fi->size = FIELD_INIT_LINES * 4;
+  fi->starts = mc_new_n( uint32_t, fi->size );
+
+  return fi;
+}
+
+
+/**
+ * Free field index.
+ *
+ * @param fi Field index.
+ */
+void field_index_del( field_index_t* fi ) /*acfd*/
+{
+  mc_free( fi->first );
+  mc_free( fi->starts );
+  mc_free( fi );
+}
+
+
+/**
+ * Add field start to index.
+ *
+ * @param fi Field index.
+ * @param start Field start offset.
+ */
+static inline void field_index_add( field_index_t* fi, mc_size_t start )
+{
+  if ( fi->used == fi->size )
+    {
+      fi->size *= 2;
+      fi->starts = mc_realloc( fi->starts, fi->size * sizeof( uint32_t ) );
+    }
+
+  fi->starts[ fi->used++ ] = (uint32_t) start;
+}
+
+
+/**
+ * Index fields of lines that are not indexed yet, i.e. lines from
+ * previous update upto n.
+ *
+ * @param fi Field index.
+ * @param texts Line texts.
+ * @param n Line count.
+ */
+void field_index_update( field_index_t* fi, char** texts, mc_size_t n ) /*acfd*/
+{
+  const char* text;
+  const char* c;
+  int cnt;
+
+  if ( n <= fi->lines )
+    return;
+
+  if ( n > fi->line_size )
+    {
+      while ( n > fi->line_size )
+        fi->line_size *= 2;
+      fi->first = mc_realloc( fi->first, ( fi->line_size + 1 ) * sizeof( mc_size_t ) );
+    }
+
+  for ( mc_size_t i = fi->lines; i < n; i++ )
+    {
+      text = texts[ i ];
+      c = text;
+      cnt = 0;
+
+      if ( fi->delim == ' ' )
+        {
+          for ( ;; )
+            {
+              while ( *c == ' ' || *c == '\t' )
+                c++;
+              if ( !*c || cnt == FIELD_MAX || c - text > UINT32_MAX )
+                break;
+
+              field_index_add( fi, c - text );
+              cnt++;
+
+              while ( *c && *c != ' ' && *c != '\t' )
+                c++;
+            }
+        }
+      else
+        {
+          for ( ;; )
+            {
+              if ( cnt == FIELD_MAX || c - text > UINT32_MAX )
+                break;
+
+              field_index_add( fi, c - text );
+              cnt++;
+
+              c = strchr( c, fi->delim );
+              if ( !c )
+                break;
+              c++;
+            }
+        }
+
+      fi->first[ i + 1 ] = fi->used;
+    }
+
+  fi->lines = n;
+}
+
+
+/**
+ * Return field of line.
+ *
+ * @param [in] fi Field index.
+ * @param [in] text Line text.
+ * @param [in] line Line index.
+ * @param [in] field Field number (from 1).
+ * @param [out] len Field length.
+ *
+ * @return Field start (or NULL if line has no such field).
+ */
+const char* field_get( const field_index_t* fi, const char* text,
+                       mc_size_t line, int field, mc_size_t* len ) /*acfd*/
+{
+  mc_size_t i;
+  const char* start;
+  const char* end;
+
+  if ( field < 1 || line >= fi->lines )
+    return NULL;
+
+  i = fi->first[ line ] + field - 1;
+  if ( i >= fi->first[ line + 1 ] )
+    return NULL;
+
+  start = text + fi->starts[ i ];
+  for ( end = start; *end && !field_is_delim( fi->delim, *end ); end++ )
+    ;
+
+  *len = end - start;
+
+  return start;
+}
+
+
+/**
+ * Convert field to number. Number may have a size suffix (K, M, G,
+ * T, P with optional "i" and "B", or plain "B") with binary
+ * multipliers, as in "ls -lh" and "du -h" output.
+ *
+ * @param [in] str Field text.
+ * @param [in] len Field length.
+ * @param [out] value Numeric value.
+ *
+ * @return True if field is number.
+ */
+bool_t field_number( const char* str, mc_size_t len, double* value ) /*acfd*/
+{
+  const char* c = str;
+  const char* end = str + len;
+  const char* units = "KMGTP";
+  const char* unit;
+  double num = 0.0;
+  double frac = 0.1;
+  bool_t neg = mc_false;
+  bool_t digits = mc_false;
+
+  if ( c < end && ( *c == '-' || *c == '+' ) )
+    neg = ( *c++ == '-' );
+
+  for ( ; c < end && *c >= '0' && *c <= '9'; c++ )
+    {
+      num = num * 10.0 + ( *c - '0' );
+      digits = mc_true;
+    }
+
+  if ( c < end && *c == '.' )
+    {
+      for ( c++; c < end && *c >= '0' && *c <= '9'; c++ )
+        {
+          num += frac * ( *c - '0' );
+          frac *= 0.1;
+          digits = mc_true;
+        }
+    }
+
+  if ( !digits )
+    return mc_false;
+
+  if ( c < end && ( unit = strchr( units, ( *c == 'k' ) ? 'K' : *c ) ) && *unit )
+    {
+      for ( const char* u = units; u <= unit; u++ )
+        num *= 1024.0;
+      c++;
+      if ( c < end && *c == 'i' )
+        c++;
+    }
+
+  if ( c < end && *c == 'B' )
+    c++;
+
+  if ( c != end )
+    return mc_false;
+
+  *value = neg ? -num : num;
+
+  return mc_true;
+}
+
+
+/**
+ * Reorder index lines, i.e. index line i becomes old line order[i].
+ *
+ * @param fi Field index (with n lines).
+ * @param order New order of lines.
+ * @param n Line count.
+ */
+void field_index_permute( field_index_t* fi, const mc_size_t* order, mc_size_t n ) /*acfd*/
+{
+  mc_size_t* first;
+  uint32_t* starts;
+  mc_size_t used = 0;
+  mc_size_t cnt;
+
+  first = mc_new_n( mc_size_t, fi->line_size + 1 );
+  starts = mc_new_n( uint32_t, fi->size );
+
+  first[ 0 ] = 0;
+  for ( mc_size_t i = 0; i < n; i++ )
+    {
+      cnt = fi->first[ order[ i ] + 1 ] - fi->first[ order[ i ] ];
+      mc_memcpy( &fi->starts[ fi->first[ order[ i ] ] ], &starts[ used ],
+                 cnt * sizeof( uint32_t ) );
+      used += cnt;
+      first[ i + 1 ] = used;
+    }
+
+  mc_free( fi->first );
+  mc_free( fi->starts );
+  fi->first = first;
+  fi->starts = starts;
+}
+
+
+/**
+ * Compare field sort items. Numbers are before text, and lines
+ * without the field are last, also in descending order. Equal items
+ * remain in line order (stable sort).
+ *
+ * @param a First item.
+ * @param b Second item.
+ * @param dir Sort direction (1 or -1).
+ *
+ * @return Less than, equal or greater than zero.
+ */
+static inline int field_item_cmp( const field_item_t* a, const field_item_t* b, int dir )
+{
+  int ret;
+
+  if ( !a->str || !b->str )
+    ret = ( !a->str ) - ( !b->str );
+  else if ( a->numeric != b->numeric )
+    ret = a->numeric ? -1 : 1;
+  else if ( a->numeric )
+    ret = dir * ( ( a->num > b->num ) - ( a->num < b->num ) );
+  else
+    {
+      ret = memcmp( a->str, b->str, ( a->len < b->len ) ? a->len : b->len );
+      if ( !ret )
+        ret = ( a->len > b->len ) - ( a->len < b->len );
+      ret *= dir;
+    }
+
+  if ( ret )
+    return ret;
+
+  return ( a->idx > b->idx ) - ( a->idx < b->idx );
+}
+
+
+/**
+ * Compare items for ascending sort.
+ *
+ * @param a First item.
+ * @param b Second item.
+ */
+static int field_item_asc( const void* a, const void* b )
+{
+  return field_item_cmp( a, b, 1 );
+}
+
+
+/**
+ * Compare items for descending sort.
+ *
+ * @param a First item.
+ * @param b Second item.
+ */
+static int field_item_desc( const void* a, const void* b )
+{
+  return field_item_cmp( a, b, -1 );
+}
+
+
+/**
+ * Sort lines by field. Numeric fields are compared by value (see
+ * field_number) and other fields in byte order. Sort is stable.
+ *
+ * @param [in] fi Field index (with n lines).
+ * @param [in] texts Line texts.
+ * @param [in] n Line count.
+ * @param [in] field Sort field (from 1).
+ * @param [in] reverse Descending order.
+ * @param [out] order Sorted order of lines (n items).
+ */
+void field_sort( const field_index_t* fi, char** texts, mc_size_t n,
+                 int field, bool_t reverse, mc_size_t* order ) /*acfd*/
+{
+  field_item_t* items;
+
+  items = mc_new_n( field_item_t, n );
+
+  for ( mc_size_t i = 0; i < n; i++ )
+    {
+      items[ i ].idx = i;
+      items[ i ].str = field_get( fi, texts[ i ], i, field, &items[ i ].len );
+      items[ i ].numeric = ( items[ i ].str
+                             && field_number( items[ i ].str, items[ i ].len,
+                                              &items[ i ].num ) );
+    }
+
+  qsort( items, n, sizeof( field_item_t ),
+         reverse ? field_item_desc : field_item_asc );
+
+  for ( mc_size_t i = 0; i < n; i++ )
+    order[ i ] = items[ i ].idx;
+
+  mc_free( items );
+}
@@ -0,0 +1,51 @@
+#ifndef FIELD_H
+#define FIELD_H
+
+/**
+ * @file field.h
+ *
+ * Line field index defs.
+ */
+
+
+#include "mc.h"
+#include "global.h"
+
+#include <stdint.h>
+
+
+/** Max number of indexed fields per line (rest are not available). */
+#define FIELD_MAX 64
+
+/** Initial line count of index. */
+#define FIELD_INIT_LINES 1024
+
+
+/**
+ * Field index for lines. Field start offsets of all lines are stored
+ * to one array and each line refers to its first field, i.e. lines
+ * are tokenized only once. Field end is found from field start.
+ */
+typedef struct field_index_s {
+  char delim;            /**< Delimiter (SPACE for whitespace runs). */
+  mc_size_t lines;       /**< Indexed line count. */
+  mc_size_t line_size;   /**< Line storage size. */
+  mc_size_t* first;      /**< First field of each line (lines + 1). */
+  uint32_t* starts;      /**< Field start offsets (within line). */
+  mc_size_t used;        /**< Field count. */
+  mc_size_t size;        /**< Field storage size. */
+} field_index_t;
+
+
+
+/* autoc:c_func_decl:begin */
+field_index_t* field_index_new( char delim );
+void field_index_del( field_index_t* fi );
+void field_index_update( field_index_t* fi, char** texts, mc_size_t n );
+const char* field_get( const field_index_t* fi, const char* text, mc_size_t line, int field, mc_size_t* len );
+bool_t field_number( const char* str, mc_size_t len, double* value );
+void field_index_permute( field_index_t* fi, const mc_size_t* order, mc_size_t n );
+void field_sort( const field_index_t* fi, char** texts, mc_size_t n, int field, bool_t reverse, mc_size_t* order );
+/* autoc:c_func_decl:end */
+
+#endif
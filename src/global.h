@@ -65,14 +65,11 @@ typedef unsigned char uchar;
 
 
 /**
- * How to control debugging:
- *
- * Change:
- *   from: if 0
- *   to:   if 1
- * to enable debugging.
+ * Debug output (to debug.txt) is enabled with: configure
+ * --enable-debug (ENABLE_DEBUG). Runtime statistics are always
+ * available (see stats.h).
  */
-#if 0
+#ifdef ENABLE_DEBUG
 #  define ml_do_debug 1
 #  define dbug(args...) (ml_dbug_print(args))
 #else
@@ -0,0 +1,545 @@
+/**
+ * @file jobs.c
+ *
+ * Pool of command jobs. Commands are executed with shell and upto
+ * "max" commands are running at the same time. When several jobs run
+ * in parallel, job output is captured and written as a whole when the
+ * job is finished, i.e. outputs of jobs do not interleave. Stdout and
+ * stderr are captured separately and written to stdout and stderr.
+ *
+ * Commands that include only plain words, i.e. no chars that the
+ * shell would interpret, are executed directly without the shell.
+ *
+ */
+
+
+#include "config.h"
+
+#ifdef HAVE_VFORK
+# define _DEFAULT_SOURCE
+#endif
+
+#include "mc.h"
+#include "global.h"
+#include "mcc.h"
+#include "mcs.h"
+#include "mcp.h"
+#include "stats.h"
+#include "jobs.h"
+
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <ctype.h>
+
+
+/** Read size for captured output. */
+#define JOBS_READ_SIZE (64*1024)
+
+
+/** Shell reserved words, i.e. command words that require shell. */
+static const char* jobs_reserved_words[] = {
+  "case", "do", "done", "elif", "else", "esac", "fi", "for",
+  "function", "if", "in", "select", "then", "time", "until", "while",
+  NULL
+};
+
+
+/**
+ * Create job pool.
+ *
+ * @param max Maximum number of running jobs.
+ *
+ * @return Job pool.
+ */
+jobs_t* jobs_new( int max ) /*acfd*/
+{
+  jobs_t* jobs;
+
+  if ( max < 1 )
+    max = 1;
+  if ( max > JOBS_MAX )
+    max = JOBS_MAX;
+
+  jobs = mc_new( jobs_t );
+  jobs->max = max;
+  jobs->running = 0;
+  jobs->capture = ( max > 1 );
+  jobs->started = 0;
+  jobs->failed = 0;
+  jobs->direct = 0;
+  jobs->argbuf = mcc_new_size( 1024 );
+  jobs->argv = mcp_new_size( 16 );
+
+  jobs->slots = mc_new_n( job_t, max );
+  for ( int i = 0; i < max; i++ )
+    {
+      jobs->slots[ i ].pid = 0;
+      jobs->slots[ i ].out = -1;
+      jobs->slots[ i ].err = -1;
+      jobs->slots[ i ].buf = NULL;
+      jobs->slots[ i ].errbuf = NULL;
+    }
+
+  return jobs;
+}
+
+
+/**
+ * Free job pool. Running jobs are waited first.
+ *
+ * @param jobs Job pool.
+ */
+void jobs_del( jobs_t* jobs ) /*acfd*/
+{
+  jobs_wait_all( jobs );
+
+  for ( int i = 0; i < jobs->max; i++ )
+    {
+      if ( jobs->slots[ i ].buf )
+        mcc_del( jobs->slots[ i ].buf );
+      if ( jobs->slots[ i ].errbuf )
+        mcc_del( jobs->slots[ i ].errbuf );
+    }
+
+  mcc_del( jobs->argbuf );
+  mcp_del( jobs->argv );
+  mc_free( jobs->slots );
+  mc_free( jobs );
+}
+
+
+/**
+ * Complete job, i.e. output captured content (error output to
+ * stderr), record status and free the slot.
+ *
+ * @param jobs Job pool.
+ * @param job Job slot.
+ */
+static void jobs_finish( jobs_t* jobs, job_t* job )
+{
+  if ( job->buf && job->buf->used > 0 )
+    {
+      fwrite( mcc_to_str( job->buf ), 1, job->buf->used, stdout );
+      fflush( stdout );
+      mcc_reset( job->buf );
+    }
+
+  if ( job->errbuf && job->errbuf->used > 0 )
+    {
+      fwrite( mcc_to_str( job->errbuf ), 1, job->errbuf->used, stderr );
+      fflush( stderr );
+      mcc_reset( job->errbuf );
+    }
+
+  if ( !WIFEXITED( job->status ) || WEXITSTATUS( job->status ) != 0 )
+    jobs->failed++;
+
+  job->pid = 0;
+  jobs->running--;
+}
+
+
+/**
+ * Wait for child termination (the slot of child has to exist). Reaped
+ * children without slot (e.g. children inherited across exec) are
+ * skipped.
+ *
+ * @param jobs Job pool.
+ * @param pid Child to wait (-1 for any child).
+ *
+ * @return Slot of terminated child (or NULL if there are no children).
+ */
+static job_t* jobs_wait_child( jobs_t* jobs, pid_t pid )
+{
+  int status;
+  pid_t done;
+
+  for ( ;; )
+    {
+      if ( ( done = waitpid( pid, &status, 0 ) ) == -1 )
+        {
+          if ( errno == EINTR )
+            continue;
+          return NULL;
+        }
+
+      for ( int i = 0; i < jobs->max; i++ )
+        {
+          if ( jobs->slots[ i ].pid == done )
+            {
+              jobs->slots[ i ].status = status;
+              jobs->slots[ i ].exited = mc_true;
+              return &jobs->slots[ i ];
+            }
+        }
+    }
+}
+
+
+/**
+ * Forget all running jobs, since they can not be waited (no
+ * children).
+ *
+ * @param jobs Job pool.
+ */
+static void jobs_forget( jobs_t* jobs )
+{
+  for ( int i = 0; i < jobs->max; i++ )
+    {
+      if ( jobs->slots[ i ].pid )
+        {
+          if ( jobs->slots[ i ].out >= 0 )
+            {
+              close( jobs->slots[ i ].out );
+              jobs->slots[ i ].out = -1;
+            }
+          if ( jobs->slots[ i ].err >= 0 )
+            {
+              close( jobs->slots[ i ].err );
+              jobs->slots[ i ].err = -1;
+            }
+          jobs->slots[ i ].status = 0;
+          jobs_finish( jobs, &jobs->slots[ i ] );
+        }
+    }
+}
+
+
+/**
+ * Wait until at least one running job is finished. Captured output is
+ * collected while waiting.
+ *
+ * @param jobs Job pool.
+ */
+static void jobs_reap( jobs_t* jobs )
+{
+  job_t* job;
+
+  if ( !jobs->capture )
+    {
+      /* Output is not captured, just wait for termination. */
+      if ( ( job = jobs_wait_child( jobs, -1 ) ) )
+        jobs_finish( jobs, job );
+      else
+        /* No children (ECHILD, should not happen), forget jobs. */
+        jobs_forget( jobs );
+      return;
+    }
+
+  struct pollfd fds[ 2 * JOBS_MAX ];
+  job_t* fd_job[ 2 * JOBS_MAX ];
+  int* fd_ref[ 2 * JOBS_MAX ];
+  mcc_p fd_buf;
+  char buf[ JOBS_READ_SIZE ];
+  int finished = 0;
+  int cnt;
+  ssize_t len;
+
+  while ( finished == 0 )
+    {
+      cnt = 0;
+      for ( int i = 0; i < jobs->max; i++ )
+        {
+          if ( !jobs->slots[ i ].pid )
+            continue;
+
+          if ( jobs->slots[ i ].out >= 0 )
+            {
+              fds[ cnt ].fd = jobs->slots[ i ].out;
+              fds[ cnt ].events = POLLIN;
+              fd_job[ cnt ] = &jobs->slots[ i ];
+              fd_ref[ cnt ] = &jobs->slots[ i ].out;
+              cnt++;
+            }
+
+          if ( jobs->slots[ i ].err >= 0 )
+            {
+              fds[ cnt ].fd = jobs->slots[ i ].err;
+              fds[ cnt ].events = POLLIN;
+              fd_job[ cnt ] = &jobs->slots[ i ];
+              fd_ref[ cnt ] = &jobs->slots[ i ].err;
+              cnt++;
+            }
+        }
+
+      if ( cnt == 0 || poll( fds, cnt, -1 ) < 0 )
+        {
+          if ( cnt > 0 && errno == EINTR )
+            continue;
+          /* Nothing to read, wait for termination. */
+          if ( ( job = jobs_wait_child( jobs, -1 ) ) )
+            jobs_finish( jobs, job );
+          else
+            jobs_forget( jobs );
+          return;
+        }
+
+      for ( int i = 0; i < cnt; i++ )
+        {
+          if ( fds[ i ].revents == 0 )
+            continue;
+
+          job = fd_job[ i ];
+          fd_buf = ( fd_ref[ i ] == &job->out ) ? job->buf : job->errbuf;
+          len = read( *fd_ref[ i ], buf, JOBS_READ_SIZE );
+
+          if ( len > 0 )
+            {
+              mcc_append_n( fd_buf, buf, len );
+            }
+          else if ( len == 0 || errno != EINTR )
+            {
+              close( *fd_ref[ i ] );
+              *fd_ref[ i ] = -1;
+
+              if ( job->out >= 0 || job->err >= 0 )
+                continue;
+
+              /* Output is done, i.e. child is terminating. */
+              if ( !job->exited )
+                jobs_wait_child( jobs, job->pid );
+              jobs_finish( jobs, job );
+              finished++;
+            }
+        }
+    }
+}
+
+
+/**
+ * Return true if char has no special meaning for shell.
+ *
+ * @param ch Char to test.
+ */
+static inline bool_t jobs_plain_char( char ch )
+{
+  return ( isalnum( (unsigned char) ch ) || strchr( "_-./,:+%@=", ch ) );
+}
+
+
+/**
+ * Split command to argument vector (jobs->argv) for direct
+ * execution. Split is possible only if command consists of plain
+ * words separated by blanks, since then shell would produce the
+ * same arguments.
+ *
+ * @param jobs Job pool.
+ * @param cmd Shell command.
+ *
+ * @return True if command was split.
+ */
+static bool_t jobs_split_plain( jobs_t* jobs, const char* cmd )
+{
+  bool_t blank = mc_true;
+  int words = 0;
+
+  mcc_reset( jobs->argbuf );
+  mcp_reset( jobs->argv );
+
+  for ( const char* c = cmd; *c; c++ )
+    {
+      if ( *c == ' ' || *c == '\t' )
+        {
+          if ( !blank )
+            mcc_append( jobs->argbuf, 0 );
+          blank = mc_true;
+        }
+      else if ( jobs_plain_char( *c ) )
+        {
+          if ( blank )
+            words++;
+          /* Variable assignment in front of command. */
+          if ( *c == '=' && words == 1 )
+            return mc_false;
+          mcc_append( jobs->argbuf, *c );
+          blank = mc_false;
+        }
+      else
+        {
+          return mc_false;
+        }
+    }
+
+  if ( words == 0 )
+    return mc_false;
+
+  if ( !blank )
+    mcc_append( jobs->argbuf, 0 );
+
+  for ( int i = 0; jobs_reserved_words[ i ]; i++ )
+    {
+      if ( !strcmp( jobs->argbuf->data, jobs_reserved_words[ i ] ) )
+        return mc_false;
+    }
+
+  /* Collect words after buffer is complete (i.e. not relocated). */
+  for ( mc_size_t i = 0; i < jobs->argbuf->used; i++ )
+    {
+      mcp_append( jobs->argv, &jobs->argbuf->data[ i ] );
+      i += strlen( &jobs->argbuf->data[ i ] );
+    }
+  mcp_append( jobs->argv, NULL );
+
+  return mc_true;
+}
+
+
+/**
+ * Start command as new job. If pool is full, wait until a running job
+ * is finished.
+ *
+ * @param jobs Job pool.
+ * @param cmd Shell command.
+ *
+ * @return True if job was started (errno is set on failure).
+ */
+bool_t jobs_start( jobs_t* jobs, const char* cmd ) /*acfd*/
+{
+  job_t* job = NULL;
+  int fds[ 2 ] = { -1, -1 };
+  int efds[ 2 ] = { -1, -1 };
+  pid_t child;
+  char** argv = NULL;
+  int64_t start;
+
+  if ( jobs->running >= jobs->max )
+    {
+      start = stats_now();
+      while ( jobs->running >= jobs->max )
+        jobs_reap( jobs );
+      stats_time_add( &stats.wait_time, NULL, start );
+    }
+
+  for ( int i = 0; i < jobs->max; i++ )
+    {
+      if ( jobs->slots[ i ].pid == 0 )
+        {
+          job = &jobs->slots[ i ];
+          break;
+        }
+    }
+
+  jobs->started++;
+
+  if ( jobs->capture )
+    {
+      if ( pipe( fds ) == -1 )
+        {
+          jobs->failed++;
+          return mc_false;
+        }
+
+      if ( pipe( efds ) == -1 )
+        {
+          int err = errno;
+          close( fds[ 0 ] );
+          close( fds[ 1 ] );
+          jobs->failed++;
+          errno = err;
+          return mc_false;
+        }
+
+      /* Later jobs should not inherit the read ends. */
+      fcntl( fds[ 0 ], F_SETFD, FD_CLOEXEC );
+      fcntl( efds[ 0 ], F_SETFD, FD_CLOEXEC );
+
+      if ( !job->buf )
+        job->buf = mcc_new_size( 1024 );
+      if ( !job->errbuf )
+        job->errbuf = mcc_new_size( 256 );
+    }
+
+  /* Prepare arguments before fork, since child may share memory. */
+  if ( jobs_split_plain( jobs, cmd ) )
+    {
+      argv = (char**) jobs->argv->data;
+      jobs->direct++;
+    }
+
+  start = stats_now();
+
+#ifdef HAVE_VFORK
+
+  /* When take includes a long list, a lot of memory is
+     allocated. vfork does not duplicate the memory allocation and
+     thus system (execl) calls start significantly faster. */
+  child = vfork();
+
+# else
+
+  child = fork();
+
+#endif
+
+  if ( child == 0 )
+    {
+      if ( fds[ 1 ] >= 0 )
+        {
+          dup2( fds[ 1 ], STDOUT_FILENO );
+          dup2( efds[ 1 ], STDERR_FILENO );
+          close( fds[ 0 ] );
+          close( fds[ 1 ] );
+          close( efds[ 0 ] );
+          close( efds[ 1 ] );
+        }
+      if ( argv )
+        /* Shell is used only if program is not found (e.g. builtin). */
+        execvp( argv[0], argv );
+      execl( "/bin/sh", "sh", "-c", cmd, (char*) 0 );
+      _exit( 127 );
+    }
+
+  if ( fds[ 1 ] >= 0 )
+    {
+      close( fds[ 1 ] );
+      close( efds[ 1 ] );
+    }
+
+  if ( child == -1 )
+    {
+      /* Failure. */
+      int err = errno;
+      if ( fds[ 0 ] >= 0 )
+        {
+          close( fds[ 0 ] );
+          close( efds[ 0 ] );
+        }
+      jobs->failed++;
+      errno = err;
+      return mc_false;
+    }
+
+  /* With vfork, parent continues after child exec. */
+  stats.execs++;
+  stats_time_add( &stats.exec_time, &stats.exec_time_max, start );
+
+  job->pid = child;
+  job->out = fds[ 0 ];
+  job->err = efds[ 0 ];
+  job->exited = mc_false;
+  jobs->running++;
+
+  return mc_true;
+}
+
+
+/**
+ * Wait until all running jobs are finished.
+ *
+ * @param jobs Job pool.
+ */
+void jobs_wait_all( jobs_t* jobs ) /*acfd*/
+{
+  int64_t start = stats_now();
+
+  while ( jobs->running > 0 )
+    jobs_reap( jobs );
+
+  stats_time_add( &stats.wait_time, NULL, start );
+}
@@ -0,0 +1,56 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+/**
+ * @file jobs.h
+ *
+ * Command job pool defs.
+ */
+
+
+#include "mcc.h"
+#include "mcp.h"
+
+#ifdef HAVE_SYS_TYPES_H
+# include <sys/types.h>
+#endif
+
+
+/** Maximum number of parallel jobs. */
+#define JOBS_MAX 256
+
+
+/** Job slot, i.e. running command. */
+typedef struct job_s {
+  pid_t pid;         /**< Child process (0 for free slot). */
+  int out;           /**< Child output pipe (-1 if not captured or closed). */
+  int err;           /**< Child error pipe (-1 if not captured or closed). */
+  bool_t exited;     /**< Child has been reaped. */
+  int status;        /**< Child exit status (waitpid status). */
+  mcc_p buf;         /**< Captured child output. */
+  mcc_p errbuf;      /**< Captured child error output. */
+} job_t;
+
+
+/** Pool of parallel jobs. */
+typedef struct jobs_s {
+  int max;           /**< Maximum number of running jobs. */
+  int running;       /**< Number of started but unfinished jobs. */
+  bool_t capture;    /**< Capture job output (used with parallel jobs). */
+  job_t* slots;      /**< Job slots (max). */
+  int64_t started;   /**< Number of started jobs. */
+  int64_t failed;    /**< Number of failed jobs. */
+  int64_t direct;    /**< Number of jobs executed without shell. */
+  mcc_p argbuf;      /**< Argument strings for direct execution. */
+  mcp_p argv;        /**< Argument vector for direct execution. */
+} jobs_t;
+
+
+/* autoc:c_func_decl:begin */
+jobs_t* jobs_new( int max );
+void jobs_del( jobs_t* jobs );
+bool_t jobs_start( jobs_t* jobs, const char* cmd );
+void jobs_wait_all( jobs_t* jobs );
+/* autoc:c_func_decl:end */
+
+#endif
@@ -0,0 +1,659 @@
+/**
+ * @file journal.c
+ *
+ * Undo journal for line marks. Each mark operation is stored as the
+ * set of lines whose mark it changed, i.e. memory usage is relative
+ * to the change and not to the list size. Toggle of a range (e.g. "T"
+ * or single line toggle) needs no data, and other operations are
+ * recorded by comparing the marks before and after the operation
+ * (see journal_begin() and journal_end()).
+ *
+ * The lines that become selected by the journaled operations are
+ * logged in order, i.e. selected items can be output in selection
+ * order (see journal_order()).
+ *
+ */
+
+
+#include "mc.h"
+#include "mcb.h"
+#include "mci.h"
+#include "mcp.h"
+#include "global.h"
+#include "journal.h"
+
+
+/**
+ * Return data size of record.
+ *
+ * @param rec Journal record.
+ *
+ * @return Byte count.
+ */
+static mc_size_t journal_rec_bytes( journal_rec_t* rec )
+{
+  mc_size_t bytes = sizeof( journal_rec_t );
+
+  if ( rec->diff )
+    bytes += mcb_words( rec->diff->used ) * mcb_sizeof;
+  if ( rec->lines )
+    bytes += mci_usedsize( rec->lines );
+
+  return bytes;
+}
+
+
+/**
+ * Free journal record.
+ *
+ * @param rec Journal record.
+ */
+static void journal_rec_del( journal_rec_t* rec )
+{
+  if ( rec->diff )
+    mcb_del( rec->diff );
+  if ( rec->lines )
+    mci_del( rec->lines );
+  mc_free( rec );
+}
+
+
+/**
+ * Append line to selection order log. Consecutive lines are stored
+ * as one run.
+ *
+ * @param j Journal.
+ * @param line Selected line.
+ */
+static inline void journal_log( journal_t* j, mc_size_t line )
+{
+  mci_p order = j->order;
+
+  if ( order->used > 0 && mci_nth( order, order->used - 1 ) == (int64_t) line )
+    {
+      /* Extend the last run. */
+      mci_nth( order, order->used - 1 ) = line + 1;
+    }
+  else
+    {
+      mci_append( order, line );
+      mci_append( order, line + 1 );
+    }
+}
+
+
+/**
+ * Rewrite selection order log with the current order, when the log
+ * has grown to twice the size after previous compaction. Hence the
+ * lines that are not selected anymore (or selected again later) don't
+ * accumulate in log.
+ *
+ * @param j Journal.
+ * @param marks Line marks.
+ */
+static void journal_log_compact( journal_t* j, mcb_p marks )
+{
+  mci_p order;
+
+  if ( j->order->used < JOURNAL_ORDER_MIN || j->order->used < 2 * j->compact )
+    return;
+
+  order = journal_order( j, marks );
+
+  mci_reset( j->order );
+  for ( mc_size_t i = 0; i < order->used; i++ )
+    journal_log( j, mci_nth( order, i ) );
+  j->compact = j->order->used;
+
+  mci_del( order );
+}
+
+
+/**
+ * Log the selected lines in range [begin,end) to selection order.
+ *
+ * @param j Journal.
+ * @param marks Line marks.
+ * @param begin Range start.
+ * @param end Range end (exclusive).
+ *
+ * @return Logged line count.
+ */
+static mc_size_t journal_log_range( journal_t* j, mcb_p marks,
+                                    mc_size_t begin, mc_size_t end )
+{
+  mc_size_t cnt = 0;
+
+  for ( mc_size_t i = mcb_next( marks, begin );
+        i != MCB_INVALID_INDEX && i < end;
+        i = mcb_next( marks, i+1 ) )
+    {
+      journal_log( j, i );
+      cnt++;
+    }
+
+  return cnt;
+}
+
+
+/**
+ * Log the changed lines of diff to selection order, if they are
+ * selected.
+ *
+ * @param j Journal.
+ * @param marks Line marks.
+ * @param diff Changed lines from offset.
+ * @param offset Line of diff bit 0.
+ *
+ * @return Logged line count.
+ */
+static mc_size_t journal_log_diff( journal_t* j, mcb_p marks,
+                                   mcb_p diff, mc_size_t offset )
+{
+  mc_size_t cnt = 0;
+
+  for ( mc_size_t i = mcb_next( diff, 0 );
+        i != MCB_INVALID_INDEX;
+        i = mcb_next( diff, i+1 ) )
+    {
+      if ( mcb_get( marks, offset + i ) )
+        {
+          journal_log( j, offset + i );
+          cnt++;
+        }
+    }
+
+  return cnt;
+}
+
+
+/**
+ * Apply record to marks, i.e. toggle the changed lines. The lines
+ * that become selected are logged to selection order.
+ *
+ * @param j Journal.
+ * @param rec Journal record.
+ * @param marks Line marks.
+ * @param selected Selected line count (updated).
+ */
+static void journal_rec_apply( journal_t* j, journal_rec_t* rec,
+                               mcb_p marks, int64_t* selected )
+{
+  mc_size_t changed, cnt;
+
+  if ( rec->diff )
+    {
+      mcb_xor_at( marks, rec->diff, rec->begin );
+      changed = mcb_count( rec->diff );
+      cnt = journal_log_diff( j, marks, rec->diff, rec->begin );
+    }
+  else if ( rec->lines )
+    {
+      changed = rec->lines->used;
+      cnt = 0;
+      for ( mc_size_t i = 0; i < rec->lines->used; i++ )
+        {
+          mcb_toggle( marks, mci_nth( rec->lines, i ) );
+          if ( mcb_get( marks, mci_nth( rec->lines, i ) ) )
+            {
+              journal_log( j, mci_nth( rec->lines, i ) );
+              cnt++;
+            }
+        }
+    }
+  else
+    {
+      mcb_toggle_range( marks, rec->begin, rec->end );
+      changed = rec->end - rec->begin;
+      cnt = journal_log_range( j, marks, rec->begin, rec->end );
+    }
+
+  /* Logged lines were selected and the rest were unselected. */
+  *selected += (int64_t) cnt - (int64_t) ( changed - cnt );
+
+  journal_log_compact( j, marks );
+}
+
+
+/**
+ * Add record as the latest done record. Undone records are dropped,
+ * since they can't be redone after a new operation. The oldest
+ * records are dropped when journal is full.
+ *
+ * @param j Journal.
+ * @param rec Journal record.
+ */
+static void journal_add( journal_t* j, journal_rec_t* rec )
+{
+  journal_rec_t* old;
+
+  while ( j->records->used > j->pos )
+    {
+      old = mcp_pop( j->records );
+      j->bytes -= journal_rec_bytes( old );
+      journal_rec_del( old );
+    }
+
+  mcp_append( j->records, rec );
+  j->bytes += journal_rec_bytes( rec );
+  j->pos++;
+
+  while ( j->pos > 1 && ( j->pos > JOURNAL_MAX_RECORDS ||
+                          j->bytes > JOURNAL_MAX_BYTES ) )
+    {
+      old = mcp_nth( j->records, 0 );
+      mcp_delete_at( j->records, 0 );
+      j->bytes -= journal_rec_bytes( old );
+      journal_rec_del( old );
+      j->pos--;
+    }
+}
+
+
+/**
+ * Create empty journal.
+ *
+ * @return Journal.
+ */
+journal_t* journal_new( void ) /*acfd*/
+{
+  journal_t* j;
+
+  j = mc_new( journal_t );
+  j->records = mcp_new();
+  j->pos = 0;
+  j->bytes = 0;
+  j->order = mci_new();
+  j->compact = 0;
+  j->before = NULL;
+  j->begin = 0;
+  j->end = 0;
+
+  return j;
+}
+
+
+/**
+ * Free journal.
+ *
+ * @param j Journal.
+ */
+void journal_del( journal_t* j ) /*acfd*/
+{
+  journal_clear( j );
+  mcp_del( j->records );
+  mci_del( j->order );
+  mc_free( j );
+}
+
+
+/**
+ * Remove all records and selection order log, e.g. when lines are
+ * reordered and the records refer to old line positions.
+ *
+ * @param j Journal.
+ */
+void journal_clear( journal_t* j ) /*acfd*/
+{
+  for ( mc_size_t i = 0; i < j->records->used; i++ )
+    journal_rec_del( mcp_nth( j->records, i ) );
+  mcp_reset( j->records );
+  j->pos = 0;
+  j->bytes = 0;
+  mci_reset( j->order );
+  j->compact = 0;
+
+  if ( j->before )
+    {
+      mcb_del( j->before );
+      j->before = NULL;
+    }
+}
+
+
+/**
+ * Move selection order log to new line positions, when lines are
+ * reordered. Records are removed, since they refer to old line
+ * positions.
+ *
+ * @param j Journal.
+ * @param marks Line marks (old positions).
+ * @param order Old position of each line (new position as index).
+ * @param n Line count.
+ */
+void journal_permute( journal_t* j, mcb_p marks, const mc_size_t* order, mc_size_t n ) /*acfd*/
+{
+  mci_p selected;
+  mc_size_t* where;
+
+  /* Current order only, i.e. log is compacted. */
+  selected = journal_order( j, marks );
+  journal_clear( j );
+
+  where = mc_new_n( mc_size_t, n );
+  for ( mc_size_t i = 0; i < n; i++ )
+    where[ order[ i ] ] = i;
+
+  for ( mc_size_t i = 0; i < selected->used; i++ )
+    journal_log( j, where[ mci_nth( selected, i ) ] );
+  j->compact = j->order->used;
+
+  mc_free( where );
+  mci_del( selected );
+}
+
+
+/**
+ * Record toggle of lines in range [begin,end), i.e. marks are
+ * toggled already.
+ *
+ * @param j Journal.
+ * @param marks Line marks.
+ * @param begin Range start.
+ * @param end Range end (exclusive).
+ *
+ * @return Count of lines that became selected.
+ */
+mc_size_t journal_toggle( journal_t* j, mcb_p marks, mc_size_t begin, mc_size_t end ) /*acfd*/
+{
+  journal_rec_t* rec;
+  mc_size_t cnt;
+
+  if ( begin >= end )
+    return 0;
+
+  rec = mc_new( journal_rec_t );
+  rec->begin = begin;
+  rec->end = end;
+  rec->diff = NULL;
+  rec->lines = NULL;
+  rec->rule = NULL;
+
+  journal_add( j, rec );
+
+  cnt = journal_log_range( j, marks, begin, end );
+  journal_log_compact( j, marks );
+
+  return cnt;
+}
+
+
+/**
+ * Start recording an operation for lines in range [begin,end), i.e.
+ * marks of range are saved for journal_end().
+ *
+ * @param j Journal.
+ * @param marks Line marks.
+ * @param begin Range start.
+ * @param end Range end (exclusive).
+ */
+void journal_begin( journal_t* j, mcb_p marks, mc_size_t begin, mc_size_t end ) /*acfd*/
+{
+  if ( j->before )
+    mcb_del( j->before );
+
+  j->begin = begin - ( begin % MCB_WORD_BITS );
+  j->end = end;
+  j->before = NULL;
+
+  if ( j->begin < j->end )
+    j->before = mcb_copy_at( marks, j->begin, j->end - j->begin );
+}
+
+
+/**
+ * Return the lines whose mark was changed by pending operation (see
+ * journal_begin()), i.e. pending operation is finished.
+ *
+ * @param j Journal.
+ * @param marks Line marks.
+ *
+ * @return Changed lines from range start (or NULL if none).
+ */
+static mcb_p journal_diff( journal_t* j, mcb_p marks )
+{
+  mcb_p diff = j->before;
+  mc_size_t wo = j->begin / MCB_WORD_BITS;
+  mc_size_t words;
+
+  if ( !diff )
+    return NULL;
+
+  j->before = NULL;
+
+  /* Before xor after is the change. */
+  words = mcb_words( diff->used );
+  for ( mc_size_t i = 0; i < words && wo + i < mcb_words( marks->used ); i++ )
+    diff->data[ i ] ^= marks->data[ wo + i ];
+  if ( diff->used % MCB_WORD_BITS )
+    {
+      /* Range end within word. */
+      diff->data[ words - 1 ] &=
+        ( (mcb_word_t) 1 << ( diff->used % MCB_WORD_BITS ) ) - 1;
+    }
+
+  if ( mcb_count( diff ) == 0 )
+    {
+      mcb_del( diff );
+      return NULL;
+    }
+
+  return diff;
+}
+
+
+/**
+ * Finish recording an operation (see journal_begin()). Marks are
+ * compared to the saved marks and the changed lines are recorded as
+ * index list, if it is smaller than the bitarr of range. Unchanged
+ * marks are not recorded, unless operation added arrival rule.
+ *
+ * @param j Journal.
+ * @param marks Line marks.
+ * @param rule Arrival rule added by operation (or NULL).
+ *
+ * @return Changed line count.
+ */
+mc_size_t journal_end_rule( journal_t* j, mcb_p marks, void* rule ) /*acfd*/
+{
+  journal_rec_t* rec;
+  mcb_p diff;
+  mc_size_t words, cnt;
+
+  diff = journal_diff( j, marks );
+  if ( !diff && !rule )
+    return 0;
+
+  rec = mc_new( journal_rec_t );
+  rec->begin = 0;
+  rec->end = 0;
+  rec->diff = NULL;
+  rec->lines = NULL;
+  rec->rule = rule;
+
+  if ( !diff )
+    {
+      /* Empty range, i.e. only the rule is recorded. */
+      journal_add( j, rec );
+      return 0;
+    }
+
+  cnt = mcb_count( diff );
+  words = mcb_words( diff->used );
+
+  journal_log_diff( j, marks, diff, j->begin );
+
+  rec->begin = j->begin;
+  rec->end = j->end;
+
+  if ( cnt * mci_sizeof < words * mcb_sizeof )
+    {
+      /* Sparse change. */
+      rec->lines = mci_new_size( cnt );
+      for ( mc_size_t i = mcb_next( diff, 0 );
+            i != MCB_INVALID_INDEX;
+            i = mcb_next( diff, i+1 ) )
+        {
+          mci_append( rec->lines, j->begin + i );
+        }
+      mcb_del( diff );
+    }
+  else
+    {
+      rec->diff = diff;
+    }
+
+  journal_add( j, rec );
+  journal_log_compact( j, marks );
+
+  return cnt;
+}
+
+
+/**
+ * Finish recording an operation (see journal_end_rule()).
+ *
+ * @param j Journal.
+ * @param marks Line marks.
+ *
+ * @return Changed line count.
+ */
+mc_size_t journal_end( journal_t* j, mcb_p marks ) /*acfd*/
+{
+  return journal_end_rule( j, marks, NULL );
+}
+
+
+/**
+ * Finish operation without journal record (see journal_begin()),
+ * i.e. the change can't be undone, but the lines that became selected
+ * are logged to selection order (e.g. lines marked on arrival).
+ *
+ * @param j Journal.
+ * @param marks Line marks.
+ *
+ * @return Count of lines that became selected.
+ */
+mc_size_t journal_end_log( journal_t* j, mcb_p marks ) /*acfd*/
+{
+  mcb_p diff;
+  mc_size_t cnt;
+
+  if ( !( diff = journal_diff( j, marks ) ) )
+    return 0;
+
+  cnt = journal_log_diff( j, marks, diff, j->begin );
+  mcb_del( diff );
+  journal_log_compact( j, marks );
+
+  return cnt;
+}
+
+
+/**
+ * Undo the latest done operation.
+ *
+ * @param j Journal.
+ * @param marks Line marks.
+ * @param [in,out] selected Selected line count.
+ * @param [out] rule Arrival rule added by operation (or NULL).
+ *
+ * @return False if nothing to undo.
+ */
+bool_t journal_undo( journal_t* j, mcb_p marks, int64_t* selected, void** rule ) /*acfd*/
+{
+  journal_rec_t* rec;
+
+  if ( j->pos == 0 )
+    return mc_false;
+
+  j->pos--;
+  rec = mcp_nth( j->records, j->pos );
+  journal_rec_apply( j, rec, marks, selected );
+  *rule = rec->rule;
+
+  return mc_true;
+}
+
+
+/**
+ * Redo the latest undone operation.
+ *
+ * @param j Journal.
+ * @param marks Line marks.
+ * @param [in,out] selected Selected line count.
+ * @param [out] rule Arrival rule added by operation (or NULL).
+ *
+ * @return False if nothing to redo.
+ */
+bool_t journal_redo( journal_t* j, mcb_p marks, int64_t* selected, void** rule ) /*acfd*/
+{
+  journal_rec_t* rec;
+
+  if ( j->pos >= j->records->used )
+    return mc_false;
+
+  j->pos++;
+  rec = mcp_nth( j->records, j->pos - 1 );
+  journal_rec_apply( j, rec, marks, selected );
+  *rule = rec->rule;
+
+  return mc_true;
+}
+
+
+/**
+ * Return selected lines in selection order. Line is placed to the
+ * position where it was selected last time. Selected lines that are
+ * not in the log (e.g. preselected lines) are first in line order.
+ *
+ * @param j Journal.
+ * @param marks Line marks.
+ *
+ * @return Selected lines (to be freed by caller).
+ */
+mci_p journal_order( journal_t* j, mcb_p marks ) /*acfd*/
+{
+  mci_p order;
+  mci_p latest;
+  mcb_p seen;
+  mc_size_t line, cnt;
+
+  seen = mcb_new_size( mcb_words( marks->used ) + 1 );
+  mcb_resize( seen, marks->used );
+  latest = mci_new();
+
+  /* Latest selection first, i.e. log is scanned backwards. */
+  for ( mc_size_t r = j->order->used; r >= 2; r -= 2 )
+    {
+      for ( line = mci_nth( j->order, r - 1 );
+            line > (mc_size_t) mci_nth( j->order, r - 2 ); )
+        {
+          line--;
+          if ( line < marks->used && mcb_get( marks, line ) && !mcb_get( seen, line ) )
+            {
+              mcb_set( seen, line );
+              mci_append( latest, line );
+            }
+        }
+    }
+
+  cnt = mcb_count( marks );
+  order = mci_new_size( cnt + 1 );
+
+  for ( mc_size_t i = mcb_next( marks, 0 );
+        i != MCB_INVALID_INDEX;
+        i = mcb_next( marks, i+1 ) )
+    {
+      if ( !mcb_get( seen, i ) )
+        mci_append( order, i );
+    }
+
+  for ( mc_size_t i = latest->used; i > 0; i-- )
+    mci_append( order, mci_nth( latest, i - 1 ) );
+
+  mci_del( latest );
+  mcb_del( seen );
+
+  return order;
+}
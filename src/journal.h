@@ -0,0 +1,83 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+/**
+ * @file journal.h
+ *
+ * Undo journal and selection order defs for line marks.
+ */
+
+
+#include "mc.h"
+#include "mcb.h"
+#include "mci.h"
+#include "mcp.h"
+#include "global.h"
+
+
+/** Maximum number of journal records (oldest are dropped). */
+#define JOURNAL_MAX_RECORDS 1024
+
+/** Maximum memory for journal record data (oldest are dropped). */
+#define JOURNAL_MAX_BYTES (64*1024*1024)
+
+/** Minimum selection order log length (entries) for compaction. */
+#define JOURNAL_ORDER_MIN (64*1024)
+
+
+/**
+ * Journal record, i.e. the lines whose mark was toggled by one
+ * operation. Since the change is stored as toggles, the same record
+ * both undoes and redoes the operation. Change is stored in the most
+ * compact form: range toggle without data, changed lines as index
+ * list (sparse change) or as bitarr of range (dense change). Record
+ * refers also to the arrival rule that the operation added (rule is
+ * not owned by journal).
+ */
+typedef struct journal_rec_s {
+  mc_size_t begin;   /**< Range start (word aligned for diff). */
+  mc_size_t end;     /**< Range end (exclusive). */
+  mcb_p diff;        /**< Changed lines from begin (or NULL). */
+  mci_p lines;       /**< Changed lines (or NULL). */
+  void* rule;        /**< Arrival rule added by operation (or NULL). */
+} journal_rec_t;
+
+
+/**
+ * Undo journal. Records before pos are done (undo candidates) and
+ * records from pos onwards are undone (redo candidates).
+ *
+ * Journal has also the selection order log, i.e. the lines that have
+ * become selected are appended as runs of lines (begin/end pairs).
+ * Lines that are not selected anymore are skipped from the order
+ * (see journal_order()).
+ */
+typedef struct journal_s {
+  mcp_p records;     /**< Journal records (oldest first). */
+  mc_size_t pos;     /**< Count of done records. */
+  mc_size_t bytes;   /**< Record data size. */
+  mci_p order;       /**< Selection order log (line runs). */
+  mc_size_t compact; /**< Order log length after compaction. */
+  mcb_p before;      /**< Marks before pending operation (or NULL). */
+  mc_size_t begin;   /**< Pending operation range start (word aligned). */
+  mc_size_t end;     /**< Pending operation range end (exclusive). */
+} journal_t;
+
+
+
+/* autoc:c_func_decl:begin */
+journal_t* journal_new( void );
+void journal_del( journal_t* j );
+void journal_clear( journal_t* j );
+void journal_permute( journal_t* j, mcb_p marks, const mc_size_t* order, mc_size_t n );
+mc_size_t journal_toggle( journal_t* j, mcb_p marks, mc_size_t begin, mc_size_t end );
+void journal_begin( journal_t* j, mcb_p marks, mc_size_t begin, mc_size_t end );
+mc_size_t journal_end_rule( journal_t* j, mcb_p marks, void* rule );
+mc_size_t journal_end( journal_t* j, mcb_p marks );
+mc_size_t journal_end_log( journal_t* j, mcb_p marks );
+bool_t journal_undo( journal_t* j, mcb_p marks, int64_t* selected, void** rule );
+bool_t journal_redo( journal_t* j, mcb_p marks, int64_t* selected, void** rule );
+mci_p journal_order( journal_t* j, mcb_p marks );
+/* autoc:c_func_decl:end */
+
+#endif
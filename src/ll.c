@@ -13,6 +13,9 @@
 const char* ll_version = "0.0.1";
 
 
+mca_pool_p ll_pool = NULL;
+
+
 
 /* ------------------------------------------------------------
  * Internal functions:
@@ -75,7 +78,10 @@ ll* ll_new( void* data )
 {
   ll* node;
 
-  node = mc_new( ll );
+  if ( ll_pool )
+    node = mca_pool_alloc( ll_pool );
+  else
+    node = mc_new( ll );
   node->prev = NULL;
   node->next = NULL;
   node->data = data;
@@ -85,14 +91,17 @@ ll* ll_new( void* data )
 
 void ll_rem( ll* node )
 {
-  mc_free( node );
+  if ( ll_pool )
+    mca_pool_free( ll_pool, node );
+  else
+    mc_free( node );
 }
 
 
 void ll_rem_with_data( ll* node )
 {
   mc_free( node->data );
-  mc_free( node );
+  ll_rem( node );
 }
 
 
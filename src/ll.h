@@ -39,9 +39,17 @@
  */
 
 
+#include "mca.h"
+
+
 /** ll-lib version. */
 extern const char* ll_version;
 
+/** Pool for nodes (NULL for individual heap allocations). Pool has
+    to be set before any nodes are created and it must outlive the
+    nodes. */
+extern mca_pool_p ll_pool;
+
 
 /**
  * Macro for list iteration.
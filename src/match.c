@@ -0,0 +1,1027 @@
+/**
+ * @file match.c
+ *
+ * Line matching with regex patterns. Patterns without regex special
+ * chars are matched as plain strings with the (vectorized) string
+ * search functions of libc, which is much faster than
+ * regexec(). Large line ranges are matched in parallel by workers.
+ *
+ * Field patterns match or compare one field of line, which is found
+ * through the field index. Lines in path tree (shared-prefix storage)
+ * are reconstructed to worker buffers for matching.
+ *
+ * Fuzzy matching is for live filtering, i.e. pattern chars have to
+ * be found from text in the same order, but there can be other chars
+ * in between.
+ *
+ */
+
+
+#include "config.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <regex.h>
+#include <signal.h>
+
+#include "mc.h"
+#include "global.h"
+#include "mcb.h"
+#include "mci.h"
+#include "worker.h"
+#include "stats.h"
+#include "field.h"
+#include "pathtree.h"
+#include "match.h"
+
+
+/** Regex special chars (ERE). */
+#define MATCH_SPECIAL ".[]()*+?{}|^$\\"
+
+
+/** Case folding table for plain string matching. */
+static uchar match_fold[ 256 ];
+
+/** Case folding table initialization status. */
+static bool_t match_fold_ready = mc_false;
+
+
+/** Parallel match state. */
+typedef struct match_job_s {
+  matcher_t* m;            /**< Matcher. */
+  regex_t** re;            /**< Regex for each worker. */
+  char** texts;            /**< Line texts. */
+  mc_size_t begin;         /**< Match range start. */
+  mc_size_t end;           /**< Match range end (exclusive). */
+  mc_size_t base;          /**< First chunk start (aligned). */
+  mcb_p* hits;             /**< Match bitarr for each chunk. */
+  mci_p* found;            /**< Matching lines for each chunk. */
+  worker_poll_func_t poll; /**< Poll function (NULL for foreground). */
+  void* poll_context;      /**< Poll function context. */
+  volatile sig_atomic_t cancel; /**< Job is cancelled (chunks quit early). */
+} match_job_t;
+
+
+/**
+ * Compile regex pattern.
+ *
+ * @param re Regex to compile.
+ * @param pattern Regex pattern.
+ * @param case_sensitive Case sensitivity option.
+ *
+ * @return True on success.
+ */
+static bool_t match_compile( regex_t* re, char* pattern, bool_t case_sensitive )
+{
+  int flags = REG_EXTENDED | REG_NOSUB;
+
+  if ( !case_sensitive )
+    flags |= REG_ICASE;
+
+  return ( regcomp( re, pattern, flags ) == 0 );
+}
+
+
+/**
+ * Convert pattern to plain string if it has no regex special chars,
+ * or they are all escaped with backslash.
+ *
+ * @param pattern Regex pattern.
+ *
+ * @return Plain string (or NULL if pattern is regex).
+ */
+static char* match_plain_string( char* pattern )
+{
+  char* str;
+  int si = 0;
+
+  str = mc_new_n( char, strlen( pattern ) + 1 );
+
+  for ( int pi = 0; pattern[ pi ]; pi++ )
+    {
+      if ( pattern[ pi ] == '\\' )
+        {
+          pi++;
+          if ( !pattern[ pi ] || !strchr( MATCH_SPECIAL, pattern[ pi ] ) )
+            {
+              /* Escape with special meaning (e.g. "\<"). */
+              mc_free( str );
+              return NULL;
+            }
+        }
+      else if ( strchr( MATCH_SPECIAL, pattern[ pi ] ) )
+        {
+          mc_free( str );
+          return NULL;
+        }
+
+      str[ si++ ] = pattern[ pi ];
+    }
+
+  str[ si ] = 0;
+
+  return str;
+}
+
+
+/**
+ * Setup plain string matching for Matcher.
+ *
+ * @param m Matcher object.
+ * @param str Plain string (owned by Matcher after call).
+ */
+static void match_setup_literal( matcher_t* m, char* str )
+{
+  m->literal = str;
+  m->len = strlen( str );
+
+  if ( m->case_sensitive )
+    return;
+
+  if ( !match_fold_ready )
+    {
+      for ( int i = 0; i < 256; i++ )
+        match_fold[ i ] = tolower( i );
+      match_fold_ready = mc_true;
+    }
+
+  for ( int i = 0; i < m->len; i++ )
+    str[ i ] = match_fold[ (uchar) str[ i ] ];
+
+  /* Candidates for first char with both cases. */
+  m->first[ 0 ] = str[ 0 ];
+  m->first[ 1 ] = toupper( (uchar) str[ 0 ] );
+  if ( m->first[ 1 ] == m->first[ 0 ] )
+    m->first[ 1 ] = 0;
+  m->first[ 2 ] = 0;
+}
+
+
+/**
+ * Match text with plain string. Case insensitive search finds the
+ * candidates by the first char (either case) and folds only the
+ * rest of the candidate.
+ *
+ * @param m Matcher object.
+ * @param text Text to match.
+ *
+ * @return True if text matches.
+ */
+static inline bool_t match_literal( matcher_t* m, const char* text )
+{
+  const char* p;
+  int i;
+
+  if ( m->len == 0 )
+    return mc_true;
+
+  if ( m->case_sensitive )
+    {
+      if ( m->len == 1 )
+        return ( strchr( text, m->literal[ 0 ] ) != NULL );
+      else
+        return ( strstr( text, m->literal ) != NULL );
+    }
+
+  p = text;
+
+  while ( ( p = strpbrk( p, m->first ) ) )
+    {
+      for ( i = 1;
+            i < m->len && match_fold[ (uchar) p[ i ] ] == (uchar) m->literal[ i ];
+            i++ )
+        ;
+
+      if ( i == m->len )
+        return mc_true;
+
+      p++;
+    }
+
+  return mc_false;
+}
+
+
+/**
+ * Match field of line with field matcher. Field is copied to buffer
+ * for pattern matching, since pattern may be anchored.
+ *
+ * @param m Field matcher.
+ * @param re Regex (NULL for plain string or comparison).
+ * @param text Line text.
+ * @param line Line index.
+ * @param buf Field buffer (reallocated as needed).
+ * @param size Field buffer size.
+ *
+ * @return True if field matches.
+ */
+static bool_t match_field( matcher_t* m, regex_t* re, const char* text,
+                           mc_size_t line, char** buf, mc_size_t* size )
+{
+  const char* str;
+  mc_size_t len;
+  double num;
+  int cmp;
+
+  str = field_get( m->fields, text, line, m->field, &len );
+  if ( !str )
+    return mc_false;
+
+  if ( m->op == match_op_match )
+    {
+      if ( len + 1 > *size )
+        {
+          *size = len + 64;
+          *buf = mc_realloc( *buf, *size );
+        }
+      mc_memcpy( str, *buf, len );
+      (*buf)[ len ] = 0;
+
+      if ( re )
+        return ( regexec( re, *buf, 0, NULL, 0 ) == 0 );
+      else
+        return match_literal( m, *buf );
+    }
+
+  if ( m->numeric && field_number( str, len, &num ) )
+    {
+      cmp = ( num > m->value ) - ( num < m->value );
+    }
+  else if ( m->op == match_op_eq || m->op == match_op_ne )
+    {
+      /* Text comparison (exact). */
+      cmp = ( len != (mc_size_t) m->len || memcmp( str, m->literal, len ) );
+    }
+  else
+    {
+      /* Not a number. */
+      return mc_false;
+    }
+
+  switch ( m->op )
+    {
+    case match_op_eq: return ( cmp == 0 );
+    case match_op_ne: return ( cmp != 0 );
+    case match_op_lt: return ( cmp < 0 );
+    case match_op_le: return ( cmp <= 0 );
+    case match_op_gt: return ( cmp > 0 );
+    case match_op_ge: return ( cmp >= 0 );
+    default: return mc_false;
+    }
+}
+
+
+/** Parallel fuzzy filter state. */
+typedef struct fuzzy_job_s {
+  const char* pattern;     /**< Fuzzy pattern. */
+  bool_t case_sensitive;   /**< Case sensitivity option. */
+  char** texts;            /**< Line texts. */
+  int64_t* candidates;     /**< Candidate lines (or NULL for all). */
+  mc_size_t cnt;           /**< Candidate count. */
+  mci_p* hits;             /**< Matching lines for each chunk. */
+  const pathtree_t* paths; /**< Path tree for texts (or NULL). */
+} fuzzy_job_t;
+
+
+/**
+ * Return line text. With path tree texts are leaf refs, and text is
+ * reconstructed to buffer.
+ *
+ * @param [in] paths Path tree (or NULL).
+ * @param [in] texts Line texts (or leaf refs).
+ * @param [in] i Line index.
+ * @param [in,out] buf Text buffer.
+ * @param [in,out] size Text buffer size.
+ *
+ * @return Line text.
+ */
+static inline const char* match_text( const pathtree_t* paths, char** texts,
+                                      mc_size_t i, char** buf, mc_size_t* size )
+{
+  if ( paths )
+    return pathtree_text( paths, texts[ i ], buf, size );
+  else
+    return texts[ i ];
+}
+
+
+/**
+ * Return regex of worker (NULL for plain string). Worker regex is
+ * compiled by the worker itself at its first task, i.e. compiling is
+ * parallel and done in background. If compile fails, the matcher
+ * regex is shared (regexec() serializes its users).
+ *
+ * @param job Match job.
+ * @param worker Worker index.
+ *
+ * @return Regex.
+ */
+static regex_t* match_worker_re( match_job_t* job, int worker )
+{
+  regex_t* re;
+
+  if ( !job->re )
+    return NULL;
+
+  if ( !job->re[ worker ] )
+    {
+      re = mc_new( regex_t );
+      if ( match_compile( re, job->m->pattern, job->m->case_sensitive ) )
+        {
+          job->re[ worker ] = re;
+        }
+      else
+        {
+          /* Same pattern compiled before, but be safe. */
+          mc_free( re );
+          job->re[ worker ] = &job->m->re;
+        }
+    }
+
+  return job->re[ worker ];
+}
+
+
+/**
+ * Match one chunk of lines (worker task).
+ *
+ * @param context Match job.
+ * @param worker Worker index.
+ * @param task Chunk index.
+ */
+static void match_chunk( void* context, int worker, int task )
+{
+  match_job_t* job = context;
+  regex_t* re = match_worker_re( job, worker );
+  const pathtree_t* paths = job->m->paths;
+  char* text_buf = NULL;
+  mc_size_t text_size = 0;
+  mc_size_t start, begin, end;
+  mcb_p hits;
+
+  start = job->base + (mc_size_t) task * MATCH_CHUNK;
+  begin = ( start < job->begin ) ? job->begin : start;
+  end = start + MATCH_CHUNK;
+  if ( end > job->end )
+    end = job->end;
+
+  /* Chunk bitarr is indexed from the chunk start. */
+  hits = mcb_new_size( mcb_words( MATCH_CHUNK ) );
+  mcb_resize( hits, end - start );
+
+  if ( job->m->field )
+    {
+      char* buf = NULL;
+      mc_size_t size = 0;
+
+      for ( mc_size_t i = begin; i < end && !job->cancel; i++ )
+        {
+          if ( match_field( job->m, re,
+                            match_text( paths, job->texts, i, &text_buf, &text_size ),
+                            i, &buf, &size ) )
+            mcb_set( hits, i - start );
+        }
+
+      if ( buf )
+        mc_free( buf );
+    }
+  else if ( job->m->literal )
+    {
+      for ( mc_size_t i = begin; i < end && !job->cancel; i++ )
+        {
+          if ( match_literal( job->m, match_text( paths, job->texts, i,
+                                                  &text_buf, &text_size ) ) )
+            mcb_set( hits, i - start );
+        }
+    }
+  else
+    {
+      for ( mc_size_t i = begin; i < end && !job->cancel; i++ )
+        {
+          if ( regexec( re, match_text( paths, job->texts, i, &text_buf, &text_size ),
+                        0, NULL, 0 ) == 0 )
+            mcb_set( hits, i - start );
+        }
+    }
+
+  if ( text_buf )
+    mc_free( text_buf );
+
+  job->hits[ task ] = hits;
+}
+
+
+/**
+ * Merge chunk bitarrs to marks and free them. Cancelled job is not
+ * merged, i.e. marks are not changed.
+ *
+ * @param job Match job.
+ * @param tasks Chunk count.
+ * @param marks Marks for lines (or NULL to only free).
+ */
+static void match_merge( match_job_t* job, int tasks, mcb_p marks )
+{
+  for ( int i = 0; i < tasks; i++ )
+    {
+      if ( !job->hits[ i ] )
+        continue;
+      if ( marks )
+        mcb_or_at( marks, job->hits[ i ], job->base + (mc_size_t) i * MATCH_CHUNK );
+      mcb_del( job->hits[ i ] );
+    }
+}
+
+
+/**
+ * Parse field pattern, i.e. "@<field><op><value>" where op is one
+ * of: "~", "=", "!=", "<", "<=", ">", ">=".
+ *
+ * @param [in] m Matcher object.
+ * @param [in] pattern Pattern.
+ *
+ * @return Value part of pattern (or NULL if not field pattern).
+ */
+static char* match_parse_field( matcher_t* m, char* pattern )
+{
+  static const struct { const char* str; match_op_t op; } ops[] = {
+    { "~", match_op_match }, { "!=", match_op_ne }, { "=", match_op_eq },
+    { "<=", match_op_le }, { "<", match_op_lt },
+    { ">=", match_op_ge }, { ">", match_op_gt } };
+  char* c = pattern + 1;
+  int field = 0;
+
+  if ( pattern[ 0 ] != '@' || !( *c >= '0' && *c <= '9' ) )
+    return NULL;
+
+  for ( ; *c >= '0' && *c <= '9'; c++ )
+    field = field * 10 + ( *c - '0' );
+
+  if ( field < 1 || field > FIELD_MAX )
+    return NULL;
+
+  for ( int i = 0; i < (int) ( sizeof( ops ) / sizeof( ops[ 0 ] ) ); i++ )
+    {
+      if ( !strncmp( c, ops[ i ].str, strlen( ops[ i ].str ) ) )
+        {
+          m->field = field;
+          m->op = ops[ i ].op;
+          return c + strlen( ops[ i ].str );
+        }
+    }
+
+  return NULL;
+}
+
+
+/**
+ * Create Matcher object. Regex is compiled only if pattern is not a
+ * plain string. Field patterns are recognized only with field index.
+ *
+ * @param pattern Regex pattern (or plain string, or field pattern).
+ * @param case_sensitive Case sensitivity option.
+ * @param literal Pattern is plain string (no regex).
+ * @param fields Field index (or NULL).
+ * @param paths Path tree for line texts (or NULL).
+ *
+ * @return Matcher object (or NULL on failure).
+ */
+matcher_t* matcher_new( char* pattern, bool_t case_sensitive, bool_t literal,
+                        const field_index_t* fields, const pathtree_t* paths ) /*acfd*/
+{
+  matcher_t* m;
+  char* str;
+  char* value;
+
+  m = mc_new( matcher_t );
+  m->case_sensitive = case_sensitive;
+  m->literal = NULL;
+  m->fields = fields;
+  m->paths = paths;
+  m->field = 0;
+  m->op = match_op_match;
+  m->numeric = mc_false;
+  m->value = 0.0;
+
+  if ( fields && ( value = match_parse_field( m, pattern ) ) )
+    {
+      if ( m->op != match_op_match )
+        {
+          /* Comparison, value is stored as literal (no regex). */
+          m->numeric = field_number( value, strlen( value ), &m->value );
+          if ( !m->numeric && m->op != match_op_eq && m->op != match_op_ne )
+            {
+              mc_free( m );
+              return NULL;
+            }
+          m->literal = mc_strdup( value );
+          m->len = strlen( value );
+          m->pattern = mc_strdup( value );
+          return m;
+        }
+
+      /* Field is matched with the rest of pattern. */
+      pattern = value;
+    }
+
+  if ( literal )
+    str = mc_strdup( pattern );
+  else
+    str = match_plain_string( pattern );
+
+  if ( str )
+    {
+      match_setup_literal( m, str );
+    }
+  else if ( !match_compile( &m->re, pattern, case_sensitive ) )
+    {
+      /* Failure. */
+      mc_free( m );
+      return NULL;
+    }
+
+  m->pattern = mc_strdup( pattern );
+
+  return m;
+}
+
+
+/**
+ * Remove Matcher object.
+ *
+ * @param m Matcher object.
+ */
+void matcher_rem( matcher_t* m ) /*acfd*/
+{
+  if ( m )
+    {
+      if ( m->literal )
+        mc_free( m->literal );
+      else
+        regfree( &m->re );
+      mc_free( m->pattern );
+      mc_free( m );
+    }
+}
+
+
+/**
+ * Match text.
+ *
+ * @param m Matcher object.
+ * @param text Text to match.
+ *
+ * @return True if text matches.
+ */
+bool_t matcher_match( matcher_t* m, const char* text ) /*acfd*/
+{
+  if ( m->literal )
+    return match_literal( m, text );
+  else
+    return ( regexec( &m->re, text, 0, NULL, 0 ) == 0 );
+}
+
+
+/**
+ * Poll function for background match job, i.e. user poll function
+ * that also stops the running chunks on cancel.
+ *
+ * @param context Match job.
+ * @param done Completed chunk count.
+ * @param tasks Chunk count.
+ *
+ * @return False if job is cancelled.
+ */
+static bool_t match_poll( void* context, int done, int tasks )
+{
+  match_job_t* job = context;
+
+  if ( !job->poll( job->poll_context, done, tasks ) )
+    job->cancel = mc_true;
+
+  return !job->cancel;
+}
+
+
+/**
+ * Run match job tasks with workers. For regex patterns each worker
+ * has a regex of its own, since regexec() serializes the users of
+ * same regex. With poll function the workers run in background (see
+ * worker_run_poll()).
+ *
+ * @param job Match job.
+ * @param workers Worker count.
+ * @param tasks Task count.
+ * @param func Task function.
+ *
+ * @return True if all tasks were completed (i.e. not cancelled).
+ */
+static bool_t match_run( match_job_t* job, int workers, int tasks, worker_func_t func )
+{
+  matcher_t* m = job->m;
+  bool_t complete = mc_true;
+
+  job->re = NULL;
+  job->cancel = mc_false;
+
+  /* Plain string matching is read only. */
+  if ( !m->literal )
+    {
+      job->re = mc_new_n( regex_t*, workers );
+
+      /* Worker 0 uses the matcher regex. */
+      job->re[ 0 ] = &m->re;
+      for ( int i = 1; i < workers; i++ )
+        job->re[ i ] = NULL;
+    }
+
+  if ( job->poll )
+    complete = ( worker_run_poll( workers, tasks, func, job, match_poll, job )
+                 && !job->cancel );
+  else
+    worker_run( workers, tasks, func, job );
+
+  if ( job->re )
+    {
+      for ( int i = 1; i < workers; i++ )
+        {
+          if ( job->re[ i ] && job->re[ i ] != &m->re )
+            {
+              regfree( job->re[ i ] );
+              mc_free( job->re[ i ] );
+            }
+        }
+
+      mc_free( job->re );
+    }
+
+  return complete;
+}
+
+
+/**
+ * Mark matching lines in range [begin,end). Range is split into
+ * chunks that are matched by workers. Each chunk has a bitarr of its
+ * own, which are merged to marks after all chunks are done.
+ *
+ * With poll function matching is done in background and cancelled
+ * if poll returns false. Marks are changed only when all chunks are
+ * done.
+ *
+ * @param m Matcher object.
+ * @param texts Line texts (or leaf refs of matcher path tree).
+ * @param begin Range start.
+ * @param end Range end (exclusive).
+ * @param marks Marks for lines (size at least end).
+ * @param poll Poll function (or NULL).
+ * @param poll_context Poll function context.
+ *
+ * @return True if matching was completed (i.e. not cancelled).
+ */
+bool_t matcher_mark( matcher_t* m, char** texts,
+                     mc_size_t begin, mc_size_t end,
+                     mcb_p marks,
+                     worker_poll_func_t poll, void* poll_context ) /*acfd*/
+{
+  match_job_t job;
+  int tasks, workers;
+  int64_t start;
+  bool_t complete = mc_true;
+
+  if ( begin >= end )
+    return mc_true;
+
+  start = stats_now();
+  stats.match_lines += end - begin;
+
+  job.base = begin - ( begin % MATCH_CHUNK );
+  tasks = (int) ( ( end - job.base + MATCH_CHUNK - 1 ) / MATCH_CHUNK );
+  workers = worker_count( tasks );
+
+  /* Background matching (poll) is always done by workers. */
+  if ( !poll && workers == 1 && m->field )
+    {
+      char* buf = NULL;
+      mc_size_t size = 0;
+      char* text_buf = NULL;
+      mc_size_t text_size = 0;
+      regex_t* re = ( m->literal ) ? NULL : &m->re;
+
+      for ( mc_size_t i = begin; i < end; i++ )
+        {
+          if ( match_field( m, re,
+                            match_text( m->paths, texts, i, &text_buf, &text_size ),
+                            i, &buf, &size ) )
+            mcb_set( marks, i );
+        }
+
+      if ( buf )
+        mc_free( buf );
+      if ( text_buf )
+        mc_free( text_buf );
+    }
+  else if ( !poll && workers == 1 )
+    {
+      char* text_buf = NULL;
+      mc_size_t text_size = 0;
+
+      /* Not worth the setup. */
+      for ( mc_size_t i = begin; i < end; i++ )
+        {
+          if ( matcher_match( m, match_text( m->paths, texts, i,
+                                             &text_buf, &text_size ) ) )
+            mcb_set( marks, i );
+        }
+
+      if ( text_buf )
+        mc_free( text_buf );
+    }
+  else
+    {
+      job.m = m;
+      job.texts = texts;
+      job.begin = begin;
+      job.end = end;
+      job.hits = mc_new_n( mcb_p, tasks );
+      job.poll = poll;
+      job.poll_context = poll_context;
+
+      for ( int i = 0; i < tasks; i++ )
+        job.hits[ i ] = NULL;
+
+      complete = match_run( &job, workers, tasks, match_chunk );
+      match_merge( &job, tasks, complete ? marks : NULL );
+
+      mc_free( job.hits );
+    }
+
+  stats_time_add( &stats.match_time, NULL, start );
+
+  return complete;
+}
+
+
+/**
+ * Collect matching lines of one chunk (worker task).
+ *
+ * @param context Match job.
+ * @param worker Worker index.
+ * @param task Chunk index.
+ */
+static void match_index_chunk( void* context, int worker, int task )
+{
+  match_job_t* job = context;
+  regex_t* re = match_worker_re( job, worker );
+  const pathtree_t* paths = job->m->paths;
+  char* text_buf = NULL;
+  mc_size_t text_size = 0;
+  const char* text;
+  mc_size_t begin, end;
+  mci_p found;
+
+  begin = job->base + (mc_size_t) task * MATCH_CHUNK;
+  end = begin + MATCH_CHUNK;
+  if ( end > job->end )
+    end = job->end;
+
+  found = mci_new();
+
+  if ( job->m->field )
+    {
+      char* buf = NULL;
+      mc_size_t size = 0;
+
+      for ( mc_size_t i = begin; i < end && !job->cancel; i++ )
+        {
+          if ( match_field( job->m, re,
+                            match_text( paths, job->texts, i, &text_buf, &text_size ),
+                            i, &buf, &size ) )
+            mci_append( found, i );
+        }
+
+      if ( buf )
+        mc_free( buf );
+    }
+  else
+    {
+      for ( mc_size_t i = begin; i < end && !job->cancel; i++ )
+        {
+          text = match_text( paths, job->texts, i, &text_buf, &text_size );
+          if ( re
+               ? regexec( re, text, 0, NULL, 0 ) == 0
+               : match_literal( job->m, text ) )
+            mci_append( found, i );
+        }
+    }
+
+  if ( text_buf )
+    mc_free( text_buf );
+
+  job->found[ task ] = found;
+}
+
+
+/**
+ * Append indices of matching lines in range [begin,end) to
+ * index. Range is split into chunks that are matched by workers.
+ *
+ * With poll function matching is done in background (see
+ * matcher_mark()). Index is changed only when all chunks are done.
+ *
+ * @param m Matcher object.
+ * @param texts Line texts (or leaf refs of matcher path tree).
+ * @param begin Range start.
+ * @param end Range end (exclusive).
+ * @param index Matching lines in ascending order.
+ * @param poll Poll function (or NULL).
+ * @param poll_context Poll function context.
+ *
+ * @return True if matching was completed (i.e. not cancelled).
+ */
+bool_t matcher_index( matcher_t* m, char** texts,
+                      mc_size_t begin, mc_size_t end,
+                      mci_p index,
+                      worker_poll_func_t poll, void* poll_context ) /*acfd*/
+{
+  match_job_t job;
+  int tasks, workers;
+  int64_t start;
+  bool_t complete;
+
+  if ( begin >= end )
+    return mc_true;
+
+  start = stats_now();
+  stats.match_lines += end - begin;
+
+  job.m = m;
+  job.texts = texts;
+  job.begin = begin;
+  job.end = end;
+  job.base = begin;
+  job.poll = poll;
+  job.poll_context = poll_context;
+
+  tasks = (int) ( ( end - begin + MATCH_CHUNK - 1 ) / MATCH_CHUNK );
+  job.found = mc_new_n( mci_p, tasks );
+  for ( int i = 0; i < tasks; i++ )
+    job.found[ i ] = NULL;
+
+  workers = worker_count( tasks );
+  complete = match_run( &job, workers, tasks, match_index_chunk );
+
+  for ( int i = 0; i < tasks; i++ )
+    {
+      if ( !job.found[ i ] )
+        continue;
+      if ( complete )
+        mci_append_n( index, job.found[ i ]->data, job.found[ i ]->used );
+      mci_del( job.found[ i ] );
+    }
+
+  mc_free( job.found );
+
+  stats_time_add( &stats.match_time, NULL, start );
+
+  return complete;
+}
+
+
+/**
+ * Match text with fuzzy pattern.
+ *
+ * @param pattern Fuzzy pattern.
+ * @param case_sensitive Case sensitivity option.
+ * @param text Text to match.
+ *
+ * @return True if text matches.
+ */
+bool_t match_fuzzy( const char* pattern, bool_t case_sensitive, const char* text ) /*acfd*/
+{
+  char set[ 3 ];
+
+  for ( ; *pattern; pattern++ )
+    {
+      if ( case_sensitive )
+        {
+          text = strchr( text, *pattern );
+        }
+      else
+        {
+          set[ 0 ] = tolower( (uchar) *pattern );
+          set[ 1 ] = toupper( (uchar) *pattern );
+          set[ 2 ] = 0;
+          text = strpbrk( text, set );
+        }
+
+      if ( !text )
+        return mc_false;
+
+      text++;
+    }
+
+  return mc_true;
+}
+
+
+/**
+ * Fuzzy filter one chunk of candidates (worker task).
+ *
+ * @param context Fuzzy job.
+ * @param worker Worker index.
+ * @param task Chunk index.
+ */
+static void fuzzy_chunk( void* context, int worker, int task )
+{
+  fuzzy_job_t* job = context;
+  char* text_buf = NULL;
+  mc_size_t text_size = 0;
+  mc_size_t begin, end;
+  int64_t line;
+  mci_p hits;
+
+  begin = (mc_size_t) task * MATCH_CHUNK;
+  end = begin + MATCH_CHUNK;
+  if ( end > job->cnt )
+    end = job->cnt;
+
+  hits = mci_new();
+
+  for ( mc_size_t i = begin; i < end; i++ )
+    {
+      line = job->candidates ? job->candidates[ i ] : (int64_t) i;
+      if ( match_fuzzy( job->pattern, job->case_sensitive,
+                        match_text( job->paths, job->texts, line, &text_buf, &text_size ) ) )
+        mci_append( hits, line );
+    }
+
+  if ( text_buf )
+    mc_free( text_buf );
+
+  job->hits[ task ] = hits;
+}
+
+
+/**
+ * Filter lines with fuzzy pattern. Pattern is case sensitive only if
+ * it has upper case chars. Since all lines matching a pattern also
+ * match the pattern's prefix, the result for prefix can be given as
+ * candidates when pattern is extended.
+ *
+ * @param pattern Fuzzy pattern.
+ * @param texts Line texts (or leaf refs of path tree).
+ * @param paths Path tree (or NULL).
+ * @param cnt Line count (if no candidates).
+ * @param candidates Candidate lines in order (or NULL for all lines).
+ *
+ * @return Matching lines in order.
+ */
+mci_p match_fuzzy_filter( const char* pattern,
+                          char** texts,
+                          const pathtree_t* paths,
+                          mc_size_t cnt,
+                          mci_p candidates ) /*acfd*/
+{
+  fuzzy_job_t job;
+  mci_p ret;
+  int tasks;
+  int64_t start;
+
+  job.pattern = pattern;
+  job.case_sensitive = mc_false;
+  for ( const char* c = pattern; *c; c++ )
+    {
+      if ( isupper( (uchar) *c ) )
+        job.case_sensitive = mc_true;
+    }
+
+  job.texts = texts;
+  job.paths = paths;
+  job.candidates = candidates ? candidates->data : NULL;
+  job.cnt = candidates ? candidates->used : cnt;
+
+  tasks = (int) ( ( job.cnt + MATCH_CHUNK - 1 ) / MATCH_CHUNK );
+  if ( tasks == 0 )
+    return mci_new();
+
+  start = stats_now();
+  stats.match_lines += job.cnt;
+
+  job.hits = mc_new_n( mci_p, tasks );
+
+  worker_run( worker_count( tasks ), tasks, fuzzy_chunk, &job );
+
+  /* Concatenate chunk results in order. */
+  ret = job.hits[ 0 ];
+  for ( int i = 1; i < tasks; i++ )
+    {
+      mci_append_n( ret, job.hits[ i ]->data, job.hits[ i ]->used );
+      mci_del( job.hits[ i ] );
+    }
+
+  mc_free( job.hits );
+
+  stats_time_add( &stats.match_time, NULL, start );
+
+  return ret;
+}
@@ -0,0 +1,64 @@
+#ifndef MATCH_H
+#define MATCH_H
+
+/**
+ * @file match.h
+ *
+ * Line matcher defs.
+ */
+
+
+#include "field.h"
+#include "pathtree.h"
+#include "worker.h"
+
+
+/** Lines per match task (multiple of bitarr word bits). */
+#define MATCH_CHUNK (64*1024)
+
+
+/** Field matcher operations. */
+typedef enum match_op_e {
+  match_op_match,         /**< Field matches pattern ("~"). */
+  match_op_eq,            /**< Field equals to value ("="). */
+  match_op_ne,            /**< Field does not equal to value ("!="). */
+  match_op_lt,            /**< Field is less than number ("<"). */
+  match_op_le,            /**< Field is at most number ("<="). */
+  match_op_gt,            /**< Field is greater than number (">"). */
+  match_op_ge             /**< Field is at least number (">="). */
+} match_op_t;
+
+
+/**
+ * Line matcher. Plain string patterns are matched without regex.
+ * Field pattern ("@<field><op><value>", with field index) matches
+ * one field of line only.
+ */
+typedef struct matcher_s {
+  char* pattern;          /**< Regex pattern. */
+  bool_t case_sensitive;  /**< Case sensitivity option. */
+  char* literal;          /**< Plain string (NULL for regex), folded if case insensitive. */
+  int len;                /**< Plain string length. */
+  char first[ 3 ];        /**< Plain string first char candidates (case variants). */
+  regex_t re;             /**< Compiled pattern (if not plain string). */
+  const field_index_t* fields; /**< Field index (field pattern). */
+  const pathtree_t* paths; /**< Path tree for line texts (or NULL). */
+  int field;              /**< Matched field (0 for whole line). */
+  match_op_t op;          /**< Field operation. */
+  bool_t numeric;         /**< Value is number. */
+  double value;           /**< Numeric value. */
+} matcher_t;
+
+
+
+/* autoc:c_func_decl:begin */
+matcher_t * matcher_new( char * pattern, bool_t case_sensitive, bool_t literal, const field_index_t * fields, const pathtree_t * paths );
+void matcher_rem( matcher_t * m );
+bool_t matcher_match( matcher_t * m, const char * text );
+bool_t matcher_mark( matcher_t * m, char ** texts, mc_size_t begin, mc_size_t end, mcb_p marks, worker_poll_func_t poll, void * poll_context );
+bool_t matcher_index( matcher_t * m, char ** texts, mc_size_t begin, mc_size_t end, mci_p index, worker_poll_func_t poll, void * poll_context );
+bool_t match_fuzzy( const char * pattern, bool_t case_sensitive, const char * text );
+mci_p match_fuzzy_filter( const char * pattern, char ** texts, const pathtree_t * paths, mc_size_t cnt, mci_p candidates );
+/* autoc:c_func_decl:end */
+
+#endif
@@ -0,0 +1,287 @@
+/**
+ * @file mca.c
+ *
+ * Arena (region) allocation from large chunks.
+ */
+
+/*
+ * Common headers:
+ */
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include <mc.h>
+#include "mca.h"
+
+
+const char* mca_version = "0.0.1";
+
+
+/** Round size up to alignment. */
+#define MCA_ROUND(size) (((size) + MCA_ALIGN - 1) & ~(MCA_ALIGN - 1))
+
+
+
+/*
+ * *************************************************************
+ * Internal functions.
+ */
+
+
+/**
+ * Create chunk with data area. Data follows the chunk descriptor in
+ * the same allocation.
+ *
+ * @param size Data size.
+ *
+ * @return Chunk.
+ */
+static mca_chunk_t* mca_chunk_new( mc_size_t size )
+{
+  mca_chunk_t* ch;
+
+  ch = mc_malloc( MCA_ROUND( sizeof( mca_chunk_t ) ) + size );
+  ch->data = (char*) ch + MCA_ROUND( sizeof( mca_chunk_t ) );
+  ch->size = size;
+  ch->used = 0;
+  ch->release = NULL;
+  ch->next = NULL;
+
+  return ch;
+}
+
+
+
+/*
+ * *************************************************************
+ * Arena allocation.
+ */
+
+
+mca_p mca_new_size( mc_size_t chunk_size )
+{
+  mca_p ar;
+
+  assert( chunk_size >= 1 );
+
+  ar = mc_new( mca_t );
+  ar->chunk_size = MCA_ROUND( chunk_size );
+  ar->chunk = NULL;
+  ar->total = 0;
+
+  return ar;
+}
+
+
+mca_p mca_new( void )
+{
+  return mca_new_size( MCA_DEFAULT_SIZE );
+}
+
+
+mca_p mca_del( mca_p ar )
+{
+  mca_chunk_t* ch;
+  mca_chunk_t* next;
+
+  if ( ar )
+    {
+      for ( ch = ar->chunk; ch; ch = next )
+        {
+          next = ch->next;
+          if ( ch->release )
+            ch->release( ch->data, ch->size );
+          mc_free( ch );
+        }
+      mc_free( ar );
+    }
+
+  return NULL;
+}
+
+
+void* mca_alloc( mca_p ar, mc_size_t size )
+{
+  mca_chunk_t* ch;
+  void* ret;
+
+  size = MCA_ROUND( size );
+
+  if ( size > ar->chunk_size / 4 )
+    {
+      /* Big allocation gets a chunk of its own. The chunk is placed
+         after the current chunk, so that the free space of current
+         chunk is still available for small allocations. */
+      ch = mca_chunk_new( size );
+      ch->used = size;
+      ar->total += size;
+
+      if ( ar->chunk )
+        {
+          ch->next = ar->chunk->next;
+          ar->chunk->next = ch;
+        }
+      else
+        {
+          ar->chunk = ch;
+        }
+
+      return ch->data;
+    }
+
+  if ( !ar->chunk || ( ar->chunk->size - ar->chunk->used ) < size )
+    {
+      /* Start a new current chunk. */
+      ch = mca_chunk_new( ar->chunk_size );
+      ch->next = ar->chunk;
+      ar->chunk = ch;
+      ar->total += ar->chunk_size;
+    }
+
+  ret = ar->chunk->data + ar->chunk->used;
+  ar->chunk->used += size;
+
+  return ret;
+}
+
+
+void* mca_memdup( mca_p ar, const void* data, mc_size_t size )
+{
+  void* ret;
+
+  ret = mca_alloc( ar, size );
+  mc_memcpy( data, ret, size );
+
+  return ret;
+}
+
+
+char* mca_strndup( mca_p ar, const char* str, mc_size_t len )
+{
+  char* ret;
+
+  ret = mca_alloc( ar, len + 1 );
+  mc_memcpy( str, ret, len );
+  ret[ len ] = 0;
+
+  return ret;
+}
+
+
+char* mca_strdup( mca_p ar, const char* str )
+{
+  return mca_strndup( ar, str, strlen( str ) );
+}
+
+
+void mca_adopt( mca_p ar, void* data, mc_size_t size, mca_release_func_t release )
+{
+  mca_chunk_t* ch;
+
+  ch = mc_new( mca_chunk_t );
+  ch->data = data;
+  ch->size = size;
+  ch->used = size;
+  ch->release = release;
+
+  /* Keep current chunk as head. */
+  if ( ar->chunk )
+    {
+      ch->next = ar->chunk->next;
+      ar->chunk->next = ch;
+    }
+  else
+    {
+      ch->next = NULL;
+      ar->chunk = ch;
+    }
+}
+
+
+void mca_merge( mca_p ar, mca_p from )
+{
+  mca_chunk_t* last;
+
+  if ( !from->chunk )
+    return;
+
+  /* Keep current chunk as head. */
+  for ( last = from->chunk; last->next; last = last->next )
+    ;
+
+  if ( ar->chunk )
+    {
+      last->next = ar->chunk->next;
+      ar->chunk->next = from->chunk;
+    }
+  else
+    {
+      ar->chunk = from->chunk;
+    }
+
+  ar->total += from->total;
+  from->chunk = NULL;
+  from->total = 0;
+}
+
+
+
+/*
+ * *************************************************************
+ * Pool allocation.
+ */
+
+
+mca_pool_p mca_pool_new( mc_size_t size )
+{
+  mca_pool_p pool;
+
+  if ( size < sizeof( void* ) )
+    size = sizeof( void* );
+
+  pool = mc_new( mca_pool_t );
+  pool->arena = mca_new();
+  pool->size = MCA_ROUND( size );
+  pool->free = NULL;
+
+  return pool;
+}
+
+
+mca_pool_p mca_pool_del( mca_pool_p pool )
+{
+  if ( pool )
+    {
+      mca_del( pool->arena );
+      mc_free( pool );
+    }
+
+  return NULL;
+}
+
+
+void* mca_pool_alloc( mca_pool_p pool )
+{
+  void* ret;
+
+  if ( pool->free )
+    {
+      ret = pool->free;
+      pool->free = *(void**) ret;
+      return ret;
+    }
+
+  return mca_alloc( pool->arena, pool->size );
+}
+
+
+void mca_pool_free( mca_pool_p pool, void* item )
+{
+  *(void**) item = pool->free;
+  pool->free = item;
+}
@@ -0,0 +1,244 @@
+#ifndef MCA_H
+#define MCA_H
+
+
+/**
+ * @file mca.h
+ *
+ * @brief Arena (region) allocation from large chunks.
+ *
+ * @mainpage
+ *
+ * mca-library allocates memory from large chunks. Individual
+ * allocations are never freed, but all of them are released at once
+ * when the arena is deleted. This makes creation and removal of
+ * millions of small items cheap.
+ *
+ * External memory regions (e.g. mmap'ed files) can be adopted to the
+ * arena, and they are released with the arena.
+ *
+ * Pool is an arena for fixed size items. Freed items are reused by
+ * later allocations (free list), and all items are released at once
+ * when the pool is deleted.
+ *
+ * mca depends on types from "mc.h":
+ * - Boolean: mc_bool_t
+ * - Size: mc_size_t
+ *
+ * mca depends on memory allocation functions from "mc":
+ * - Allocation: mc_new_n
+ * - De-allocation: mc_free
+ *
+ */
+
+
+
+/** Arena default chunk size. */
+#define MCA_DEFAULT_SIZE (64*1024)
+
+/** Allocation alignment. */
+#define MCA_ALIGN (sizeof(void*))
+
+
+/** mca-lib version. */
+extern const char* mca_version;
+
+
+/** Release function for adopted memory. */
+typedef void (*mca_release_func_t) ( void* data, mc_size_t size );
+
+
+/** Arena chunk type. */
+typedef struct mca_chunk_s mca_chunk_t;
+
+/** Arena chunk. */
+struct mca_chunk_s
+{
+  mca_chunk_t* next;             /**< Next chunk in chunk list. */
+  char* data;                    /**< Chunk data. */
+  mc_size_t size;                /**< Chunk size in bytes. */
+  mc_size_t used;                /**< Chunk usage in bytes. */
+  mca_release_func_t release;    /**< Release for adopted data (or NULL). */
+};
+
+
+/** mca-lib storage type. */
+typedef struct mca_s mca_t;
+
+/** mca-lib storage type ptr. */
+typedef mca_t* mca_p;
+
+
+/** Arena container. */
+struct mca_s
+{
+  /** Current chunk for small allocations (head of chunk list). */
+  mca_chunk_t* chunk;
+
+  /** Size of new chunks. */
+  mc_size_t chunk_size;
+
+  /** Total allocated bytes in chunks. */
+  mc_size_t total;
+};
+
+
+/** mca-lib pool type. */
+typedef struct mca_pool_s mca_pool_t;
+
+/** mca-lib pool type ptr. */
+typedef mca_pool_t* mca_pool_p;
+
+
+/** Pool of fixed size items. */
+struct mca_pool_s
+{
+  /** Storage for items. */
+  mca_p arena;
+
+  /** Item size (aligned). */
+  mc_size_t size;
+
+  /** Freed items (linked through the first word). */
+  void* free;
+};
+
+
+
+/**
+ * Create new Arena with chunk size. Allocations bigger than quarter
+ * of chunk size get a chunk of their own.
+ *
+ * @param chunk_size Chunk size.
+ *
+ * @return Arena.
+ */
+mca_p mca_new_size( mc_size_t chunk_size );
+
+
+/**
+ * Create new Arena with default chunk size.
+ *
+ * @return Arena.
+ */
+mca_p mca_new( void );
+
+
+/**
+ * Free Arena and all allocations from it.
+ *
+ * @param ar Arena.
+ *
+ * @return NULL.
+ */
+mca_p mca_del( mca_p ar );
+
+
+/**
+ * Allocate aligned memory from Arena. Memory is not initialized.
+ *
+ * @param ar Arena.
+ * @param size Allocation size.
+ *
+ * @return Allocation.
+ */
+void* mca_alloc( mca_p ar, mc_size_t size );
+
+
+/**
+ * Duplicate memory content to Arena.
+ *
+ * @param ar Arena.
+ * @param data Data to duplicate.
+ * @param size Bytesize of the duplication.
+ *
+ * @return Duplicate.
+ */
+void* mca_memdup( mca_p ar, const void* data, mc_size_t size );
+
+
+/**
+ * Duplicate string part to Arena as null terminated c-string.
+ *
+ * @param ar Arena.
+ * @param str String to duplicate.
+ * @param len String length (excluding null).
+ *
+ * @return Duplicate.
+ */
+char* mca_strndup( mca_p ar, const char* str, mc_size_t len );
+
+
+/**
+ * Duplicate c-string to Arena.
+ *
+ * @param ar Arena.
+ * @param str String to duplicate.
+ *
+ * @return Duplicate.
+ */
+char* mca_strdup( mca_p ar, const char* str );
+
+
+/**
+ * Adopt external memory to Arena. Release function is called for
+ * the memory when Arena is deleted.
+ *
+ * @param ar Arena.
+ * @param data Memory region.
+ * @param size Memory region size.
+ * @param release Release function.
+ */
+void mca_adopt( mca_p ar, void* data, mc_size_t size, mca_release_func_t release );
+
+
+/**
+ * Move all allocations of Arena "from" to Arena "ar". "from" becomes
+ * empty, but it can still be used for allocation.
+ *
+ * @param ar Arena.
+ * @param from Arena to move.
+ */
+void mca_merge( mca_p ar, mca_p from );
+
+
+/**
+ * Create new Pool for items of size.
+ *
+ * @param size Item size.
+ *
+ * @return Pool.
+ */
+mca_pool_p mca_pool_new( mc_size_t size );
+
+
+/**
+ * Free Pool and all items from it.
+ *
+ * @param pool Pool.
+ *
+ * @return NULL.
+ */
+mca_pool_p mca_pool_del( mca_pool_p pool );
+
+
+/**
+ * Allocate item from Pool. Memory is not initialized.
+ *
+ * @param pool Pool.
+ *
+ * @return Item.
+ */
+void* mca_pool_alloc( mca_pool_p pool );
+
+
+/**
+ * Return item to Pool for reuse.
+ *
+ * @param pool Pool.
+ * @param item Item (from the same Pool).
+ */
+void mca_pool_free( mca_pool_p pool, void* item );
+
+
+#endif
@@ -0,0 +1,329 @@
+/**
+ * @file mcb.c
+ *
+ * Automatic allocation for array of bits.
+ */
+
+/*
+ * Common headers:
+ */
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include <mc.h>
+#include "mcb.h"
+
+
+const char* mcb_version = "0.0.1";
+
+
+/** All bits set word. */
+#define MCB_ONES (~(mcb_word_t)0)
+
+/** Word mask for bits from nth (within word) upwards. */
+#define MCB_MASK_FROM(nth) (MCB_ONES << ((nth)%MCB_WORD_BITS))
+
+/** Word mask for bits below nth (within word). */
+#define MCB_MASK_BELOW(nth) (((nth)%MCB_WORD_BITS) ? (MCB_ONES >> (MCB_WORD_BITS - ((nth)%MCB_WORD_BITS))) : MCB_ONES)
+
+
+
+/*
+ * *************************************************************
+ * Internal functions.
+ */
+
+
+/** Range operation type. */
+typedef enum mcb_op_e { mcb_op_set, mcb_op_clr, mcb_op_toggle } mcb_op_t;
+
+
+/**
+ * Apply mask to word with operation.
+ *
+ * @param w Word.
+ * @param mask Affected bits.
+ * @param op Operation.
+ */
+static inline void mcb_apply( mcb_word_t* w, mcb_word_t mask, mcb_op_t op )
+{
+  switch ( op )
+    {
+    case mcb_op_set: *w |= mask; break;
+    case mcb_op_clr: *w &= ~mask; break;
+    case mcb_op_toggle: *w ^= mask; break;
+    }
+}
+
+
+/**
+ * Perform operation for bit range [begin,end).
+ *
+ * @param ba Bitarr.
+ * @param begin Range start.
+ * @param end Range end.
+ * @param op Operation.
+ */
+static void mcb_range_op( mcb_p ba, mc_size_t begin, mc_size_t end, mcb_op_t op )
+{
+  mc_size_t wb, we;
+
+  if ( end > ba->used )
+    end = ba->used;
+
+  if ( begin >= end )
+    return;
+
+  wb = begin / MCB_WORD_BITS;
+  we = ( end - 1 ) / MCB_WORD_BITS;
+
+  if ( wb == we )
+    {
+      mcb_apply( &ba->data[ wb ], MCB_MASK_FROM( begin ) & MCB_MASK_BELOW( end ), op );
+      return;
+    }
+
+  mcb_apply( &ba->data[ wb ], MCB_MASK_FROM( begin ), op );
+
+  /* Full words in between. */
+  switch ( op )
+    {
+    case mcb_op_set:
+      memset( &ba->data[ wb+1 ], 0xff, ( we - wb - 1 ) * mcb_sizeof );
+      break;
+    case mcb_op_clr:
+      memset( &ba->data[ wb+1 ], 0, ( we - wb - 1 ) * mcb_sizeof );
+      break;
+    case mcb_op_toggle:
+      for ( mc_size_t i = wb+1; i < we; i++ )
+        ba->data[ i ] = ~ba->data[ i ];
+      break;
+    }
+
+  mcb_apply( &ba->data[ we ], MCB_MASK_BELOW( end ), op );
+}
+
+
+
+/*
+ * *************************************************************
+ * Bit array.
+ */
+
+
+mcb_p mcb_new_size( mc_size_t size )
+{
+  mcb_p ba;
+
+  assert( size >= 1 );
+
+  ba = mc_new( mcb_t );
+  ba->size = size;
+  ba->used = 0;
+  ba->data = mc_new_n( mcb_word_t, size );
+
+  return ba;
+}
+
+
+mcb_p mcb_new( void )
+{
+  return mcb_new_size( MCB_DEFAULT_SIZE );
+}
+
+
+mcb_p mcb_del( mcb_p ba )
+{
+  if ( ba )
+    {
+      mc_del( (void*) ba->data );
+      mc_del( ba );
+    }
+  return NULL;
+}
+
+
+void mcb_resize( mcb_p ba, mc_size_t bits )
+{
+  mc_size_t words = mcb_words( bits );
+
+  if ( words > ba->size )
+    {
+      mc_size_t size = ba->size;
+
+      while ( words > size )
+        size *= 2;
+
+      ba->data = ( mcb_word_t* ) mc_realloc( (void*) ba->data, size * mcb_sizeof );
+      mc_memclr( &ba->data[ ba->size ], ( size - ba->size ) * mcb_sizeof );
+      ba->size = size;
+    }
+
+  if ( bits < ba->used )
+    {
+      /* Keep the unused bits zero. */
+      mcb_range_op( ba, bits, ba->used, mcb_op_clr );
+    }
+
+  ba->used = bits;
+}
+
+
+void mcb_assign( mcb_p ba, mc_size_t nth, mc_bool_t value )
+{
+  if ( value )
+    mcb_set( ba, nth );
+  else
+    mcb_clr( ba, nth );
+}
+
+
+void mcb_set_range( mcb_p ba, mc_size_t begin, mc_size_t end )
+{
+  mcb_range_op( ba, begin, end, mcb_op_set );
+}
+
+
+void mcb_clr_range( mcb_p ba, mc_size_t begin, mc_size_t end )
+{
+  mcb_range_op( ba, begin, end, mcb_op_clr );
+}
+
+
+void mcb_toggle_range( mcb_p ba, mc_size_t begin, mc_size_t end )
+{
+  mcb_range_op( ba, begin, end, mcb_op_toggle );
+}
+
+
+mc_size_t mcb_count_range( mcb_p ba, mc_size_t begin, mc_size_t end )
+{
+  mc_size_t wb, we;
+  mc_size_t cnt;
+
+  if ( end > ba->used )
+    end = ba->used;
+
+  if ( begin >= end )
+    return 0;
+
+  wb = begin / MCB_WORD_BITS;
+  we = ( end - 1 ) / MCB_WORD_BITS;
+
+  if ( wb == we )
+    return __builtin_popcountll( ba->data[ wb ] &
+                                 MCB_MASK_FROM( begin ) &
+                                 MCB_MASK_BELOW( end ) );
+
+  cnt = __builtin_popcountll( ba->data[ wb ] & MCB_MASK_FROM( begin ) );
+  for ( mc_size_t i = wb+1; i < we; i++ )
+    cnt += __builtin_popcountll( ba->data[ i ] );
+  cnt += __builtin_popcountll( ba->data[ we ] & MCB_MASK_BELOW( end ) );
+
+  return cnt;
+}
+
+
+mc_size_t mcb_count( mcb_p ba )
+{
+  mc_size_t cnt = 0;
+
+  /* Unused bits are zero, so full words can be counted. */
+  for ( mc_size_t i = 0; i < mcb_words( ba->used ); i++ )
+    cnt += __builtin_popcountll( ba->data[ i ] );
+
+  return cnt;
+}
+
+
+mc_size_t mcb_next( mcb_p ba, mc_size_t nth )
+{
+  mc_size_t wi;
+  mcb_word_t w;
+
+  if ( nth >= ba->used )
+    return MCB_INVALID_INDEX;
+
+  wi = nth / MCB_WORD_BITS;
+  w = ba->data[ wi ] & MCB_MASK_FROM( nth );
+
+  mc_loop
+    {
+      if ( w )
+        return wi * MCB_WORD_BITS + __builtin_ctzll( w );
+
+      wi++;
+      if ( wi >= mcb_words( ba->used ) )
+        return MCB_INVALID_INDEX;
+
+      w = ba->data[ wi ];
+    }
+}
+
+
+void mcb_or( mcb_p ba, mcb_p from )
+{
+  if ( from->used > ba->used )
+    mcb_resize( ba, from->used );
+
+  for ( mc_size_t i = 0; i < mcb_words( from->used ); i++ )
+    ba->data[ i ] |= from->data[ i ];
+}
+
+
+void mcb_or_at( mcb_p ba, mcb_p from, mc_size_t offset )
+{
+  mc_size_t wo = offset / MCB_WORD_BITS;
+
+  assert( offset % MCB_WORD_BITS == 0 );
+
+  if ( offset + from->used > ba->used )
+    mcb_resize( ba, offset + from->used );
+
+  for ( mc_size_t i = 0; i < mcb_words( from->used ); i++ )
+    ba->data[ wo + i ] |= from->data[ i ];
+}
+
+
+void mcb_xor_at( mcb_p ba, mcb_p from, mc_size_t offset )
+{
+  mc_size_t wo = offset / MCB_WORD_BITS;
+
+  assert( offset % MCB_WORD_BITS == 0 );
+
+  if ( offset + from->used > ba->used )
+    mcb_resize( ba, offset + from->used );
+
+  for ( mc_size_t i = 0; i < mcb_words( from->used ); i++ )
+    ba->data[ wo + i ] ^= from->data[ i ];
+}
+
+
+mcb_p mcb_copy_at( mcb_p ba, mc_size_t offset, mc_size_t bits )
+{
+  mcb_p ret;
+  mc_size_t wo = offset / MCB_WORD_BITS;
+  mc_size_t words;
+
+  assert( offset % MCB_WORD_BITS == 0 );
+
+  ret = mcb_new_size( mcb_words( bits ) );
+  mcb_resize( ret, bits );
+
+  /* Bits beyond source are zero. */
+  words = ( offset < ba->used ) ? mcb_words( ba->used ) - wo : 0;
+  if ( words > mcb_words( bits ) )
+    words = mcb_words( bits );
+
+  if ( words > 0 )
+    memcpy( ret->data, ba->data + wo, words * sizeof( mcb_word_t ) );
+  if ( words > 0 && bits % MCB_WORD_BITS && words == mcb_words( bits ) )
+    ret->data[ words - 1 ] &= MCB_MASK_BELOW( bits );
+
+  return ret;
+}
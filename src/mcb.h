@@ -0,0 +1,277 @@
+#ifndef MCB_H
+#define MCB_H
+
+
+/**
+ * @file mcb.h
+ *
+ * @brief Automatic allocation for array of bits.
+ *
+ * @mainpage
+ *
+ * mcb-library is for automatic allocation for array of bits. Bits
+ * are packed to 64-bit words and range operations are performed
+ * word at a time.
+ *
+ * Bits beyond the used count are always zero.
+ *
+ * mcb depends on types from "mc.h":
+ * - Boolean: mc_bool_t
+ * - Size: mc_size_t
+ *
+ * mcb depends on memory allocation functions from "mc":
+ * - Allocation: mc_new_n
+ * - Re-allocaxtion: mc_realloc
+ *
+ */
+
+
+
+/** Bitarr default size in words. */
+#define MCB_DEFAULT_SIZE 16
+
+/** Bits per word. */
+#define MCB_WORD_BITS 64
+
+/** Invalid index indicator. */
+#define MCB_INVALID_INDEX -1
+
+
+/** mcb-lib version. */
+extern const char* mcb_version;
+
+
+/** Bitarr storage word type. */
+typedef uint64_t mcb_word_t;
+
+
+/** Sizeof in myc-style. */
+#define mcb_sizeof (sizeof(mcb_word_t))
+
+/** Number of words for bits. */
+#define mcb_words(bits) (((bits) + MCB_WORD_BITS - 1) / MCB_WORD_BITS)
+
+
+
+/** mcb-lib storage type. */
+typedef struct mcb_s mcb_t;
+
+/** mcb-lib storage type ptr. */
+typedef mcb_t* mcb_p;
+
+
+/** Bitarr container. */
+struct mcb_s
+{
+  /** Allocation. */
+  mcb_word_t* data;
+
+  /** Size of memory as word count. */
+  mc_size_t size;
+
+  /** Usage count in bits. */
+  mc_size_t used;
+};
+
+
+
+/**
+ * Return nth bit value.
+ *
+ * @param ba Bitarr.
+ * @param nth Bit index.
+ *
+ * @return Bit value (0 or 1).
+ */
+#define mcb_get(ba,nth) \
+  ((int)(((ba)->data[(nth)/MCB_WORD_BITS] >> ((nth)%MCB_WORD_BITS)) & 1))
+
+
+/**
+ * Set nth bit.
+ *
+ * @param ba Bitarr.
+ * @param nth Bit index.
+ */
+#define mcb_set(ba,nth) \
+  ((ba)->data[(nth)/MCB_WORD_BITS] |= ((mcb_word_t)1 << ((nth)%MCB_WORD_BITS)))
+
+
+/**
+ * Clear nth bit.
+ *
+ * @param ba Bitarr.
+ * @param nth Bit index.
+ */
+#define mcb_clr(ba,nth) \
+  ((ba)->data[(nth)/MCB_WORD_BITS] &= ~((mcb_word_t)1 << ((nth)%MCB_WORD_BITS)))
+
+
+/**
+ * Toggle nth bit.
+ *
+ * @param ba Bitarr.
+ * @param nth Bit index.
+ */
+#define mcb_toggle(ba,nth) \
+  ((ba)->data[(nth)/MCB_WORD_BITS] ^= ((mcb_word_t)1 << ((nth)%MCB_WORD_BITS)))
+
+
+/**
+ * Create new Bitarr with size.
+ *
+ * @param size Initial size in words.
+ *
+ * @return Bitarr descriptor.
+ */
+mcb_p mcb_new_size( mc_size_t size );
+
+
+/**
+ * Create new Bitarr with default size.
+ *
+ * @return Bitarr descriptor.
+ */
+mcb_p mcb_new( void );
+
+
+/**
+ * Free Bitarr descriptor and contained data.
+ *
+ * @param ba Bitarr descriptor.
+ *
+ * @return NULL.
+ */
+mcb_p mcb_del( mcb_p ba );
+
+
+/**
+ * Set used bit count. Allocation is enlarged if needed, and new bits
+ * are zero.
+ *
+ * @param ba Bitarr descriptor.
+ * @param bits New bit count.
+ */
+void mcb_resize( mcb_p ba, mc_size_t bits );
+
+
+/**
+ * Assign nth bit.
+ *
+ * @param ba Bitarr descriptor.
+ * @param nth Bit index.
+ * @param value Bit value.
+ */
+void mcb_assign( mcb_p ba, mc_size_t nth, mc_bool_t value );
+
+
+/**
+ * Set bits in range [begin,end).
+ *
+ * @param ba Bitarr descriptor.
+ * @param begin Range start.
+ * @param end Range end (exclusive).
+ */
+void mcb_set_range( mcb_p ba, mc_size_t begin, mc_size_t end );
+
+
+/**
+ * Clear bits in range [begin,end).
+ *
+ * @param ba Bitarr descriptor.
+ * @param begin Range start.
+ * @param end Range end (exclusive).
+ */
+void mcb_clr_range( mcb_p ba, mc_size_t begin, mc_size_t end );
+
+
+/**
+ * Toggle bits in range [begin,end).
+ *
+ * @param ba Bitarr descriptor.
+ * @param begin Range start.
+ * @param end Range end (exclusive).
+ */
+void mcb_toggle_range( mcb_p ba, mc_size_t begin, mc_size_t end );
+
+
+/**
+ * Count set bits in range [begin,end).
+ *
+ * @param ba Bitarr descriptor.
+ * @param begin Range start.
+ * @param end Range end (exclusive).
+ *
+ * @return Set bit count.
+ */
+mc_size_t mcb_count_range( mcb_p ba, mc_size_t begin, mc_size_t end );
+
+
+/**
+ * Count all set bits.
+ *
+ * @param ba Bitarr descriptor.
+ *
+ * @return Set bit count.
+ */
+mc_size_t mcb_count( mcb_p ba );
+
+
+/**
+ * Return index of next set bit starting from nth.
+ *
+ * @param ba Bitarr descriptor.
+ * @param nth Search start.
+ *
+ * @return Bit index (or MCB_INVALID_INDEX).
+ */
+mc_size_t mcb_next( mcb_p ba, mc_size_t nth );
+
+
+/**
+ * Or bits from another Bitarr. Used count of target is extended to
+ * fit the source.
+ *
+ * @param ba Target Bitarr.
+ * @param from Source Bitarr.
+ */
+void mcb_or( mcb_p ba, mcb_p from );
+
+
+/**
+ * Or bits from another Bitarr to position. Source bit 0 is placed to
+ * offset, which must be a multiple of MCB_WORD_BITS. Used count of
+ * target is extended to fit the source.
+ *
+ * @param ba Target Bitarr.
+ * @param from Source Bitarr.
+ * @param offset Target bit offset for source.
+ */
+void mcb_or_at( mcb_p ba, mcb_p from, mc_size_t offset );
+
+
+/**
+ * Xor bits from another Bitarr to position, i.e. toggle the bits that
+ * are set in source (see mcb_or_at()).
+ *
+ * @param ba Target Bitarr.
+ * @param from Source Bitarr.
+ * @param offset Target bit offset for source.
+ */
+void mcb_xor_at( mcb_p ba, mcb_p from, mc_size_t offset );
+
+
+/**
+ * Copy bits from position to a new Bitarr. Offset must be a multiple
+ * of MCB_WORD_BITS. Bits beyond the used count of source are zero.
+ *
+ * @param ba Source Bitarr.
+ * @param offset Source bit offset.
+ * @param bits Bit count.
+ *
+ * @return Bitarr with bits.
+ */
+mcb_p mcb_copy_at( mcb_p ba, mc_size_t offset, mc_size_t bits );
+
+
+#endif
@@ -0,0 +1,381 @@
+/**
+ * @file mci.c
+ *
+ * Automatic allocation for array of 64-bit integers.
+ */
+
+/*
+ * Common headers:
+ */
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include <mc.h>
+#include "mci.h"
+
+
+const char* mci_version = "0.0.1";
+
+
+
+/*
+ * *************************************************************
+ * Auto-resize memory allocation.
+ */
+
+
+mc_bool_t mci_default_resizer( mci_p aa, mc_size_t newsize )
+{
+  if ( newsize > aa->size )
+    {
+      while ( newsize > aa->size )
+        aa->size = aa->size*2;
+      mci_resize_to( aa, aa->size );
+      return mc_true;
+    }
+  else if ( newsize < aa->size/2 )
+    {
+      /* Ensure that size is same or more than 1 and ensure that size is
+         always bigger than aa->used. */
+      while ( ( aa->size / 2 ) >= 1 &&
+              ( aa->size / 2 ) > newsize )
+        aa->size /= 2;
+      mci_resize_to( aa, aa->size );
+      return mc_true;
+    }
+  else
+    return mc_false;
+}
+
+
+mc_bool_t mci_enlarge_resizer( mci_p aa, mc_size_t newsize )
+{
+  if ( newsize > aa->size )
+    {
+      while ( newsize > aa->size )
+        aa->size = aa->size*2;
+      mci_resize_to( aa, aa->size );
+      return mc_true;
+    }
+  else
+    return mc_false;
+}
+
+
+/** Resize function pointer for Autoarr Memory. */
+mci_resize_func_t mci_resize_func = mci_default_resizer;
+
+
+mci_p mci_new_size( mc_size_t size )
+{
+  mci_p aa;
+
+  assert( size >= 1 );
+
+  aa = mc_new_n( mci_t, 1 );
+  aa->size = size;
+  aa->used = 0;
+  aa->data = mc_new_n( int64_t, size );
+  aa->resize = mci_default_resizer;
+
+  return aa;
+}
+
+
+mci_p mci_new( void )
+{
+  return mci_new_size( MCI_DEFAULT_SIZE );
+}
+
+
+mci_p mci_del( mci_p aa )
+{
+  if ( aa )
+    {
+      mc_del( (void*) aa->data );
+      mc_del( aa );
+    }
+  return NULL;
+}
+
+
+void mci_copy( mci_p aa, mci_p to )
+{
+  if ( aa->used > to->used )
+    mci_resize_to( to, aa->used );
+  to->used = aa->used;
+//  memcpy( (void*) to->data, (void*) aa->data, mci_usedsize(aa) );
+  mc_memcpy( aa->data, to->data, mci_usedsize(aa) );
+}
+
+
+mci_p mci_dup( mci_p aa )
+{
+  mci_p dup;
+  dup = mci_new_size( aa->size );
+  mci_copy( aa, dup );
+  return dup;
+}
+
+
+void mci_reset( mci_p aa )
+{
+  aa->used = 0;
+}
+
+
+void mci_delete_all( mci_p aa )
+{
+  aa->used = 0;
+}
+
+
+
+void mci_resize( mci_p aa, mc_size_t size )
+{
+  aa->resize( aa, size );
+}
+
+
+
+void mci_resize_to( mci_p aa, mc_size_t size )
+{
+  aa->size = size;
+  aa->data = ( int64_t* ) mc_realloc( (void*) aa->data, mci_bytesize(aa) );
+}
+
+
+void mci_compact( mci_p aa )
+{
+  aa->size = aa->used;
+  aa->data = ( int64_t* ) mc_realloc( (void*) aa->data, mci_bytesize(aa) );
+}
+
+
+void mci_insert_n_to( mci_p aa, mc_size_t pos, int64_t* data, mc_size_t len )
+{
+
+  /* Disallow holes. */
+  assert( pos <= aa->used );
+
+  mci_resize( aa, aa->used+len );
+
+  /* Move data to make room for new. */
+  if ( pos < aa->used )
+    {
+//      memmove( &( aa->data[ pos+len ] ),
+//               &( aa->data[pos] ),
+//               ( aa->used - pos ) * mci_sizeof );
+      mc_memmove( &( aa->data[pos] ),
+                  &( aa->data[ pos+len ] ),
+                  ( aa->used - pos ) * mci_sizeof );
+    }
+
+//  memcpy( &( aa->data[pos] ), data, len * mci_sizeof );
+  mc_memcpy( data, &( aa->data[pos] ), len * mci_sizeof );
+
+  aa->used += len;
+}
+
+
+void mci_insert_to( mci_p aa, mc_size_t pos, int64_t data )
+{
+  mci_insert_n_to( aa, pos, &data, 1 );
+}
+
+
+void mci_delete_n_at( mci_p aa, mc_size_t pos, mc_size_t len )
+{
+
+  /* Disallow holes. */
+  assert( pos <= aa->used );
+  assert( pos+len <= aa->size );
+
+  /* Move data to make room for new. */
+  if ( pos < aa->used )
+    mc_memmove( &( aa->data[ pos+len ] ),
+                &( aa->data[ pos ] ),
+                ( aa->used - pos - len ) * mci_sizeof );
+  //    memmove( &( aa->data[ pos ] ),
+  //             &( aa->data[ pos+len ] ),
+  //             ( aa->used - pos - len ) * mci_sizeof );
+
+  aa->used -= len;
+
+  mci_resize( aa, aa->used-len );
+}
+
+
+void mci_delete_at( mci_p aa, mc_size_t pos )
+{
+  mci_delete_n_at( aa, pos, 1 );
+}
+
+
+void mci_delete_n_end( mci_p aa, mc_size_t len )
+{
+  /* Check for holes in rem. */
+  assert( len <= aa->used );
+
+  aa->used -= len;
+  mci_resize( aa, aa->used );
+}
+
+
+void mci_assign_to( mci_p aa, mc_size_t pos, int64_t* data, mc_size_t len )
+{
+  /* Overwrite. */
+  mc_size_t ow;
+
+  ow = aa->used - pos;
+
+  /* Check for holes in set. */
+  assert( ow >= 0 );
+
+  if ( ( len - ow ) > 0 )
+    {
+      /* Grow before copy. */
+      mci_resize( aa, ( aa->used + len - ow ) );
+      aa->used += ( len - ow );
+    }
+  
+  /* Copy new data. */
+//  memcpy( &( aa->data[ pos ] ), data, len * mci_sizeof );
+  mc_memcpy( data, &( aa->data[ pos ] ), len * mci_sizeof );
+
+}
+
+
+void mci_assign( mci_p aa, int64_t* data, mc_size_t len )
+{
+  mci_reset( aa );
+  mci_insert_n_to( aa, 0, data, len );
+}
+
+
+void mci_append( mci_p aa, int64_t data )
+{
+  mci_insert_n_to( aa, aa->used, &data, 1 );
+}
+
+
+void mci_append_n( mci_p aa, int64_t* data, mc_size_t len )
+{
+  mci_insert_n_to( aa, aa->used, data, len );
+}
+
+
+mc_bool_t mci_append_unique( mci_p aa, int64_t data )
+{
+  if ( !mci_find( aa, data ) )
+    {
+      mci_append( aa, data );
+      return mc_true;
+    }
+  else
+    {
+      return mc_false;
+    }
+}
+
+
+void mci_prepend( mci_p aa, int64_t data )
+{
+  mci_insert_n_to( aa, 0, &data, 1 );
+}
+
+
+void mci_prepend_n( mci_p aa, int64_t* data, mc_size_t len )
+{
+  mci_insert_n_to( aa, 0, data, len );
+}
+
+
+mc_size_t mci_find_idx( mci_p aa, int64_t data )
+{
+  for ( mc_size_t i = 0; i < aa->used; i++ )
+    {
+      if ( aa->data[ i ] == data )
+        return i;
+    }
+  
+  return MCI_INVALID_INDEX;
+}
+
+
+mc_bool_t mci_find( mci_p aa, int64_t data )
+{
+  mc_size_t idx;
+
+  idx = mci_find_idx( aa, data );
+
+  if ( idx != MCI_INVALID_INDEX )
+    return mc_true;
+  else
+    return mc_false;
+}
+
+
+mc_size_t mci_lower_bound( mci_p aa, int64_t data )
+{
+  mc_size_t lo = 0;
+  mc_size_t hi = aa->used;
+  mc_size_t mid;
+
+  while ( lo < hi )
+    {
+      mid = lo + ( hi - lo ) / 2;
+      if ( aa->data[ mid ] < data )
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  return lo;
+}
+
+
+void mci_terminate( mci_p aa )
+{
+  if ( aa->data[ aa->used-1 ] != 0 )
+    {
+      mci_append( aa, 0 );
+      aa->used--;
+    }
+}
+
+
+void mci_push( mci_p s, int64_t item )
+{
+  mci_append( s, item );
+}
+
+
+int64_t mci_pop( mci_p s )
+{
+  int64_t d;
+  
+  d = s->data[ s->used-1 ];
+  mci_delete_n_end( s, 1 );
+  return d;
+}
+
+
+int64_t mci_peek( mci_p s )
+{
+  return s->data[ s->used-1 ];
+}
+
+
+mc_bool_t mci_empty( mci_p aa )
+{
+  if ( aa->used == 0 )
+    return mc_true;
+  else
+    return mc_false;
+}
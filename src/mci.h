@@ -0,0 +1,444 @@
+#ifndef MCI_H
+#define MCI_H
+
+
+/**
+ * @file mci.h
+ *
+ * @brief Automatic allocation for array of 64-bit integers.
+ *
+ * @mainpage
+ *
+ * mci-library is for automatic allocation for array of 64-bit
+ * integers. It does not include any extra functionality so it can
+ * easily be linked also statically to programs.
+ *
+ * mci depends on types from "mc.h":
+ * - Boolean: mc_bool_t
+ * - Size: mc_size_t
+ *
+ * mci depends on memory allocation functions from "mc":
+ * - Allocation: mc_new_n
+ * - Re-allocaxtion: mc_realloc
+ *
+ */
+
+
+
+/** Autoarr Memory default size. */
+#define MCI_DEFAULT_SIZE 128
+
+/** Invalid index indicator. */
+#define MCI_INVALID_INDEX -1
+
+
+/** mci-lib version. */
+extern const char* mci_version;
+
+
+/** mci-lib storage type. */
+
+
+
+
+/** Sizeof in myc-style. */
+#define mci_sizeof (sizeof(int64_t))
+
+/** Autoarr size in bytes. */
+#define mci_bytesize(aa) (mci_sizeof*aa->size)
+
+/** Autoarr size in bytes. */
+#define mci_usedsize(aa) (mci_sizeof*aa->used)
+
+
+
+/*
+ * *************************************************************
+ * Auto-resize memory allocation.
+ */
+
+
+/** mci-lib storage type. */
+typedef struct mci_s mci_t;
+
+/** mci-lib storage type ptr. */
+typedef mci_t* mci_p;
+
+/** Autoarr resizer function type. */
+typedef mc_bool_t (*mci_resize_func_t) ( mci_p aa, mc_size_t newsize );
+
+/** Handle to default Autoarr resizer function. */
+extern mci_resize_func_t mci_resize_func;
+
+
+/** Autoarr container. */
+struct mci_s
+{
+  /** Allocation. */
+  int64_t* data;
+
+  /** Size of memory as unit count. */
+  mc_size_t size;
+
+  /** Usage count. */
+  mc_size_t used;
+
+  /** Resizer function. */
+  mci_resize_func_t resize;
+
+};
+
+
+
+/**
+ * Return nth element in data as pointer that should be cast with
+ * mci_nth macro.
+ * 
+ * @param aa Autoarr.
+ * @param nth Element index.
+ * 
+ * @return Element.
+ */
+#define mci_nth_p(aa,nth) (&(((aa)->data)[nth]))
+
+
+/**
+ * Return the nth data from Autoarr casted to type.
+ * 
+ * @param aa Autoarr container.
+ * @param nth Nth entry.
+ * 
+ * @return Referenced data.
+ */
+#define mci_nth(aa,nth) ((aa)->data[nth])
+
+
+/**
+ * Default allocation size increase/decrease function. Called by
+ * mci_resize. Increases by factor of 2 and decreases by factor of
+ * 2.
+ * 
+ * @param aa Autoarr to resize.
+ * @param newsize Size to fit.
+ * 
+ * @return True if resizing was performed.
+ */
+mc_bool_t mci_default_resizer( mci_p aa, mc_size_t newsize );
+
+
+/**
+ * Optional resizer that only increases the allocation. Suitable for
+ * things that only grow in their lifetime.
+ * 
+ * @param aa Autoarr to resize.
+ * @param newsize Size to fit.
+ * 
+ * @return True if resizing was performed.
+ */
+mc_bool_t mci_enlarge_resizer( mci_p aa, mc_size_t newsize );
+
+
+/**
+ * Create new Autoarr Memory allocation. Size is not allowed to be
+ * smaller than 1.
+ * 
+ * @param size Initial size.
+ * 
+ * @return Autoarr descriptor.
+ */
+mci_p mci_new_size( mc_size_t size );
+
+
+/**
+ * Create new Autoarr Memory allocation with default size (128).
+ * 
+ * @return Autoarr descriptor.
+ */
+mci_p mci_new( void );
+
+
+/**
+ * Free Autoarr descriptor and contained data.
+ * 
+ * @param aa Autoarr descriptor.
+ */
+mci_p mci_del( mci_p aa );
+
+
+/**
+ * Copy Autoarr to another.
+ * 
+ * @param aa Source.
+ * @param to Destination.
+ */
+void mci_copy( mci_p aa, mci_p to );
+
+
+/**
+ * Duplicate Autoarr.
+ * 
+ * @param aa Autoarr to duplicate.
+ * 
+ * @return Autoarr descriptor.
+ */
+mci_p mci_dup( mci_p aa );
+
+
+/**
+ * Delete content (set used to 0), but don't touch allocations.
+ * 
+ * @param aa Autoarr.
+ */
+void mci_reset( mci_p aa );
+
+
+/**
+ * Delete content, but don't touch allocations.
+ * 
+ * @param aa Autoarr.
+ */
+void mci_delete_all( mci_p aa );
+
+
+/**
+ * Resize Autoarr allocation using the registered resizer in Autoarr.
+ * 
+ * @param aa Autoarr descriptor.
+ * @param size New size.
+ */
+void mci_resize( mci_p aa, mc_size_t size );
+
+
+/**
+ * Resize Autoarr allocation. Note that no checks are performed, so
+ * data might be lost.
+ * 
+ * @param aa Autoarr descriptor.
+ * @param size New size.
+ */
+void mci_resize_to( mci_p aa, mc_size_t size );
+
+
+/**
+ * Compact the allocation to used size.
+ * 
+ * @param aa Autoarr descriptor.
+ */
+void mci_compact( mci_p aa );
+
+
+/**
+ * Insert items at selected position. Existing data is shifted
+ * right. Function assumes item data unit. User must take care of
+ * scaling if non-item is used.
+ * 
+ * @param aa Autoarr.
+ * @param pos Insert position.
+ * @param data Data to add.
+ * @param len Number of items to add.
+ */
+void mci_insert_n_to( mci_p aa, mc_size_t pos, int64_t* data, mc_size_t len );
+
+
+/**
+ * Insert item at selected position. Existing data is shifted right.
+ * 
+ * @param aa Autoarr.
+ * @param pos Insert position.
+ * @param ch Item to add.
+ */
+void mci_insert_to( mci_p aa, mc_size_t pos, int64_t ch );
+
+
+/**
+ * Delete items from selected position. Existing data is shifted left
+ * after deletion position. Function assumes item data unit. User must
+ * take care of scaling if non-item is used.
+ * 
+ * @param aa Autoarr.
+ * @param pos Delete position.
+ * @param len Number of items to delete.
+ */
+void mci_delete_n_at( mci_p aa, mc_size_t pos, mc_size_t len );
+
+
+/**
+ * Delete item at selected position. Existing data is shifted left
+ * after deletion position.
+ * 
+ * @param aa Autoarr.
+ * @param pos Delete position.
+ */
+void mci_delete_at( mci_p aa, mc_size_t pos );
+
+
+/**
+ * Remove data from Autoarr (dealloc). Allocation is resized if usage
+ * drops below half of the current allocation.
+ * 
+ * @param aa Autoarr descriptor.
+ * @param len Number of items to remove from end.
+ */
+void mci_delete_n_end( mci_p aa, mc_size_t len );
+
+
+/**
+ * Assign Autoarr data. Start position can overlap existing data. More memory
+ * is allocated if needed.
+ * 
+ * @param aa Autoarr descriptor.
+ * @param pos Starting position for set.
+ * @param data Source data.
+ * @param len Source data length in units.
+ */
+void mci_assign_to( mci_p aa, mc_size_t pos, int64_t* data, mc_size_t len );
+
+
+/**
+ * Assign Autoarr data from start. More memory is allocated if needed.
+ * 
+ * @param aa Autoarr descriptor.
+ * @param data Source data.
+ * @param len Source data length in units.
+ */
+void mci_assign( mci_p aa, int64_t* data, mc_size_t len );
+
+
+/**
+ * Append one data after used position (concatenate).
+ *
+ * NOTE: when storing a pointer, the user have to provide the pointers
+ * address, not the pointer value.
+ * 
+ * @param aa Autoarr descriptor.
+ * @param data Source data address (pointer to data).
+ */
+void mci_append( mci_p aa, int64_t data );
+
+
+/**
+ * Append data after used position (concatenate).
+ * 
+ * @param aa Autoarr descriptor.
+ * @param data Source data.
+ * @param len Number of units to set.
+ */
+void mci_append_n( mci_p aa, int64_t* data, mc_size_t len );
+
+
+/**
+ * TODO 141214_0723: not tested yet.
+ *
+ * Append one data after used position (concatenate) if not in the
+ * list.
+ * 
+ * @param aa Autoarr descriptor.
+ * @param data Source data address (pointer to data).
+ * @return True if data added.
+ */
+mc_bool_t mci_append_unique( mci_p aa, int64_t data );
+
+
+
+/**
+ * Prepend one item.
+ * 
+ * @param aa Autoarr descriptor.
+ * @param data Data to prepend.
+ */
+void mci_prepend( mci_p aa, int64_t data );
+
+
+
+/**
+ * Prepend n items.
+ * 
+ * @param aa Autoarr descriptor.
+ * @param data Source data address (pointer to data).
+ * @param len Number of units to prepend.
+ */
+void mci_prepend_n( mci_p aa, int64_t* data, mc_size_t len );
+
+
+
+/**
+ * Return first index where data is found.
+ * 
+ * @param aa Autoarr descriptor.
+ * @param data Compare data.
+ */
+mc_size_t mci_find_idx( mci_p aa, int64_t data );
+
+
+/**
+ * Return true if data is found from Autoarr.
+ * 
+ * @param aa Autoarr descriptor.
+ * @param data Compare data.
+ */
+mc_bool_t mci_find( mci_p aa, int64_t data );
+
+
+/**
+ * Find position of first element that is not less than data. Autoarr
+ * must be sorted in ascending order.
+ *
+ * @param aa Autoarr.
+ * @param data Searched data.
+ *
+ * @return Element index (aa->used if all elements are less).
+ */
+mc_size_t mci_lower_bound( mci_p aa, int64_t data );
+
+
+/**
+ * Terminate the data area with NULL. After termination the "data"
+ * field of Autoarr can be used independently. However user must
+ * @see mc_free the Autoarr ("data" is not freed).
+ * 
+ * @param aa Autoarr.
+ * 
+ * @return Element.
+ */
+ void mci_terminate( mci_p aa );
+
+
+/**
+ * Autoarr stack push (i.e. end of Autoarr).
+ * 
+ * @param s Stack (Autoarr).
+ * @param item Pushed item.
+ */
+void mci_push( mci_p s, int64_t item );
+
+
+/**
+ * Autoarr stack pop (i.e. end of Autoarr).
+ * 
+ * @param s Stack (Autoarr).
+ * 
+ * @return Item from top of stack.
+ */
+int64_t mci_pop( mci_p s );
+
+
+/**
+ * Autoarr stack peek (i.e. end of Autoarr).
+ * 
+ * @param s Stack (Autoarr).
+ * 
+ * @return Item from top of stack.
+ */
+int64_t mci_peek( mci_p s );
+
+
+/**
+ * Return true if no elements in Autoarr.
+ * 
+ * @param aa Autoarr.
+ * 
+ * @return True if no entries.
+ */
+mc_bool_t mci_empty( mci_p aa );
+
+#endif
@@ -38,12 +38,13 @@ mc_bool_t mcp_default_resizer( mcp_p aa, mc_size_t newsize )
       mcp_resize_to( aa, aa->size );
       return mc_true;
     }
-  else if ( newsize < aa->size/2 )
+  else if ( newsize < aa->size/4 && aa->size > MCP_DEFAULT_SIZE )
     {
-      /* Ensure that size is same or more than 1 and ensure that size is
-         always bigger than aa->used. */
-      while ( ( aa->size / 2 ) >= 1 &&
-              ( aa->size / 2 ) > newsize )
+      /* Shrink only when usage is below quarter, and leave room for
+         doubling, i.e. alternating grow and shrink at the same size
+         does not cause reallocs. */
+      while ( aa->size > MCP_DEFAULT_SIZE &&
+              ( aa->size / 4 ) > newsize )
         aa->size /= 2;
       mcp_resize_to( aa, aa->size );
       return mc_true;
@@ -150,6 +151,13 @@ void mcp_resize_to( mcp_p aa, mc_size_t size )
 }
 
 
+void mcp_reserve( mcp_p aa, mc_size_t len )
+{
+  if ( aa->used + len > aa->size )
+    mcp_resize_to( aa, aa->used + len );
+}
+
+
 void mcp_compact( mcp_p aa )
 {
   aa->size = aa->used;
@@ -163,7 +171,9 @@ void mcp_insert_n_to( mcp_p aa, mc_size_t pos, void** data, mc_size_t len )
   /* Disallow holes. */
   assert( pos <= aa->used );
 
-  mcp_resize( aa, aa->used+len );
+  /* Only grow, shrinking is for deletions. */
+  if ( aa->used+len > aa->size )
+    mcp_resize( aa, aa->used+len );
 
   /* Move data to make room for new. */
   if ( pos < aa->used )
@@ -207,7 +217,7 @@ void mcp_delete_n_at( mcp_p aa, mc_size_t pos, mc_size_t len )
 
   aa->used -= len;
 
-  mcp_resize( aa, aa->used-len );
+  mcp_resize( aa, aa->used );
 }
 
 
@@ -237,10 +247,11 @@ void mcp_assign_to( mcp_p aa, mc_size_t pos, void** data, mc_size_t len )
   /* Check for holes in set. */
   assert( ow >= 0 );
 
-  if ( ( len - ow ) > 0 )
+  if ( len > ow )
     {
       /* Grow before copy. */
-      mcp_resize( aa, ( aa->used + len - ow ) );
+      if ( aa->used + len - ow > aa->size )
+        mcp_resize( aa, ( aa->used + len - ow ) );
       aa->used += ( len - ow );
     }
   
@@ -260,13 +271,25 @@ void mcp_assign( mcp_p aa, void** data, mc_size_t len )
 
 void mcp_append( mcp_p aa, void* data )
 {
+  /* Fast path, i.e. room available. */
+  if ( aa->used < aa->size )
+    {
+      aa->data[ aa->used++ ] = data;
+      return;
+    }
+
   mcp_insert_n_to( aa, aa->used, &data, 1 );
 }
 
 
 void mcp_append_n( mcp_p aa, void** data, mc_size_t len )
 {
-  mcp_insert_n_to( aa, aa->used, data, len );
+  /* One resize check for all data. */
+  if ( aa->used + len > aa->size )
+    mcp_resize( aa, aa->used + len );
+
+  mc_memcpy( data, &( aa->data[ aa->used ] ), len * mcp_sizeof );
+  aa->used += len;
 }
 
 
@@ -115,8 +115,10 @@ struct mcp_s
 
 /**
  * Default allocation size increase/decrease function. Called by
- * mcp_resize. Increases by factor of 2 and decreases by factor of
- * 2.
+ * mcp_resize. Increases by factor of 2 when full, and decreases by
+ * factor of 2 when usage is below quarter (not below
+ * MCP_DEFAULT_SIZE). The gap between the limits prevents reallocs
+ * when usage alternates around a limit.
  * 
  * @param aa Autoarr to resize.
  * @param newsize Size to fit.
@@ -219,6 +221,17 @@ void mcp_resize( mcp_p aa, mc_size_t size );
 void mcp_resize_to( mcp_p aa, mc_size_t size );
 
 
+/**
+ * Reserve room for len more units, i.e. following appends up to len
+ * units do not resize. Useful when the final size is known (or can
+ * be estimated) in advance.
+ * 
+ * @param aa Autoarr descriptor.
+ * @param len Number of units to reserve.
+ */
+void mcp_reserve( mcp_p aa, mc_size_t len );
+
+
 /**
  * Compact the allocation to used size.
  * 
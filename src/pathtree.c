@@ -0,0 +1,344 @@
+/**
+ * @file pathtree.c
+ *
+ * Shared-prefix path storage. Paths are split at "/" and directory
+ * parts are stored once in a parent-pointer tree, i.e. each path
+ * stores only its last component and a directory id. Directory nodes
+ * are found by (parent, name) from an open addressing hash table, and
+ * consecutive paths in the same directory reuse the previous lookup.
+ * Any text can be stored, since splitting is lossless (text without
+ * "/" has no directory).
+ *
+ */
+
+
+#include "mc.h"
+#include "global.h"
+#include "pathtree.h"
+
+#include <string.h>
+
+
+/**
+ * Return hash for directory node key (FNV-1a).
+ *
+ * @param parent Parent directory.
+ * @param name Name.
+ * @param len Name length.
+ *
+ * @return Hash.
+ */
+static inline uint64_t pathtree_hash( uint32_t parent, const char* name, mc_size_t len )
+{
+  uint64_t hash = 0xcbf29ce484222325ULL ^ parent;
+
+  hash *= 0x100000001b3ULL;
+  for ( mc_size_t i = 0; i < len; i++ )
+    {
+      hash ^= (unsigned char) name[ i ];
+      hash *= 0x100000001b3ULL;
+    }
+
+  return hash;
+}
+
+
+/**
+ * Create empty path tree.
+ *
+ * @return Path tree.
+ */
+pathtree_t* pathtree_new( void ) /*acfd*/
+{
+  pathtree_t* pt;
+
+  pt = mc_new( pathtree_t );
+  pt->arena = mca_new();
+  pt->block = NULL;
+  pt->block_used = PATHTREE_BLOCK_SIZE;
+  pt->dir_used = 0;
+  pt->dir_size = PATHTREE_INIT_SIZE / 2;
+  pt->dirs = mc_new_n( pathtree_dir_t, pt->dir_size );
+  pt->slot_size = PATHTREE_INIT_SIZE;
+  pt->slots = mc_new_n( uint32_t, pt->slot_size );
+  pt->last = NULL;
+  pt->last_len = 0;
+  pt->last_size = 0;
+  pt->last_dir = PATHTREE_NONE;
+
+  return pt;
+}
+
+
+/**
+ * Free path tree (including the stored paths).
+ *
+ * @param pt Path tree.
+ */
+void pathtree_del( pathtree_t* pt ) /*acfd*/
+{
+  mca_del( pt->arena );
+  mc_free( pt->dirs );
+  mc_free( pt->slots );
+  if ( pt->last )
+    mc_free( pt->last );
+  mc_free( pt );
+}
+
+
+/**
+ * Allocate packed (unaligned) storage for record.
+ *
+ * @param pt Path tree.
+ * @param size Record size.
+ *
+ * @return Record storage.
+ */
+static char* pathtree_alloc( pathtree_t* pt, mc_size_t size )
+{
+  char* ret;
+
+  if ( size > PATHTREE_BLOCK_SIZE / 4 )
+    /* Long records get storage of their own. */
+    return mca_alloc( pt->arena, size );
+
+  if ( pt->block_used + size > PATHTREE_BLOCK_SIZE )
+    {
+      pt->block = mca_alloc( pt->arena, PATHTREE_BLOCK_SIZE );
+      pt->block_used = 0;
+    }
+
+  ret = pt->block + pt->block_used;
+  pt->block_used += size;
+
+  return ret;
+}
+
+
+/**
+ * Double directory hash slot count.
+ *
+ * @param pt Path tree.
+ */
+static void pathtree_grow( pathtree_t* pt )
+{
+  mc_size_t mask;
+  mc_size_t i;
+  pathtree_dir_t* d;
+
+  mc_free( pt->slots );
+  pt->slot_size *= 2;
+  pt->slots = mc_new_n( uint32_t, pt->slot_size );
+  mask = pt->slot_size - 1;
+
+  for ( uint32_t id = 0; id < pt->dir_used; id++ )
+    {
+      d = &pt->dirs[ id ];
+      i = pathtree_hash( d->parent, d->name, d->len ) & mask;
+      while ( pt->slots[ i ] )
+        i = ( i + 1 ) & mask;
+      pt->slots[ i ] = id + 1;
+    }
+}
+
+
+/**
+ * Return directory node for name below parent. Node is created if it
+ * does not exist.
+ *
+ * @param pt Path tree.
+ * @param parent Parent directory (or PATHTREE_NONE).
+ * @param name Name.
+ * @param len Name length.
+ *
+ * @return Directory id.
+ */
+static uint32_t pathtree_child( pathtree_t* pt, uint32_t parent,
+                                const char* name, mc_size_t len )
+{
+  mc_size_t mask = pt->slot_size - 1;
+  mc_size_t i;
+  pathtree_dir_t* d;
+  char* copy;
+
+  for ( i = pathtree_hash( parent, name, len ) & mask;
+        pt->slots[ i ];
+        i = ( i + 1 ) & mask )
+    {
+      d = &pt->dirs[ pt->slots[ i ] - 1 ];
+      if ( d->parent == parent && d->len == len && !memcmp( d->name, name, len ) )
+        return pt->slots[ i ] - 1;
+    }
+
+  if ( pt->dir_used == pt->dir_size )
+    {
+      pt->dir_size *= 2;
+      pt->dirs = mc_realloc( pt->dirs, pt->dir_size * sizeof( pathtree_dir_t ) );
+    }
+
+  copy = pathtree_alloc( pt, len );
+  mc_memcpy( name, copy, len );
+
+  d = &pt->dirs[ pt->dir_used ];
+  d->parent = parent;
+  d->len = len;
+  d->name = copy;
+  pt->slots[ i ] = ++pt->dir_used;
+
+  /* Keep load factor at most 1/2, i.e. probe sequences short. */
+  if ( pt->dir_used * 2 > pt->slot_size )
+    pathtree_grow( pt );
+
+  return pt->dir_used - 1;
+}
+
+
+/**
+ * Return directory node for directory path (created if needed).
+ * Components are walked from the root, i.e. each component is looked
+ * up below the previous one.
+ *
+ * @param pt Path tree.
+ * @param dir Directory path.
+ * @param len Directory path length.
+ *
+ * @return Directory id.
+ */
+static uint32_t pathtree_dir( pathtree_t* pt, const char* dir, mc_size_t len )
+{
+  uint32_t parent = PATHTREE_NONE;
+  mc_size_t comp = 0;
+
+  for ( mc_size_t i = 0; i <= len; i++ )
+    {
+      if ( i == len || dir[ i ] == '/' )
+        {
+          parent = pathtree_child( pt, parent, dir + comp, i - comp );
+          comp = i + 1;
+        }
+    }
+
+  return parent;
+}
+
+
+/**
+ * Store path, i.e. directory part is shared with the other paths in
+ * the same directory.
+ *
+ * @param pt Path tree.
+ * @param path Path (not necessarily null terminated).
+ * @param len Path length.
+ *
+ * @return Leaf ref for path (see pathtree_text()).
+ */
+char* pathtree_add( pathtree_t* pt, const char* path, mc_size_t len ) /*acfd*/
+{
+  uint32_t dir = PATHTREE_NONE;
+  mc_size_t slash = len;
+  char* ref;
+
+  while ( slash > 0 && path[ slash - 1 ] != '/' )
+    slash--;
+
+  if ( slash > 0 )
+    {
+      /* Directory part without the last "/". */
+      if ( pt->last_dir != PATHTREE_NONE && pt->last_len == slash - 1
+           && !memcmp( pt->last, path, slash - 1 ) )
+        {
+          dir = pt->last_dir;
+        }
+      else
+        {
+          dir = pathtree_dir( pt, path, slash - 1 );
+
+          if ( slash > pt->last_size )
+            {
+              pt->last_size = slash * 2;
+              pt->last = mc_realloc( pt->last, pt->last_size );
+            }
+          mc_memcpy( path, pt->last, slash - 1 );
+          pt->last_len = slash - 1;
+          pt->last_dir = dir;
+        }
+    }
+
+  ref = pathtree_alloc( pt, sizeof( uint32_t ) + len - slash + 1 );
+  memcpy( ref, &dir, sizeof( uint32_t ) );
+  mc_memcpy( path + slash, ref + sizeof( uint32_t ), len - slash );
+  ref[ sizeof( uint32_t ) + len - slash ] = 0;
+
+  return ref;
+}
+
+
+/**
+ * Return path length of leaf ref.
+ *
+ * @param pt Path tree.
+ * @param ref Leaf ref.
+ *
+ * @return Path length.
+ */
+mc_size_t pathtree_len( const pathtree_t* pt, const char* ref ) /*acfd*/
+{
+  uint32_t dir;
+  mc_size_t len;
+
+  memcpy( &dir, ref, sizeof( uint32_t ) );
+  len = strlen( ref + sizeof( uint32_t ) );
+
+  for ( ; dir != PATHTREE_NONE; dir = pt->dirs[ dir ].parent )
+    len += pt->dirs[ dir ].len + 1;
+
+  return len;
+}
+
+
+/**
+ * Return path text of leaf ref. Text is reconstructed to buffer,
+ * which is grown if needed, unless path has no directory part. Path
+ * tree is not modified, i.e. parallel workers may reconstruct texts
+ * (with own buffers).
+ *
+ * @param [in] pt Path tree.
+ * @param [in] ref Leaf ref.
+ * @param [in,out] buf Text buffer (or NULL).
+ * @param [in,out] size Text buffer size.
+ *
+ * @return Path text.
+ */
+char* pathtree_text( const pathtree_t* pt, const char* ref, char** buf, mc_size_t* size ) /*acfd*/
+{
+  const char* name = ref + sizeof( uint32_t );
+  const pathtree_dir_t* d;
+  uint32_t dir;
+  mc_size_t namelen;
+  mc_size_t pos;
+
+  memcpy( &dir, ref, sizeof( uint32_t ) );
+  if ( dir == PATHTREE_NONE )
+    return (char*) name;
+
+  namelen = strlen( name );
+  pos = pathtree_len( pt, ref ) - namelen;
+
+  if ( pos + namelen + 1 > *size )
+    {
+      *size = ( pos + namelen + 1 ) * 2;
+      *buf = mc_realloc( *buf, *size );
+    }
+
+  /* Components are copied from the last one towards the root. */
+  mc_memcpy( name, *buf + pos, namelen + 1 );
+  for ( ; dir != PATHTREE_NONE; dir = d->parent )
+    {
+      d = &pt->dirs[ dir ];
+      (*buf)[ --pos ] = '/';
+      pos -= d->len;
+      mc_memcpy( d->name, *buf + pos, d->len );
+    }
+
+  return *buf;
+}
@@ -0,0 +1,68 @@
+#ifndef PATHTREE_H
+#define PATHTREE_H
+
+/**
+ * @file pathtree.h
+ *
+ * Shared-prefix path storage defs.
+ */
+
+
+#include "mc.h"
+#include "mca.h"
+#include "global.h"
+
+#include <stdint.h>
+
+
+/** Directory id for paths without directory part. */
+#define PATHTREE_NONE UINT32_MAX
+
+/** Initial directory hash slot count (power of 2). */
+#define PATHTREE_INIT_SIZE 1024
+
+/** Size of record blocks (records are packed to blocks). */
+#define PATHTREE_BLOCK_SIZE (64*1024)
+
+
+/** Directory node, i.e. one path component below parent directory. */
+typedef struct pathtree_dir_s {
+  uint32_t parent;       /**< Parent directory (or PATHTREE_NONE). */
+  uint32_t len;          /**< Name length. */
+  const char* name;      /**< Name (not null terminated). */
+} pathtree_dir_t;
+
+
+/**
+ * Path tree. Directories are stored once, as parent-pointer tree
+ * nodes, and each stored path (leaf) refers to its directory and
+ * stores only the last component. Leaf refs are packed records:
+ * directory id (4 bytes, unaligned) followed by null terminated
+ * name. Path text is reconstructed from the leaf ref.
+ */
+typedef struct pathtree_s {
+  mca_p arena;           /**< Storage for blocks. */
+  char* block;           /**< Current record block. */
+  mc_size_t block_used;  /**< Current block usage. */
+  pathtree_dir_t* dirs;  /**< Directory nodes. */
+  uint32_t dir_used;     /**< Directory count. */
+  uint32_t dir_size;     /**< Directory node storage size. */
+  uint32_t* slots;       /**< Directory hash slots (id + 1, 0 for free). */
+  mc_size_t slot_size;   /**< Slot count (power of 2). */
+  char* last;            /**< Directory part of previous path. */
+  mc_size_t last_len;    /**< Previous directory part length. */
+  mc_size_t last_size;   /**< Previous directory storage size. */
+  uint32_t last_dir;     /**< Previous directory (or PATHTREE_NONE). */
+} pathtree_t;
+
+
+
+/* autoc:c_func_decl:begin */
+pathtree_t* pathtree_new( void );
+void pathtree_del( pathtree_t* pt );
+char* pathtree_add( pathtree_t* pt, const char* path, mc_size_t len );
+mc_size_t pathtree_len( const pathtree_t* pt, const char* ref );
+char* pathtree_text( const pathtree_t* pt, const char* ref, char** buf, mc_size_t* size );
+/* autoc:c_func_decl:end */
+
+#endif
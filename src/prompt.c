@@ -6,6 +6,8 @@
  */
 
 
+#include "config.h"
+
 #include "mc.h"
 #include "global.h"
 #include "mcc.h"
@@ -166,6 +168,134 @@ bool_t prompt_interacting( prompt_t* p ) /*acfd*/
 }
   
 
+/**
+ * Perform line editing for key.
+ *
+ * @param p Prompt object.
+ * @param key Key from user.
+ *
+ * @return Edit type (prompt_edit_none for non-editing key).
+ */
+prompt_edit_t prompt_edit( prompt_t* p, int key ) /*acfd*/
+{
+  prompt_edit_t ret = prompt_edit_none;
+
+  switch ( key )
+    {
+
+    case CTRL_B:
+      /* Backwards char. */
+      ret = prompt_edit_move;
+      if ( p->bi > 0 )
+        {
+          if ( p->wi->x <= p->x0 )
+            {
+              p->b0--;
+              p->bi--;
+            }
+          else
+            {
+              p->bi--;
+            }
+        }
+      break;
+
+    case CTRL_F:
+      /* Forwards char. */
+      ret = prompt_edit_move;
+      if ( p->bi < p->buf->used )
+        {
+          if ( p->wi->x >= WI_X_MAX(p->wi) )
+            {
+              p->b0++;
+              p->bi++;
+            }
+          else
+            {
+              p->bi++;
+            }
+        }
+      break;
+
+    case CTRL_A:
+      /* Beginning of line. */
+      ret = prompt_edit_move;
+      p->bi = 0;
+      p->b0 = 0;
+      break;
+
+    case CTRL_E:
+      /* End of line. */
+      ret = prompt_edit_move;
+      p->bi = p->buf->used;
+      p->b0 = p->bi - WI_X_MAX(p->wi) + p->x0;
+      if ( p->b0 < 0 )
+        p->b0 = 0;
+      break;
+
+    case CTRL_D:
+      /* Delete char. */
+      ret = prompt_edit_move;
+      if ( p->bi < p->buf->used )
+        {
+          ret = prompt_edit_change;
+          mcc_delete_at( p->buf, p->bi );
+        }
+      break;
+
+    case BS:
+    case CTRL_H:
+      /* Backspace char. */
+      ret = prompt_edit_move;
+      if ( p->bi > 0 )
+        {
+          ret = prompt_edit_change;
+          if ( p->wi->x <= p->x0 )
+            {
+              p->b0--;
+              p->bi--;
+            }
+          else
+            {
+              p->bi--;
+            }
+          mcc_delete_at( p->buf, p->bi );
+        }
+      break;
+
+    case CTRL_K:
+      /* Kill line. */
+      ret = prompt_edit_move;
+      if ( p->bi < p->buf->used )
+        {
+          ret = prompt_edit_change;
+          mcc_delete_n_at( p->buf, p->bi, p->buf->used - p->bi );
+        }
+      break;
+
+    default:
+      /* Add char. */
+      if ( key >= 32 && key <= 126 )
+        {
+          ret = prompt_edit_change;
+          mcc_insert_to( p->buf, p->bi, (char) key );
+          if ( p->wi->x >= WI_X_MAX(p->wi) )
+            {
+              p->b0++;
+              p->bi++;
+            }
+          else
+            {
+              p->bi++;
+            }
+        }
+      break;
+    }
+
+  return ret;
+}
+
+
 /**
  * Interact using the prompt, i.e. get user input.
  * 
@@ -205,108 +335,16 @@ char* prompt_interact( prompt_t* p, char* label ) /*acfd*/
           ret = NULL;
           break;
 
-        case CTRL_B:
-          /* Backwards char. */
-          if ( p->bi > 0 )
-            {
-              if ( p->wi->x <= p->x0 )
-                {
-                  p->b0--;
-                  p->bi--;
-                }
-              else
-                {
-                  p->bi--;
-                }
-            }
-          break;
-
-        case CTRL_F:
-          /* Forwards char. */
-          if ( p->bi < p->buf->used )
-            {
-              if ( p->wi->x >= WI_X_MAX(p->wi) )
-                {
-                  p->b0++;
-                  p->bi++;
-                }
-              else
-                {
-                  p->bi++;
-                }
-            }
-          break;
-
-        case CTRL_A:
-          /* Beginning of line. */
-          p->bi = 0;
-          p->b0 = 0;
-          break;
-
-        case CTRL_E:
-          /* End of line. */
-          p->bi = p->buf->used;
-          p->b0 = p->bi - WI_X_MAX(p->wi) + p->x0;
-          if ( p->b0 < 0 )
-            p->b0 = 0;
-          break;
-
-        case CTRL_D:
-          /* Delete char. */
-          if ( p->bi < p->buf->used )
-            {
-              mcc_delete_at( p->buf, p->bi );
-            }
-          break;
-
-        case BS:
-        case CTRL_H:
-          /* Backspace char. */
-          if ( p->bi > 0 )
-            {
-              if ( p->wi->x <= p->x0 )
-                {
-                  p->b0--;
-                  p->bi--;
-                }
-              else
-                {
-                  p->bi--;
-                }
-              mcc_delete_at( p->buf, p->bi );
-            }
-          break;
-
-        case CTRL_K:
-          /* Kill line. */
-          if ( p->bi < p->buf->used )
-            {
-              mcc_delete_n_at( p->buf, p->bi, p->buf->used - p->bi );
-            }
-          break;
-
         default:
-          /* Add char. */
-          if ( key >= 32 && key <= 126 )
-            {
-              mcc_insert_to( p->buf, p->bi, (char) key );
-              if ( p->wi->x >= WI_X_MAX(p->wi) )
-                {
-                  p->b0++;
-                  p->bi++;
-                }
-              else
-                {
-                  p->bi++;
-                }
-            }
+          prompt_edit( p, key );
           break;
         }
 
       if ( done )
         break;
 
-      prompt_refresh( p );
+      if ( !screen_skip_refresh() )
+        prompt_refresh( p );
 
     }
 
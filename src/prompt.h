@@ -19,6 +19,14 @@ typedef struct prompt_s {
 } prompt_t;
 
 
+/** Result of line editing key. */
+typedef enum prompt_edit_e {
+  prompt_edit_none,     /**< Not an editing key. */
+  prompt_edit_move,     /**< Cursor move (input not changed). */
+  prompt_edit_change    /**< Input changed. */
+} prompt_edit_t;
+
+
 
 /* autoc:c_func_decl:begin */
 prompt_t * prompt_init( win_info * wi, char * user_prompt );
@@ -29,6 +37,7 @@ void prompt_label( prompt_t * p, char * prompt );
 void prompt_msg( prompt_t * p, char * msg );
 void prompt_refresh( prompt_t * p );
 bool_t prompt_interacting( prompt_t * p );
+prompt_edit_t prompt_edit( prompt_t * p, int key );
 char * prompt_interact( prompt_t * p, char * label );
 /* autoc:c_func_decl:end */
 
@@ -6,15 +6,22 @@
  */
 
 
+#include "config.h"
+
 #include "mc.h"
 #include "global.h"
+#include "stats.h"
 #include "screen.h"
-#include "config.h"
+
+#include <string.h>
+#include <time.h>
 
 #ifdef USE_TERMBOX
 # include <termbox.h>
 #else
 # include <ncurses.h>
+# include <locale.h>
+# include <langinfo.h>
 #endif
 
 
@@ -24,9 +31,37 @@
 /** Macro to index screen buffer array through window. */
 #define BUFWI(wi,x,y) (((y + wi->si->y_min + wi->y_min)*(wi->si->x_size)) + ( x + wi->si->x_min + wi->x_min ))
 
+/** Mark screen row as changed. */
+#define DIRTY(si,y) ((si)->dirty[(y)] = 1)
+
+/** Mark window row as changed. */
+#define DIRTYWI(wi,y) ((wi)->si->dirty[(y) + (wi)->si->y_min + (wi)->y_min] = 1)
+
 /** Convert exotic characters to space. */
 #define SIMPLE_CHAR(c) (screen_char_map[(uchar)c].type == text ? c : ' ')
 
+/** Tab stop interval for text display. */
+#define SCREEN_TAB_SIZE 8
+
+/** Character shown for invalid UTF-8. */
+#define SCREEN_INVALID_CHAR 0xfffd
+
+/** Character shown for non-ASCII if terminal is not UTF-8 capable. */
+#define SCREEN_ASCII_CHAR '?'
+
+/** Number of cells output at once. */
+#define SCREEN_RUN_SIZE 256
+
+/** Compare screen cells. */
+#define SCREEN_CELL_EQ(a,b) ((a).ch == (b).ch && (a).cont == (b).cont && (a).color == (b).color)
+
+#ifdef SCREEN_NULL
+/** Terminal width for null backend. */
+# define SCREEN_NULL_WIDTH 80
+/** Terminal height for null backend. */
+# define SCREEN_NULL_HEIGHT 24
+#endif
+
 
 
 /** Allow assertions for critical routines. */
@@ -47,9 +82,17 @@ void* screen_win_resize_context = NULL;
 screen_callback screen_pre_win_resize = NULL;
 screen_callback screen_post_win_resize = NULL;
 screen_fatal_callback screen_fatal_error = NULL;
+screen_callback screen_idle = NULL;
+void* screen_idle_context = NULL;
+int screen_idle_timeout = 20;
+int screen_frame_interval = 16;
 
 int screen_status_line = -1;
 
+#ifdef SCREEN_NULL
+const char* screen_script = NULL;
+#endif
+
 
 /**
  * Global handle to currently used character map.
@@ -57,6 +100,34 @@ int screen_status_line = -1;
 screen_char_def_t* screen_char_map;
 
 
+/** Time of the latest screen refresh. */
+static struct timespec screen_frame_time;
+
+#ifdef USE_TERMBOX
+/** Event read ahead by screen_key_pending (if screen_event_pending). */
+static struct tb_event screen_pending_event;
+static bool_t screen_event_pending = false;
+
+/** Termbox output is UTF-8. */
+static bool_t screen_utf8 = mc_true;
+
+#elif defined( SCREEN_NULL )
+
+/** Null backend shows only ASCII. */
+static bool_t screen_utf8 = mc_false;
+
+#else
+
+/** Terminal is UTF-8 capable (locale and ncursesw). */
+static bool_t screen_utf8 = mc_false;
+
+/** Terminal locale (environment LC_CTYPE). Terminal locale is used
+    only for ncurses calls, since regex et al. are faster with the
+    default locale. */
+static locale_t screen_locale = (locale_t) 0;
+#endif
+
+
 screen_char_def_t screen_default_char_map[] = {
   {code,"x00"},
   {code,"x01"},
@@ -348,9 +419,43 @@ fg_bg_color scr_color_table[] = {
 
 
 
-/** Set of functions that interface to either ncurses or termbox. */
+/** Set of functions that interface to either ncurses or termbox (or
+    to nothing, with null backend). */
 
-#ifdef USE_TERMBOX
+#if defined( SCREEN_NULL )
+
+/** Initialize terminal (nothing to do). */
+void term_init( void ) {}
+
+/** Return terminal width (-2). */
+int term_width( void )
+{
+  return SCREEN_NULL_WIDTH-2;
+}
+
+/** Return terminal height (-1). */
+int term_height( void )
+{
+  return SCREEN_NULL_HEIGHT-1;
+}
+
+/** Return true is terminal has color. */
+bool_t term_has_color( void )
+{
+  return false;
+}
+
+/** Setup terminal color mode. */
+void term_setup_color( void ) {}
+
+/** Close terminal. */
+void term_close( void ) {}
+
+/** Default color setting. */
+void screen_set_default_color( int color ) {}
+
+
+#elif defined( USE_TERMBOX )
 
 /** Initialize terminal. */
 void term_init( void )
@@ -398,11 +503,40 @@ void screen_set_default_color( int color )
 # else
 
 
+/** Use terminal locale in this thread. */
+static void screen_locale_enter( void )
+{
+  if ( screen_locale )
+    uselocale( screen_locale );
+}
+
+/** Return to global (default) locale. */
+static void screen_locale_leave( void )
+{
+  if ( screen_locale )
+    uselocale( LC_GLOBAL_LOCALE );
+}
+
+
 /** Initialize terminal. */
 void term_init( void )
 {
-  /* Start curses mode. */
+  screen_locale = newlocale( LC_CTYPE_MASK, "", (locale_t) 0 );
+
+#ifdef HAVE_NCURSESW
+  if ( screen_locale )
+    screen_utf8 = !strcmp( nl_langinfo_l( CODESET, screen_locale ), "UTF-8" );
+#endif
+
+  /* Start curses mode. Curses checks the process locale for UTF-8
+     only here, and the process returns to default locale after. */
+  if ( screen_utf8 )
+    setlocale( LC_CTYPE, "" );
+  screen_locale_enter();
   initscr();
+  screen_locale_leave();
+  if ( screen_utf8 )
+    setlocale( LC_CTYPE, "C" );
 
   /* Line buffering disabled. */
 
@@ -419,6 +553,9 @@ void term_init( void )
 
   /* Don't echo() while we do getch. */
   noecho();
+
+  /* Allow curses to scroll with terminal line insert/delete. */
+  idlok( stdscr, TRUE );
 }
 
 /**
@@ -470,7 +607,15 @@ bool_t term_has_color( void )
  */
 void term_close( void )
 {
+  screen_locale_enter();
   endwin();
+  screen_locale_leave();
+
+  if ( screen_locale )
+    {
+      freelocale( screen_locale );
+      screen_locale = (locale_t) 0;
+    }
 }
 
 /** Default color setting. */
@@ -497,6 +642,8 @@ screen_info* screen_open( void )
 
   si = mc_new( screen_info );
   si->buf = NULL;
+  si->front = NULL;
+  si->dirty = NULL;
 
   screen_update_geom( si );
 
@@ -527,7 +674,11 @@ void screen_update_geom( screen_info* si )
    */
 
   if ( si->buf )
-    mc_free( si->buf );
+    {
+      mc_free( si->buf );
+      mc_free( si->front );
+      mc_free( si->dirty );
+    }
 
   si->x_min = 0;
   si->y_min = 0;
@@ -540,6 +691,11 @@ void screen_update_geom( screen_info* si )
   si->size = si->y_size * si->x_size;
 
   si->buf = mc_new_n(char_info,(si->size));
+  si->front = mc_new_n(char_info,(si->size));
+  si->dirty = mc_new_n(uchar,(si->y_size));
+
+  /* Terminal content is unknown. */
+  si->redraw = true;
 
   /* Ask ncurses if colors are available. */
   if ( term_has_color() )
@@ -565,6 +721,8 @@ void screen_update_geom( screen_info* si )
 void* screen_close( screen_info* si )
 {
   mc_free( si->buf );
+  mc_free( si->front );
+  mc_free( si->dirty );
   mc_free( si );
   term_close();
   return NULL;
@@ -720,8 +878,11 @@ void screen_clear_buf( screen_info* si )
   for ( i = 0; i < si->size; i++ )
     {
       si->buf[ i ].ch = 0;
+      si->buf[ i ].cont = 0;
       si->buf[ i ].color = SCR_COLOR_DEFAULT;
     }
+  for ( i = 0; i < si->y_size; i++ )
+    DIRTY( si, i );
 }
 
 
@@ -745,8 +906,10 @@ void screen_clear_win( win_info* wi )
       for ( x = 0; x < x_limit; x++ )
         {
           wi->si->buf[ BUFWI(wi,x,y) ].ch = 0;
+          wi->si->buf[ BUFWI(wi,x,y) ].cont = 0;
           wi->si->buf[ BUFWI(wi,x,y) ].color = SCR_COLOR_DEFAULT;
         }
+      DIRTYWI( wi, y );
     }
 }
 
@@ -769,8 +932,10 @@ void screen_clear_line( win_info* wi )
   for ( x = 0; x < x_limit; x++ )
     {
       wi->si->buf[ BUFWI(wi,x,wi->y) ].ch = 0;
+      wi->si->buf[ BUFWI(wi,x,wi->y) ].cont = 0;
       wi->si->buf[ BUFWI(wi,x,wi->y) ].color = SCR_COLOR_DEFAULT;
     }
+  DIRTYWI( wi, wi->y );
 }
 
 
@@ -901,6 +1066,205 @@ bool_t screen_setpos( win_info* wi, int x, int y )
 }
 
 
+/**
+ * Decode UTF-8 character. Invalid byte (or truncated sequence) is
+ * decoded as one byte replacement character.
+ *
+ * @param s Text.
+ * @param len Text length (at least 1).
+ * @param [out] cp Codepoint.
+ *
+ * @return Character length in bytes.
+ */
+static inline int screen_utf8_decode( const uchar* s, size_t len, uint32_t* cp )
+{
+  uint32_t c = s[ 0 ];
+  uint32_t min;
+  int n;
+
+  if ( c < 0x80 )
+    {
+      *cp = c;
+      return 1;
+    }
+  else if ( c >= 0xc2 && c <= 0xdf )
+    {
+      n = 2; c &= 0x1f; min = 0x80;
+    }
+  else if ( c >= 0xe0 && c <= 0xef )
+    {
+      n = 3; c &= 0x0f; min = 0x800;
+    }
+  else if ( c >= 0xf0 && c <= 0xf4 )
+    {
+      n = 4; c &= 0x07; min = 0x10000;
+    }
+  else
+    {
+      *cp = SCREEN_INVALID_CHAR;
+      return 1;
+    }
+
+  if ( (size_t) n > len )
+    {
+      *cp = SCREEN_INVALID_CHAR;
+      return 1;
+    }
+
+  for ( int i = 1; i < n; i++ )
+    {
+      if ( ( s[ i ] & 0xc0 ) != 0x80 )
+        {
+          *cp = SCREEN_INVALID_CHAR;
+          return 1;
+        }
+      c = ( c << 6 ) | ( s[ i ] & 0x3f );
+    }
+
+  /* Overlong forms, surrogates and out of range. */
+  if ( c < min || ( c >= 0xd800 && c <= 0xdfff ) || c > 0x10ffff )
+    {
+      *cp = SCREEN_INVALID_CHAR;
+      return 1;
+    }
+
+  *cp = c;
+  return n;
+}
+
+
+/** Codepoint range. */
+typedef struct screen_range_s {
+  uint32_t first;   /**< First codepoint. */
+  uint32_t last;    /**< Last codepoint. */
+} screen_range_t;
+
+
+/** Zero width characters (combining marks and format chars). */
+static const screen_range_t screen_zero_width[] = {
+  { 0x0300, 0x036f }, { 0x0483, 0x0489 }, { 0x0591, 0x05bd },
+  { 0x0610, 0x061a }, { 0x064b, 0x065f }, { 0x0670, 0x0670 },
+  { 0x06d6, 0x06dc }, { 0x06df, 0x06e4 }, { 0x0900, 0x0902 },
+  { 0x093c, 0x093c }, { 0x0941, 0x0948 }, { 0x094d, 0x094d },
+  { 0x0e31, 0x0e31 }, { 0x0e34, 0x0e3a }, { 0x0e47, 0x0e4e },
+  { 0x1160, 0x11ff }, { 0x1ab0, 0x1aff }, { 0x1dc0, 0x1dff },
+  { 0x200b, 0x200f }, { 0x202a, 0x202e }, { 0x2060, 0x2064 },
+  { 0x20d0, 0x20ff }, { 0x302a, 0x302d }, { 0x3099, 0x309a },
+  { 0xfe00, 0xfe0f }, { 0xfe20, 0xfe2f }, { 0xfeff, 0xfeff },
+  { 0xe0100, 0xe01ef },
+};
+
+
+/** Wide characters (East Asian wide and fullwidth, emoji). */
+static const screen_range_t screen_wide[] = {
+  { 0x1100, 0x115f }, { 0x231a, 0x231b }, { 0x2329, 0x232a },
+  { 0x23e9, 0x23ec }, { 0x2614, 0x2615 }, { 0x2e80, 0x303e },
+  { 0x3041, 0x33ff }, { 0x3400, 0x4dbf }, { 0x4e00, 0x9fff },
+  { 0xa000, 0xa4cf }, { 0xa960, 0xa97f }, { 0xac00, 0xd7a3 },
+  { 0xf900, 0xfaff }, { 0xfe10, 0xfe19 }, { 0xfe30, 0xfe6f },
+  { 0xff00, 0xff60 }, { 0xffe0, 0xffe6 }, { 0x1f300, 0x1f64f },
+  { 0x1f900, 0x1f9ff }, { 0x20000, 0x2fffd }, { 0x30000, 0x3fffd },
+};
+
+
+/**
+ * Check if codepoint is included in ranges (binary search).
+ *
+ * @param cp Codepoint.
+ * @param ranges Ascending ranges.
+ * @param cnt Range count.
+ *
+ * @return True if included.
+ */
+static bool_t screen_in_ranges( uint32_t cp, const screen_range_t* ranges, int cnt )
+{
+  int lo = 0, hi = cnt - 1, mid;
+
+  if ( cp < ranges[ 0 ].first || cp > ranges[ cnt-1 ].last )
+    return false;
+
+  while ( lo <= hi )
+    {
+      mid = ( lo + hi ) / 2;
+      if ( cp < ranges[ mid ].first )
+        hi = mid - 1;
+      else if ( cp > ranges[ mid ].last )
+        lo = mid + 1;
+      else
+        return true;
+    }
+
+  return false;
+}
+
+
+/**
+ * Return display width of character (0, 1 or 2).
+ *
+ * @param cp Codepoint.
+ *
+ * @return Width.
+ */
+static inline int screen_char_width( uint32_t cp )
+{
+  if ( cp < 0x300 )
+    return 1;
+
+  if ( screen_in_ranges( cp, screen_zero_width,
+                         sizeof( screen_zero_width ) / sizeof( screen_range_t ) ) )
+    return 0;
+
+  if ( screen_in_ranges( cp, screen_wide,
+                         sizeof( screen_wide ) / sizeof( screen_range_t ) ) )
+    return 2;
+
+  return 1;
+}
+
+
+/**
+ * Decode the next character of text and return the display column
+ * after it. Tab is returned as TAB and extends to the next tab stop,
+ * other control chars are shown as SPACE.
+ *
+ * @param str Text.
+ * @param len Text length.
+ * @param pos Character position.
+ * @param col Character display column.
+ * @param [out] cp Codepoint.
+ * @param [out] next_col Display column after character.
+ *
+ * @return Character length in bytes.
+ */
+static inline int screen_text_next( const char* str, size_t len,
+                                    size_t pos, size_t col,
+                                    uint32_t* cp, size_t* next_col )
+{
+  uchar ch = str[ pos ];
+  int n;
+
+  if ( ch < 0x80 )
+    {
+      if ( screen_char_map[ ch ].type == tab )
+        {
+          *cp = '\t';
+          *next_col = ( col / SCREEN_TAB_SIZE + 1 ) * SCREEN_TAB_SIZE;
+        }
+      else
+        {
+          *cp = SIMPLE_CHAR( ch );
+          *next_col = col + 1;
+        }
+      return 1;
+    }
+
+  n = screen_utf8_decode( (const uchar*) str + pos, len - pos, cp );
+  *next_col = col + screen_char_width( *cp );
+
+  return n;
+}
+
+
 /**
  * Write string to window (screen) to current position and return
  * strlen. Overflowing characters will not be displayed. Window
@@ -917,18 +1281,233 @@ int screen_set_str2( win_info* wi, const char* str )
 {
   int len = strlen( str );
 
-  /* Write all chars to off-screen buffer unless they are
-     overflowing. */
-  for ( int i = 0; i < len; i++ )
+  screen_set_text( wi, str, len, 0, NULL, -1 );
+
+  return len;
+}
+
+
+/**
+ * Initialize empty text layout.
+ *
+ * @param layout Text layout.
+ */
+/* autoc:c_func_decl:screen_text_init */
+void screen_text_init( screen_text_t* layout )
+{
+  layout->stops = NULL;
+  layout->stop_size = 0;
+  screen_text_reset( layout );
+}
+
+
+/**
+ * Free text layout storage.
+ *
+ * @param layout Text layout.
+ */
+/* autoc:c_func_decl:screen_text_free */
+void screen_text_free( screen_text_t* layout )
+{
+  if ( layout->stops )
+    mc_free( layout->stops );
+  screen_text_init( layout );
+}
+
+
+/**
+ * Reset text layout for new text, i.e. nothing is scanned. Stop
+ * storage is reused.
+ *
+ * @param layout Text layout.
+ */
+/* autoc:c_func_decl:screen_text_reset */
+void screen_text_reset( screen_text_t* layout )
+{
+  layout->plain = 0;
+  layout->pos = 0;
+  layout->col = 0;
+  layout->end = mc_false;
+  layout->stop_cnt = 0;
+}
+
+
+/**
+ * Extend text layout upto display column "upto" (or text end), i.e.
+ * plain prefix and stops are computed from the scanned position
+ * onwards (see screen_text_t).
+ *
+ * @param layout Text layout.
+ * @param str Text.
+ * @param len Text length.
+ * @param upto Display column to scan upto.
+ */
+static void screen_text_extend( screen_text_t* layout, const char* str, size_t len,
+                                size_t upto )
+{
+  size_t pos = layout->pos;
+  size_t col = layout->col;
+  size_t next_col;
+  uint32_t cp;
+
+  while ( col < upto )
     {
-      if ( (wi->x+i) <= wi->x_max+1 )
+      if ( pos >= len || !str[ pos ] )
+        {
+          layout->end = mc_true;
+          break;
+        }
+
+      if ( pos == layout->plain
+           && screen_char_map[ (uchar) str[ pos ] ].type == text )
+        {
+          /* Plain prefix continues. */
+          layout->plain++;
+          pos++;
+          col++;
+          continue;
+        }
+
+      if ( col >= layout->plain + ( layout->stop_cnt + 1 ) * SCREEN_TEXT_STRIDE )
         {
-          wi->si->buf[ BUFWI(wi,wi->x+i,wi->y) ].ch = SIMPLE_CHAR( str[ i ] );
-          wi->si->buf[ BUFWI(wi,wi->x+i,wi->y) ].color = scr_default_color;
+          /* Stop at character boundary. */
+          if ( layout->stop_cnt == layout->stop_size )
+            {
+              layout->stop_size = layout->stop_size ? 2 * layout->stop_size : 16;
+              layout->stops = mc_realloc( layout->stops,
+                                          layout->stop_size * sizeof( screen_text_stop_t ) );
+            }
+          layout->stops[ layout->stop_cnt ].pos = pos;
+          layout->stops[ layout->stop_cnt ].col = col;
+          layout->stop_cnt++;
         }
+
+      pos += screen_text_next( str, len, pos, col, &cp, &next_col );
+      col = next_col;
     }
 
-  return len;
+  layout->pos = pos;
+  layout->col = col;
+}
+
+
+/**
+ * Write text to window (screen) to current position. Text is shown
+ * from display column "skip" onwards and writing stops at window
+ * edge, i.e. only the visible part of text is processed (null
+ * terminated text needs no length, see SCREEN_TEXT_NUL). UTF-8 text
+ * is decoded to characters, tabs are expanded to the next tab stop
+ * and other control chars are shown as SPACE. Zero width chars
+ * (e.g. combining marks) are not shown. Window position does not
+ * change.
+ *
+ * With layout (see screen_text_t), layout is first extended upto the
+ * window edge, and then plain prefix is copied without decoding, and
+ * skipping starts from the nearest stop.
+ *
+ * @param wi Window info.
+ * @param str Text (not necessarily null terminated).
+ * @param len Text length (text ends also at null, see SCREEN_TEXT_NUL).
+ * @param skip Number of display columns to skip.
+ * @param layout Text layout (or NULL), extended if needed.
+ * @param color Color (negative for default).
+ *
+ * @return Number of written cells.
+ */
+/* autoc:c_func_decl:screen_set_text */
+int screen_set_text( win_info* wi, const char* str, size_t len,
+                     size_t skip, screen_text_t* layout, int color )
+{
+  int room = wi->x_max + 2 - wi->x;
+  char_info* cell;
+  size_t plain, pos, col, next_col;
+  uint32_t cp;
+  int n, cnt = 0;
+
+  if ( room <= 0 )
+    return 0;
+
+  if ( color < 0 )
+    color = scr_default_color;
+
+  plain = 0;
+  if ( layout )
+    {
+      if ( !layout->end && layout->col < skip + room )
+        screen_text_extend( layout, str, len, skip + room );
+      plain = layout->plain;
+    }
+  if ( plain > len )
+    plain = len;
+
+  cell = &wi->si->buf[ BUFWI( wi, wi->x, wi->y ) ];
+
+  /* Display column equals to position within plain prefix. */
+  pos = col = ( skip < plain ) ? skip : plain;
+
+  for ( ; pos < plain && cnt < room; pos++, col++, cnt++ )
+    {
+      cell[ cnt ].ch = str[ pos ];
+      cell[ cnt ].cont = 0;
+      cell[ cnt ].color = color;
+    }
+
+  if ( layout && layout->stop_cnt > 0 && skip >= plain + SCREEN_TEXT_STRIDE )
+    {
+      /* Start from the last stop before skip. */
+      size_t i = ( skip - plain ) / SCREEN_TEXT_STRIDE;
+
+      if ( i > layout->stop_cnt )
+        i = layout->stop_cnt;
+
+      while ( i > 0 && layout->stops[ i-1 ].col > skip )
+        i--;
+
+      if ( i > 0 )
+        {
+          pos = layout->stops[ i-1 ].pos;
+          col = layout->stops[ i-1 ].col;
+        }
+    }
+
+  for ( ; pos < len && str[ pos ] && cnt < room; pos += n, col = next_col )
+    {
+      n = screen_text_next( str, len, pos, col, &cp, &next_col );
+
+      if ( next_col <= skip )
+        continue;
+
+      if ( cp == '\t' || col < skip || next_col - col > (size_t) ( room - cnt ) )
+        {
+          /* Tab, or partially visible wide char. */
+          for ( size_t c = ( col < skip ) ? skip : col; c < next_col && cnt < room; c++ )
+            {
+              cell[ cnt ].ch = ' ';
+              cell[ cnt ].cont = 0;
+              cell[ cnt ].color = color;
+              cnt++;
+            }
+        }
+      else if ( next_col > col )
+        {
+          cell[ cnt ].ch = cp;
+          cell[ cnt ].cont = 0;
+          cell[ cnt ].color = color;
+          cnt++;
+
+          if ( next_col - col == 2 )
+            {
+              cell[ cnt ].ch = ' ';
+              cell[ cnt ].cont = 1;
+              cell[ cnt ].color = color;
+              cnt++;
+            }
+        }
+    }
+
+  DIRTYWI( wi, wi->y );
+
+  return cnt;
 }
 
 
@@ -950,16 +1529,7 @@ int screen_set_color_str( win_info* wi, char* str, int color )
 {
   int len = strlen( str );
 
-  /* Write all chars to off-screen buffer unless they are
-     overflowing. */
-  for ( int i = 0; i < len; i++ )
-    {
-      if ( (wi->x+i) <= wi->x_max+1 )
-        {
-          wi->si->buf[ BUFWI(wi,wi->x+i,wi->y) ].ch = SIMPLE_CHAR( str[ i ] );
-          wi->si->buf[ BUFWI(wi,wi->x+i,wi->y) ].color = color;
-        }
-    }
+  screen_set_text( wi, str, len, 0, NULL, color );
 
   return len;
 }
@@ -967,7 +1537,103 @@ int screen_set_color_str( win_info* wi, char* str, int color )
 
 
 /**
- * Dump offline buffer to the screen.
+ * Encode character for terminal (UTF-8). Non-ASCII is shown with
+ * SCREEN_ASCII_CHAR for terminals that are not UTF-8 capable.
+ *
+ * @param cp Codepoint.
+ * @param [out] out Encoded character (at most 4 bytes).
+ *
+ * @return Encoded length.
+ */
+static inline int screen_char_encode( uint32_t cp, char* out )
+{
+  if ( cp < 0x80 )
+    {
+      out[ 0 ] = cp;
+      return 1;
+    }
+  else if ( !screen_utf8 )
+    {
+      out[ 0 ] = SCREEN_ASCII_CHAR;
+      return 1;
+    }
+  else if ( cp < 0x800 )
+    {
+      out[ 0 ] = 0xc0 | ( cp >> 6 );
+      out[ 1 ] = 0x80 | ( cp & 0x3f );
+      return 2;
+    }
+  else if ( cp < 0x10000 )
+    {
+      out[ 0 ] = 0xe0 | ( cp >> 12 );
+      out[ 1 ] = 0x80 | ( ( cp >> 6 ) & 0x3f );
+      out[ 2 ] = 0x80 | ( cp & 0x3f );
+      return 3;
+    }
+  else
+    {
+      out[ 0 ] = 0xf0 | ( cp >> 18 );
+      out[ 1 ] = 0x80 | ( ( cp >> 12 ) & 0x3f );
+      out[ 2 ] = 0x80 | ( ( cp >> 6 ) & 0x3f );
+      out[ 3 ] = 0x80 | ( cp & 0x3f );
+      return 4;
+    }
+}
+
+
+/**
+ * Find the changed span of screen row, i.e. the cells that differ
+ * between off-screen buffer and on-screen content.
+ *
+ *
+ * @param si Screen info.
+ * @param y Row.
+ * @param [out] first First changed cell.
+ * @param [out] last Last changed cell.
+ *
+ * @return True if row has changes.
+ */
+static bool_t screen_row_changes( screen_info* si, int y, int* first, int* last )
+{
+  char_info* back = &si->buf[ BUFI(0,y) ];
+  char_info* front = &si->front[ BUFI(0,y) ];
+  int x0, x1;
+
+  if ( si->redraw )
+    {
+      *first = 0;
+      *last = si->x_size - 1;
+      return true;
+    }
+
+  for ( x0 = 0;
+        x0 < si->x_size && SCREEN_CELL_EQ( back[ x0 ], front[ x0 ] );
+        x0++ );
+
+  if ( x0 == si->x_size )
+    return false;
+
+  for ( x1 = si->x_size - 1;
+        SCREEN_CELL_EQ( back[ x1 ], front[ x1 ] );
+        x1-- );
+
+  /* Wide characters are output whole. */
+  while ( x0 > 0 && back[ x0 ].cont )
+    x0--;
+  while ( x1 + 1 < si->x_size && back[ x1 + 1 ].cont )
+    x1++;
+
+  *first = x0;
+  *last = x1;
+
+  return true;
+}
+
+
+/**
+ * Dump offline buffer to the screen. Only the rows that are marked
+ * changed are compared to the on-screen content, and only the
+ * changed part of row is output.
  *
  *
  * @param si Screen info.
@@ -975,55 +1641,145 @@ int screen_set_color_str( win_info* wi, char* str, int color )
 /* autoc:c_func_decl:screen_dump */
 void screen_dump( screen_info* si )
 {
+  int first, last;
+  int64_t frame_bytes = 0;
 
-#ifdef USE_TERMBOX
+#if defined( SCREEN_NULL )
 
-  uint16_t fg, bg;
+  /* Buffers are compared and updated, but nothing is output. */
+  for ( int y = 0; y < si->y_size; y++ )
+    {
+      if ( !si->dirty[ y ] && !si->redraw )
+        continue;
+
+      si->dirty[ y ] = 0;
+
+      if ( !screen_row_changes( si, y, &first, &last ) )
+        continue;
+
+      stats.rows++;
+      frame_bytes += last - first + 1;
+
+      mc_memcpy( &si->buf[ BUFI(first,y) ],
+                 &si->front[ BUFI(first,y) ],
+                 ( last - first + 1 ) * sizeof( char_info ) );
+    }
+
+#elif defined( USE_TERMBOX )
+
+  struct tb_cell run[ SCREEN_RUN_SIZE ];
+  char_info* cell;
+  int len;
 
   for ( int y = 0; y < si->y_size; y++ )
     {
-      for ( int x = 0; x < si->x_size; x++ )
+      if ( !si->dirty[ y ] && !si->redraw )
+        continue;
+
+      si->dirty[ y ] = 0;
+
+      if ( !screen_row_changes( si, y, &first, &last ) )
+        continue;
+
+      stats.rows++;
+      frame_bytes += last - first + 1;
+
+      /* Changed span is passed to termbox in runs of cells. Termbox
+         skips the continuation cell of wide character itself. */
+      for ( int x = first; x <= last; x += len )
         {
-          if ( si->color )
-            {
-              fg = scr_color_table[ si->buf[ BUFI(x,y) ].color ].fg;
-              bg = scr_color_table[ si->buf[ BUFI(x,y) ].color ].bg;
-            }
-          else
+          len = last - x + 1;
+          if ( len > SCREEN_RUN_SIZE )
+            len = SCREEN_RUN_SIZE;
+
+          for ( int i = 0; i < len; i++ )
             {
-              fg = scr_color_table[ SCR_COLOR_DEFAULT ].fg;
-              bg = scr_color_table[ SCR_COLOR_DEFAULT ].bg;
+              cell = &si->buf[ BUFI(x+i,y) ];
+              run[ i ].ch = ( cell->ch && !cell->cont ) ? cell->ch : ' ';
+              run[ i ].fg = scr_color_table[ si->color ? cell->color : SCR_COLOR_DEFAULT ].fg;
+              run[ i ].bg = scr_color_table[ si->color ? cell->color : SCR_COLOR_DEFAULT ].bg;
             }
-          tb_change_cell( x, y, si->buf[ BUFI(x,y) ].ch, fg, bg );
+
+          tb_blit( x, y, len, 1, run );
         }
+
+      mc_memcpy( &si->buf[ BUFI(first,y) ],
+                 &si->front[ BUFI(first,y) ],
+                 ( last - first + 1 ) * sizeof( char_info ) );
     }
 
 # else
 
-  int y;
-  char tmpstr[ 1024 ];
+  char tmpstr[ 4 * SCREEN_RUN_SIZE ];
+  char_info* cell;
+  int start, bytes;
 
-  for ( y = 0; y < si->y_size; y++ )
+  for ( int y = 0; y < si->y_size; y++ )
     {
+      if ( !si->dirty[ y ] && !si->redraw )
+        continue;
+
+      si->dirty[ y ] = 0;
+
+      if ( !screen_row_changes( si, y, &first, &last ) )
+        continue;
+
+      stats.rows++;
+
       if ( si->color && ( y == screen_status_line ) )
         attron( COLOR_PAIR( SCR_COLOR_GREEN ) );
 
-      for ( int x = 0; x < si->x_size; x++ )
-        tmpstr[ x ] = si->buf[ BUFI(x,y) ].ch;
+      /* Changed span is encoded and output in runs. */
+      for ( int x = first; x <= last; )
+        {
+          /* Run starts at character, i.e. continuation cells of wide
+             character at the end of previous run are skipped. */
+          while ( x <= last && screen_utf8 && si->buf[ BUFI(x,y) ].cont )
+            x++;
+          if ( x > last )
+            break;
+
+          start = x;
+          bytes = 0;
+
+          for ( ; x <= last && bytes <= sizeof( tmpstr ) - 4; x++ )
+            {
+              cell = &si->buf[ BUFI(x,y) ];
 
-      mvaddnstr( y, 0, tmpstr, si->x_size );
+              if ( cell->cont && screen_utf8 )
+                /* Terminal moves over wide character. */
+                continue;
+
+              /* Cleared cells are blank. */
+              bytes += screen_char_encode( cell->ch ? cell->ch : ' ',
+                                           &tmpstr[ bytes ] );
+            }
+
+          mvaddnstr( y, start, tmpstr, bytes );
+          frame_bytes += bytes;
+        }
 
       if ( si->color && ( y == screen_status_line ) )
         attroff( COLOR_PAIR( SCR_COLOR_GREEN ) );
+
+      mc_memcpy( &si->buf[ BUFI(first,y) ],
+                 &si->front[ BUFI(first,y) ],
+                 ( last - first + 1 ) * sizeof( char_info ) );
     }
 
 #endif
 
+  si->redraw = false;
+
+  stats.bytes += frame_bytes;
+  if ( frame_bytes > stats.frame_bytes_max )
+    stats.frame_bytes_max = frame_bytes;
 }
 
 
 /**
- * Refresh the current view.
+ * Refresh the current view. Only the changes after previous refresh
+ * are sent to terminal.
  *
  *
  * @param wi Window info.
@@ -1034,9 +1790,12 @@ void screen_refresh( win_info* wi )
   if ( wi->refresh )
     {
 
-#ifdef USE_TERMBOX
+#if defined( SCREEN_NULL )
+
+      screen_dump( wi->si );
+
+#elif defined( USE_TERMBOX )
 
-      tb_clear();
       screen_dump( wi->si );
       tb_set_cursor( wi->si->x_min + wi->x_min + wi->x,
                      wi->si->y_min + wi->y_min + wi->y );
@@ -1044,36 +1803,210 @@ void screen_refresh( win_info* wi )
 
 # else
 
-      erase();
+      screen_locale_enter();
       screen_dump( wi->si );
       dbug( "screen_refresh: x %d, y %d\n", wi->x, wi->y );
       move( wi->si->y_min + wi->y_min + wi->y,
             wi->si->x_min + wi->x_min + wi->x );
       refresh();
+      screen_locale_leave();
 
 #endif
 
+      clock_gettime( CLOCK_MONOTONIC, &screen_frame_time );
+
+      stats.frames++;
+      if ( stats.key_time )
+        {
+          /* First refresh after key press. */
+          stats.paints++;
+          stats_time_add( &stats.latency, &stats.latency_max, stats.key_time );
+          stats.key_time = 0;
+        }
     }
 }
 
 
 /**
- * Return a key press.
+ * Check if user input is waiting, i.e. next screen_get_key returns
+ * without blocking. The key is not consumed.
+ *
+ *
+ * @return True if key is pending.
+ */
+/* autoc:c_func_decl:screen_key_pending */
+bool_t screen_key_pending( void )
+{
+
+#if defined( SCREEN_NULL )
+
+  return ( screen_script && *screen_script );
+
+#elif defined( USE_TERMBOX )
+
+  if ( screen_event_pending )
+    return true;
+
+  if ( tb_peek_event( &screen_pending_event, 0 ) > 0 )
+    screen_event_pending = true;
+
+  return screen_event_pending;
+
+#else
+
+  int key;
+
+  nodelay( stdscr, TRUE );
+  key = getch();
+  nodelay( stdscr, FALSE );
+
+  if ( key == ERR )
+    return false;
+
+  ungetch( key );
+  return true;
+
+#endif
+
+}
+
+
+/**
+ * Return a key press if user input is waiting, without blocking and
+ * without idle callback (see screen_idle). This is used for
+ * cancellation checks while background work is running. Window
+ * resize is left pending for screen_get_key.
+ *
+ *
+ * @return Key value (or -1 if no key is pending).
+ */
+/* autoc:c_func_decl:screen_poll_key */
+int screen_poll_key( void )
+{
+
+#if defined( SCREEN_NULL )
+
+  /* Script keys are for screen_get_key. */
+  return -1;
+
+#elif defined( USE_TERMBOX )
+
+  struct tb_event* event = &screen_pending_event;
+
+  if ( !screen_event_pending )
+    {
+      if ( tb_peek_event( event, 0 ) <= 0 )
+        return -1;
+      screen_event_pending = true;
+    }
+
+  if ( event->type == TB_EVENT_RESIZE )
+    return -1;
+
+  screen_event_pending = false;
+
+  if ( event->key == 0 )
+    return event->ch;
+  else if ( event->key == TB_KEY_ENTER )
+    return NEWLINE;
+  else
+    return event->key;
+
+#else
+
+  int key;
+
+  nodelay( stdscr, TRUE );
+  screen_locale_enter();
+  key = getch();
+  screen_locale_leave();
+  nodelay( stdscr, FALSE );
+
+  if ( key == ERR )
+    return -1;
+
+  if ( key == KEY_RESIZE )
+    {
+      ungetch( key );
+      return -1;
+    }
+
+  return key;
+
+#endif
+
+}
+
+
+/**
+ * Check if screen refresh can be skipped for now. Refresh is skipped
+ * when more user input is pending and the previous refresh was done
+ * less than screen_frame_interval ago. Hence keys are processed in a
+ * batch, e.g. when keys are autorepeated or pasted, and the screen is
+ * refreshed at most once per frame interval.
+ *
+ *
+ * @return True if refresh can be skipped.
+ */
+/* autoc:c_func_decl:screen_skip_refresh */
+bool_t screen_skip_refresh( void )
+{
+  struct timespec now;
+  int64_t elapsed;
+
+  if ( !screen_key_pending() )
+    return false;
+
+  clock_gettime( CLOCK_MONOTONIC, &now );
+  elapsed = ( now.tv_sec - screen_frame_time.tv_sec ) * 1000 +
+    ( now.tv_nsec - screen_frame_time.tv_nsec ) / 1000000;
+
+  return ( elapsed < screen_frame_interval );
+}
+
+
+/**
+ * Read a key press from terminal (or script).
  *
  *
  * @return Key value.
  */
-/* autoc:c_func_decl:screen_get_key */
-int screen_get_key( void )
+static int screen_read_key( void )
 {
 
-#ifdef USE_TERMBOX
+#if defined( SCREEN_NULL )
+
+  /* Quit when script is exhausted. */
+  if ( !screen_script || !*screen_script )
+    return 'q';
+
+  return (uchar) *screen_script++;
+
+#elif defined( USE_TERMBOX )
 
   int key;
   struct tb_event event;
   for (;;)
     {
-      tb_poll_event( &event );
+      if ( screen_event_pending )
+        {
+          /* Event was read ahead. */
+          event = screen_pending_event;
+          screen_event_pending = false;
+        }
+      else if ( screen_idle )
+        {
+          /* Wait key for limited time and let idle callback work. */
+          if ( tb_peek_event( &event, screen_idle_timeout ) <= 0 )
+            {
+              screen_idle( screen_idle_context );
+              continue;
+            }
+        }
+      else
+        {
+          tb_poll_event( &event );
+        }
 
       if ( event.type == TB_EVENT_RESIZE )
         {
@@ -1132,7 +2065,27 @@ int screen_get_key( void )
 
   for (;;)
     {
-      key = getch();
+      if ( screen_idle )
+        {
+          /* Wait key for limited time and let idle callback work. */
+          timeout( screen_idle_timeout );
+          screen_locale_enter();
+          key = getch();
+          screen_locale_leave();
+          timeout( -1 );
+
+          if ( key == ERR )
+            {
+              screen_idle( screen_idle_context );
+              continue;
+            }
+        }
+      else
+        {
+          screen_locale_enter();
+          key = getch();
+          screen_locale_leave();
+        }
 
       if ( key == KEY_RESIZE )
         {
@@ -1141,8 +2094,10 @@ int screen_get_key( void )
           if ( screen_pre_win_resize )
             screen_pre_win_resize( screen_win_resize_context );
 
+          screen_locale_enter();
           clear();
           refresh();
+          screen_locale_leave();
           screen_update_geom( si );
 
           /* Update all living window geometries. */
@@ -1177,6 +2132,26 @@ int screen_get_key( void )
 }
 
 
+/**
+ * Return a key press. Key press time is recorded for key to paint
+ * latency (see stats).
+ *
+ *
+ * @return Key value.
+ */
+/* autoc:c_func_decl:screen_get_key */
+int screen_get_key( void )
+{
+  int key = screen_read_key();
+
+  stats.keys++;
+  if ( stats.key_time == 0 )
+    stats.key_time = stats_now();
+
+  return key;
+}
+
+
 /**
  * Update status line with str.
  *
@@ -1188,9 +2163,11 @@ void screen_set_status( char* str )
 {
   for ( int i = 0; i < strlen(str); i++ )
     {
-      si->buf[ BUFI(0+i,screen_status_line) ].ch = str[ i ];
+      si->buf[ BUFI(0+i,screen_status_line) ].ch = (uchar) str[ i ];
+      si->buf[ BUFI(0+i,screen_status_line) ].cont = 0;
       si->buf[ BUFI(0+i,screen_status_line) ].color = SCR_COLOR_GREEN;
     }
+  DIRTY( si, screen_status_line );
 }
 
 
@@ -1209,8 +2186,10 @@ void screen_set_status_with_color( char_info* str, int len )
   for ( int i = 0; i < len; i++ )
     {
       si->buf[ BUFI(0+i,screen_status_line) ].ch = str[ i ].ch;
+      si->buf[ BUFI(0+i,screen_status_line) ].cont = str[ i ].cont;
       si->buf[ BUFI(0+i,screen_status_line) ].color = str[ i ].color;
     }
+  DIRTY( si, screen_status_line );
 }
 
 #endif
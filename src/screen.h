@@ -18,6 +18,7 @@
 #endif
 
 #include <signal.h>
+#include <stdint.h>
 #include "ll.h"
 
 
@@ -51,15 +52,51 @@ extern screen_char_def_t screen_default_char_map[];
 
 /**
  * Character info in the screen. Includes color info and character
- * code.
+ * code (Unicode codepoint), packed to 32 bits. Wide character
+ * occupies two cells and the second cell is marked as continuation.
  */
 
 typedef struct char_info_s {
-  uchar color;  /**< Fore/background color code. */
-  char ch;      /**< Character value. */
+  uint32_t ch : 21;     /**< Character value (codepoint). */
+  uint32_t cont : 1;    /**< Continuation of wide character (not output). */
+  uint32_t color : 10;  /**< Fore/background color code. */
 } char_info;
 
 
+/** Text length for null terminated text of unknown length. */
+#define SCREEN_TEXT_NUL ((size_t) -1)
+
+/** Display column interval of text layout stops. */
+#define SCREEN_TEXT_STRIDE 256
+
+
+/** Text layout stop, i.e. character boundary and its display column. */
+typedef struct screen_text_stop_s {
+  size_t pos;   /**< Byte position. */
+  size_t col;   /**< Display column. */
+} screen_text_stop_t;
+
+
+/**
+ * Display layout of text (line), which is extended lazily upto the
+ * displayed columns (see screen_set_text), i.e. text is decoded at
+ * most once and only as far as it has been displayed. Layout includes
+ * the plain prefix (one byte per column) and stops after plain prefix
+ * at intervals of SCREEN_TEXT_STRIDE columns, i.e. rendering from any
+ * column starts at the nearest preceding stop, instead of decoding
+ * text from the beginning.
+ */
+typedef struct screen_text_s {
+  size_t plain;                /**< Plain prefix length (of scanned part). */
+  size_t pos;                  /**< Scanned byte position. */
+  size_t col;                  /**< Display column of scanned position. */
+  bool_t end;                  /**< Text is scanned to the end. */
+  screen_text_stop_t* stops;   /**< Stops (or NULL if none). */
+  size_t stop_cnt;             /**< Stop count. */
+  size_t stop_size;            /**< Stop storage size. */
+} screen_text_t;
+
+
 /**
  * @{
  * Colors for screen text. */
@@ -88,7 +125,10 @@ typedef struct screen_info_s {
   int y_size;      /**< Size in y-coord. */
   int size;        /**< Screen area (x*y). */
 
-  char_info* buf;  /**< Off-screen buffer. */
+  char_info* buf;  /**< Off-screen buffer (back buffer). */
+  char_info* front; /**< On-screen content, i.e. buffer at last dump. */
+  uchar* dirty;    /**< Rows changed in off-screen buffer after last dump. */
+  bool_t redraw;   /**< Dump all rows at next dump (e.g. after resize). */
   bool_t color;    /**< Screen enables colors. */
 
 } screen_info;
@@ -180,6 +220,25 @@ extern screen_callback screen_post_win_resize;
 /** Callback which is for fatal errors. */
 extern screen_fatal_callback screen_fatal_error;
 
+/**
+   Callback which is called repeatedly while waiting for a key press
+   (or NULL). Callback is called after each screen_idle_timeout
+   period without key press.
+*/
+extern screen_callback screen_idle;
+
+/** Data passed for screen_idle callback. */
+extern void* screen_idle_context;
+
+/** Key wait time (ms) before screen_idle callback is called. */
+extern int screen_idle_timeout;
+
+/**
+   Minimum time (ms) between screen refreshes, when user input is
+   pending (see screen_skip_refresh).
+*/
+extern int screen_frame_interval;
+
 /** Status line position (default: -1, i.e. not existing). */
 extern int screen_status_line;
 
@@ -187,6 +246,14 @@ extern int screen_status_line;
 /** Global screen handle. */
 extern screen_info* si;
 
+#ifdef SCREEN_NULL
+/**
+   Key presses for null backend (null terminated string). Each char is
+   one key and 'q' is returned when keys are exhausted.
+*/
+extern const char* screen_script;
+#endif
+
 /** Prototypes: */
 
 /* autoc:c_func_decl:begin */
@@ -207,8 +274,15 @@ bool_t screen_at_win_y_start( win_info * wi );
 bool_t screen_inside( screen_info * si, int x, int y );
 bool_t screen_setpos( win_info * wi, int x, int y );
 int screen_set_str2( win_info * wi, const char * str );
+void screen_text_init( screen_text_t * layout );
+void screen_text_free( screen_text_t * layout );
+void screen_text_reset( screen_text_t * layout );
+int screen_set_text( win_info * wi, const char * str, size_t len, size_t skip, screen_text_t * layout, int color );
 void screen_dump( screen_info * si );
 void screen_refresh( win_info * wi );
+bool_t screen_key_pending( void );
+int screen_poll_key( void );
+bool_t screen_skip_refresh( void );
 int screen_get_key( void );
 void screen_set_status( char * str );
 int screen_win_x_size( win_info * wi );
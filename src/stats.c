@@ -0,0 +1,136 @@
+/**
+ * @file stats.c
+ *
+ * Runtime statistics. Counters are plain increments at hot paths
+ * (per call, not per line), and times are taken from monotonic
+ * clock, hence statistics are always collected. Report is output
+ * only on request.
+ *
+ */
+
+
+#include "config.h"
+
+#include "mc.h"
+#include "global.h"
+#include "stats.h"
+
+#include <time.h>
+
+
+stats_t stats;
+
+
+/** Nanoseconds to milliseconds. */
+#define STATS_MS(ns) ( (double) (ns) / 1e6 )
+
+/** Nanoseconds to seconds. */
+#define STATS_S(ns) ( (double) (ns) / 1e9 )
+
+
+/**
+ * Return monotonic time in nanoseconds.
+ *
+ * @return Time.
+ */
+int64_t stats_now( void ) /*acfd*/
+{
+  struct timespec now;
+
+  clock_gettime( CLOCK_MONOTONIC, &now );
+
+  return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+
+/**
+ * Add time elapsed after start to total (and update maximum).
+ *
+ * @param total Total time.
+ * @param max Maximum time (or NULL).
+ * @param start Start time.
+ *
+ * @return Elapsed time.
+ */
+int64_t stats_time_add( int64_t* total, int64_t* max, int64_t start ) /*acfd*/
+{
+  int64_t elapsed = stats_now() - start;
+
+  *total += elapsed;
+  if ( max && elapsed > *max )
+    *max = elapsed;
+
+  return elapsed;
+}
+
+
+/**
+ * Return average of total over count (0 if no count).
+ *
+ * @param total Total.
+ * @param count Count.
+ *
+ * @return Average.
+ */
+static double stats_avg( int64_t total, int64_t count )
+{
+  return count > 0 ? (double) total / count : 0.0;
+}
+
+
+/**
+ * Output statistics report for humans.
+ *
+ * @param fh Output stream.
+ */
+void stats_report( FILE* fh ) /*acfd*/
+{
+  fprintf( fh, "Take statistics:\n" );
+  fprintf( fh, "  input:    %ld lines, %ld bytes, load %.3f s\n",
+           (long) stats.input_lines, (long) stats.input_bytes,
+           STATS_S( stats.load_time ) );
+  fprintf( fh, "  match:    %ld lines, %.3f s\n",
+           (long) stats.match_lines, STATS_S( stats.match_time ) );
+  fprintf( fh, "  screen:   %ld frames, %.1f rows/frame, %.1f bytes/frame (max %ld)\n",
+           (long) stats.frames,
+           stats_avg( stats.rows, stats.frames ),
+           stats_avg( stats.bytes, stats.frames ),
+           (long) stats.frame_bytes_max );
+  fprintf( fh, "  keys:     %ld keys, key to paint %.3f ms (max %.3f ms)\n",
+           (long) stats.keys,
+           STATS_MS( stats_avg( stats.latency, stats.paints ) ),
+           STATS_MS( stats.latency_max ) );
+  fprintf( fh, "  commands: %ld started, fork/exec %.3f ms (max %.3f ms), wait %.3f s\n",
+           (long) stats.execs,
+           STATS_MS( stats_avg( stats.exec_time, stats.execs ) ),
+           STATS_MS( stats.exec_time_max ),
+           STATS_S( stats.wait_time ) );
+  fprintf( fh, "  total:    %.3f s\n", STATS_S( stats_now() - stats.start ) );
+}
+
+
+/**
+ * Output statistics as one line JSON object (times are in
+ * nanoseconds).
+ *
+ * @param fh Output stream.
+ */
+void stats_report_json( FILE* fh ) /*acfd*/
+{
+  fprintf( fh,
+           "{\"input_lines\":%ld,\"input_bytes\":%ld,\"load_ns\":%ld,"
+           "\"match_lines\":%ld,\"match_ns\":%ld,"
+           "\"frames\":%ld,\"rows\":%ld,\"bytes\":%ld,\"frame_bytes_max\":%ld,"
+           "\"keys\":%ld,\"paints\":%ld,\"latency_ns\":%ld,\"latency_max_ns\":%ld,"
+           "\"execs\":%ld,\"exec_ns\":%ld,\"exec_max_ns\":%ld,\"wait_ns\":%ld,"
+           "\"total_ns\":%ld}\n",
+           (long) stats.input_lines, (long) stats.input_bytes, (long) stats.load_time,
+           (long) stats.match_lines, (long) stats.match_time,
+           (long) stats.frames, (long) stats.rows, (long) stats.bytes,
+           (long) stats.frame_bytes_max,
+           (long) stats.keys, (long) stats.paints, (long) stats.latency,
+           (long) stats.latency_max,
+           (long) stats.execs, (long) stats.exec_time, (long) stats.exec_time_max,
+           (long) stats.wait_time,
+           (long) ( stats_now() - stats.start ) );
+}
@@ -0,0 +1,51 @@
+#ifndef STATS_H
+#define STATS_H
+
+/**
+ * @file stats.h
+ *
+ * Runtime statistics defs.
+ */
+
+
+#include <stdio.h>
+#include <stdint.h>
+
+
+/** Runtime statistics, i.e. counters and times (ns) of hot paths. */
+typedef struct stats_s {
+  int64_t start;            /**< Statistics start time. */
+  int64_t input_bytes;      /**< Input size (bytes, not for directory listing). */
+  int64_t input_lines;      /**< Input line count. */
+  int64_t load_start;       /**< Input load start time. */
+  int64_t load_time;        /**< Input load time (until input is complete). */
+  int64_t match_lines;      /**< Lines evaluated by matchers. */
+  int64_t match_time;       /**< Time spent in matching. */
+  int64_t frames;           /**< Screen refreshes. */
+  int64_t rows;             /**< Rows redrawn. */
+  int64_t bytes;            /**< Bytes sent to terminal (cell content). */
+  int64_t frame_bytes_max;  /**< Maximum bytes sent per frame. */
+  int64_t keys;             /**< Key presses. */
+  int64_t key_time;         /**< First unpainted key press time (0 if none). */
+  int64_t paints;           /**< Key presses followed by refresh. */
+  int64_t latency;          /**< Total key to paint latency. */
+  int64_t latency_max;      /**< Maximum key to paint latency. */
+  int64_t execs;            /**< Started commands. */
+  int64_t exec_time;        /**< Total command start (fork/exec) time. */
+  int64_t exec_time_max;    /**< Maximum command start time. */
+  int64_t wait_time;        /**< Time waiting for running commands. */
+} stats_t;
+
+
+/** Global statistics. */
+extern stats_t stats;
+
+
+/* autoc:c_func_decl:begin */
+int64_t stats_now( void );
+int64_t stats_time_add( int64_t* total, int64_t* max, int64_t start );
+void stats_report( FILE* fh );
+void stats_report_json( FILE* fh );
+/* autoc:c_func_decl:end */
+
+#endif
@@ -0,0 +1,259 @@
+/**
+ * @file strset.c
+ *
+ * String hash set. Strings are copied to an arena and referenced from
+ * an open addressing table (linear probing) with the string hashes,
+ * i.e. strings are compared only when hashes are equal. Large line
+ * ranges are looked up in parallel by workers.
+ *
+ */
+
+
+#include "mc.h"
+#include "global.h"
+#include "worker.h"
+#include "pathtree.h"
+#include "strset.h"
+
+#include <string.h>
+
+
+/** Parallel marking state. */
+typedef struct strset_job_s {
+  strset_t* set;           /**< Hash set. */
+  char** texts;            /**< Line texts (or leaf refs). */
+  const pathtree_t* paths; /**< Path tree for texts (or NULL). */
+  mc_size_t begin;         /**< Mark range start. */
+  mc_size_t end;           /**< Mark range end (exclusive). */
+  mc_size_t base;          /**< First chunk start (aligned). */
+  mcb_p marks;             /**< Marks for lines. */
+} strset_job_t;
+
+
+/**
+ * Return hash for string (FNV-1a).
+ *
+ * @param str String.
+ * @param len String length.
+ *
+ * @return Hash.
+ */
+static inline uint64_t strset_hash( const char* str, mc_size_t len )
+{
+  uint64_t hash = 0xcbf29ce484222325ULL;
+
+  for ( mc_size_t i = 0; i < len; i++ )
+    {
+      hash ^= (unsigned char) str[ i ];
+      hash *= 0x100000001b3ULL;
+    }
+
+  return hash;
+}
+
+
+/**
+ * Return slot for string, i.e. slot with the string or the free slot
+ * where the string belongs to.
+ *
+ * @param set Hash set.
+ * @param str String.
+ * @param len String length.
+ * @param hash String hash.
+ *
+ * @return Slot.
+ */
+static strset_slot_t* strset_find( strset_t* set, const char* str,
+                                   mc_size_t len, uint64_t hash )
+{
+  mc_size_t mask = set->size - 1;
+  strset_slot_t* slot;
+
+  for ( mc_size_t i = hash & mask; ; i = ( i + 1 ) & mask )
+    {
+      slot = &set->slots[ i ];
+      if ( !slot->str
+           || ( slot->hash == hash
+                && !memcmp( slot->str, str, len )
+                && slot->str[ len ] == 0 ) )
+        return slot;
+    }
+}
+
+
+/**
+ * Double the slot count.
+ *
+ * @param set Hash set.
+ */
+static void strset_grow( strset_t* set )
+{
+  strset_slot_t* old = set->slots;
+  mc_size_t size = set->size;
+  mc_size_t mask;
+  mc_size_t j;
+
+  set->size *= 2;
+  set->slots = mc_new_n( strset_slot_t, set->size );
+  memset( set->slots, 0, set->size * sizeof( strset_slot_t ) );
+  mask = set->size - 1;
+
+  for ( mc_size_t i = 0; i < size; i++ )
+    {
+      if ( !old[ i ].str )
+        continue;
+
+      for ( j = old[ i ].hash & mask; set->slots[ j ].str; j = ( j + 1 ) & mask )
+        ;
+      set->slots[ j ] = old[ i ];
+    }
+
+  mc_free( old );
+}
+
+
+/**
+ * Create empty hash set.
+ *
+ * @return Hash set.
+ */
+strset_t* strset_new( void ) /*acfd*/
+{
+  strset_t* set;
+
+  set = mc_new( strset_t );
+  set->size = STRSET_INIT_SIZE;
+  set->used = 0;
+  set->slots = mc_new_n( strset_slot_t, set->size );
+  memset( set->slots, 0, set->size * sizeof( strset_slot_t ) );
+  set->arena = mca_new();
+
+  return set;
+}
+
+
+/**
+ * Free hash set and its strings.
+ *
+ * @param set Hash set.
+ */
+void strset_del( strset_t* set ) /*acfd*/
+{
+  mca_del( set->arena );
+  mc_free( set->slots );
+  mc_free( set );
+}
+
+
+/**
+ * Add string to set (string is copied).
+ *
+ * @param set Hash set.
+ * @param str String (not necessarily null terminated).
+ * @param len String length.
+ *
+ * @return True if string was new.
+ */
+bool_t strset_add( strset_t* set, const char* str, mc_size_t len ) /*acfd*/
+{
+  uint64_t hash = strset_hash( str, len );
+  strset_slot_t* slot;
+
+  slot = strset_find( set, str, len, hash );
+  if ( slot->str )
+    return mc_false;
+
+  slot->hash = hash;
+  slot->str = mca_strndup( set->arena, str, len );
+  set->used++;
+
+  /* Keep load factor at most 1/2, i.e. probe sequences short. */
+  if ( set->used * 2 > set->size )
+    strset_grow( set );
+
+  return mc_true;
+}
+
+
+/**
+ * Return true if set includes string.
+ *
+ * @param set Hash set.
+ * @param str String.
+ */
+bool_t strset_has( strset_t* set, const char* str ) /*acfd*/
+{
+  mc_size_t len = strlen( str );
+
+  return strset_find( set, str, len, strset_hash( str, len ) )->str != NULL;
+}
+
+
+/**
+ * Mark lines of one chunk (worker task). Chunks are aligned to
+ * bitarr words, hence workers never update the same mark word.
+ *
+ * @param context Marking job.
+ * @param worker Worker index.
+ * @param task Chunk index.
+ */
+static void strset_mark_chunk( void* context, int worker, int task )
+{
+  strset_job_t* job = context;
+  char* text_buf = NULL;
+  mc_size_t text_size = 0;
+  const char* text;
+  mc_size_t start, begin, end;
+
+  start = job->base + (mc_size_t) task * STRSET_CHUNK;
+  begin = ( start < job->begin ) ? job->begin : start;
+  end = start + STRSET_CHUNK;
+  if ( end > job->end )
+    end = job->end;
+
+  for ( mc_size_t i = begin; i < end; i++ )
+    {
+      if ( job->paths )
+        text = pathtree_text( job->paths, job->texts[ i ], &text_buf, &text_size );
+      else
+        text = job->texts[ i ];
+      if ( strset_has( job->set, text ) )
+        mcb_set( job->marks, i );
+    }
+
+  if ( text_buf )
+    mc_free( text_buf );
+}
+
+
+/**
+ * Mark lines in range [begin,end) that are included in set.
+ *
+ * @param set Hash set.
+ * @param texts Line texts (or leaf refs of path tree).
+ * @param paths Path tree (or NULL).
+ * @param begin Range start.
+ * @param end Range end (exclusive).
+ * @param marks Marks for lines (size at least end).
+ */
+void strset_mark( strset_t* set, char** texts, const pathtree_t* paths,
+                  mc_size_t begin, mc_size_t end,
+                  mcb_p marks ) /*acfd*/
+{
+  strset_job_t job;
+  int tasks;
+
+  if ( begin >= end || set->used == 0 )
+    return;
+
+  job.set = set;
+  job.texts = texts;
+  job.paths = paths;
+  job.begin = begin;
+  job.end = end;
+  job.base = begin - ( begin % STRSET_CHUNK );
+  job.marks = marks;
+
+  tasks = (int) ( ( end - job.base + STRSET_CHUNK - 1 ) / STRSET_CHUNK );
+  worker_run( worker_count( tasks ), tasks, strset_mark_chunk, &job );
+}
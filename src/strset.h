@@ -0,0 +1,51 @@
+#ifndef STRSET_H
+#define STRSET_H
+
+/**
+ * @file strset.h
+ *
+ * String hash set defs.
+ */
+
+
+#include "mc.h"
+#include "mca.h"
+#include "mcb.h"
+#include "global.h"
+#include "pathtree.h"
+
+#include <stdint.h>
+
+
+/** Initial slot count (power of 2). */
+#define STRSET_INIT_SIZE 1024
+
+/** Lines per parallel marking task (multiple of bitarr word bits). */
+#define STRSET_CHUNK (64*1024)
+
+
+/** Hash set slot. */
+typedef struct strset_slot_s {
+  uint64_t hash;     /**< String hash. */
+  char* str;         /**< String (NULL for free slot). */
+} strset_slot_t;
+
+
+/** Open addressing (linear probing) hash set of strings. */
+typedef struct strset_s {
+  strset_slot_t* slots;  /**< Slots (size). */
+  mc_size_t size;        /**< Slot count (power of 2). */
+  mc_size_t used;        /**< String count. */
+  mca_p arena;           /**< Storage for strings. */
+} strset_t;
+
+
+/* autoc:c_func_decl:begin */
+strset_t* strset_new( void );
+void strset_del( strset_t* set );
+bool_t strset_add( strset_t* set, const char* str, mc_size_t len );
+bool_t strset_has( strset_t* set, const char* str );
+void strset_mark( strset_t* set, char** texts, const pathtree_t* paths, mc_size_t begin, mc_size_t end, mcb_p marks );
+/* autoc:c_func_decl:end */
+
+#endif
@@ -0,0 +1,239 @@
+/**
+ * @file strsort.c
+ *
+ * String sort. Strings are sorted in byte order (as strcmp) with MSD
+ * radix sort on 8 byte prefix keys. Each level sorts the items by
+ * their prefix key at current offset (LSD radix on key bytes), and
+ * items with equal (non-terminated) keys are sorted further at the
+ * next offset. Most of the work is done on the items array
+ * sequentially, and the strings are accessed only once per level,
+ * i.e. there are no indirect accesses per comparison.
+ *
+ * Sort is stable, i.e. equal strings remain in original order.
+ *
+ */
+
+
+#include "mc.h"
+#include "global.h"
+#include "strsort.h"
+
+#include <string.h>
+
+
+/**
+ * Return sort key for string, i.e. 8 first chars as big endian
+ * number. Shorter strings are padded with zeros.
+ *
+ * @param str String.
+ *
+ * @return Key.
+ */
+static inline uint64_t strsort_key( const char* str )
+{
+  uint64_t key = 0;
+
+  for ( int i = 0; i < 8 && str[ i ]; i++ )
+    key |= (uint64_t) (unsigned char) str[ i ] << ( 56 - 8 * i );
+
+  return key;
+}
+
+
+/**
+ * Compare items with keys at offset. Strings are compared only if
+ * keys are same and not terminated.
+ *
+ * @param a First item.
+ * @param b Second item.
+ * @param offset Key offset.
+ *
+ * @return Less than, equal or greater than zero (as strcmp).
+ */
+static inline int strsort_cmp( const strsort_item_t* a, const strsort_item_t* b,
+                               mc_size_t offset )
+{
+  if ( a->key != b->key )
+    return ( a->key < b->key ) ? -1 : 1;
+  else if ( ( a->key & 0xff ) == 0 )
+    return 0;
+  else
+    return strcmp( a->str + offset + 8, b->str + offset + 8 );
+}
+
+
+/**
+ * Insertion sort for small ranges.
+ *
+ * @param items Items with keys at offset.
+ * @param n Item count.
+ * @param offset Key offset.
+ */
+static void strsort_insertion( strsort_item_t* items, mc_size_t n, mc_size_t offset )
+{
+  strsort_item_t item;
+  mc_size_t j;
+
+  for ( mc_size_t i = 1; i < n; i++ )
+    {
+      item = items[ i ];
+      for ( j = i; j > 0 && strsort_cmp( &items[ j-1 ], &item, offset ) > 0; j-- )
+        items[ j ] = items[ j-1 ];
+      items[ j ] = item;
+    }
+}
+
+
+/**
+ * Sort items by keys (LSD radix sort, one pass per key byte). Passes
+ * where all items have the same byte are skipped.
+ *
+ * @param items Items with keys.
+ * @param tmp Temporary storage (n items).
+ * @param n Item count.
+ */
+static void strsort_radix( strsort_item_t* items, strsort_item_t* tmp, mc_size_t n )
+{
+  mc_size_t counts[ 8 ][ 256 ];
+  strsort_item_t* src = items;
+  strsort_item_t* dst = tmp;
+  strsort_item_t* swap;
+  mc_size_t pos, cnt;
+  int shift;
+
+  memset( counts, 0, sizeof( counts ) );
+
+  for ( mc_size_t i = 0; i < n; i++ )
+    {
+      for ( int b = 0; b < 8; b++ )
+        counts[ b ][ ( items[ i ].key >> ( 8 * b ) ) & 0xff ]++;
+    }
+
+  for ( int b = 0; b < 8; b++ )
+    {
+      shift = 8 * b;
+
+      if ( counts[ b ][ ( src[ 0 ].key >> shift ) & 0xff ] == n )
+        continue;
+
+      pos = 0;
+      for ( int c = 0; c < 256; c++ )
+        {
+          cnt = counts[ b ][ c ];
+          counts[ b ][ c ] = pos;
+          pos += cnt;
+        }
+
+      for ( mc_size_t i = 0; i < n; i++ )
+        dst[ counts[ b ][ ( src[ i ].key >> shift ) & 0xff ]++ ] = src[ i ];
+
+      swap = src;
+      src = dst;
+      dst = swap;
+    }
+
+  if ( src != items )
+    memcpy( items, src, n * sizeof( strsort_item_t ) );
+}
+
+
+/**
+ * Sort items by strings at offset.
+ *
+ * @param items Items (strings are at least offset long).
+ * @param tmp Temporary storage (n items).
+ * @param n Item count.
+ * @param offset String offset.
+ */
+static void strsort_range( strsort_item_t* items, strsort_item_t* tmp,
+                           mc_size_t n, mc_size_t offset )
+{
+  mc_size_t begin, end;
+
+  while ( n > 1 )
+    {
+      for ( mc_size_t i = 0; i < n; i++ )
+        items[ i ].key = strsort_key( items[ i ].str + offset );
+
+      if ( n < STRSORT_SMALL )
+        {
+          strsort_insertion( items, n, offset );
+          return;
+        }
+
+      strsort_radix( items, tmp, n );
+
+      /* All keys are same, continue at next offset (no recursion). */
+      if ( items[ 0 ].key == items[ n-1 ].key )
+        {
+          if ( ( items[ 0 ].key & 0xff ) == 0 )
+            return;
+          offset += 8;
+          continue;
+        }
+
+      /* Sort runs of equal keys further. */
+      begin = 0;
+      while ( begin < n )
+        {
+          end = begin + 1;
+          while ( end < n && items[ end ].key == items[ begin ].key )
+            end++;
+
+          if ( end - begin > 1 && ( items[ begin ].key & 0xff ) != 0 )
+            strsort_range( &items[ begin ], &tmp[ begin ], end - begin, offset + 8 );
+
+          begin = end;
+        }
+
+      return;
+    }
+}
+
+
+/**
+ * Sort items by strings (byte order). Sort is stable.
+ *
+ * @param items Items with strings.
+ * @param n Item count.
+ */
+void strsort_items( strsort_item_t* items, mc_size_t n ) /*acfd*/
+{
+  strsort_item_t* tmp;
+
+  if ( n < 2 )
+    return;
+
+  tmp = mc_new_n( strsort_item_t, n );
+  strsort_range( items, tmp, n, 0 );
+  mc_free( tmp );
+}
+
+
+/**
+ * Sort strings (byte order).
+ *
+ * @param strs Strings.
+ * @param n String count.
+ */
+void strsort( char** strs, mc_size_t n ) /*acfd*/
+{
+  strsort_item_t* items;
+
+  if ( n < 2 )
+    return;
+
+  items = mc_new_n( strsort_item_t, n );
+  for ( mc_size_t i = 0; i < n; i++ )
+    {
+      items[ i ].str = strs[ i ];
+      items[ i ].idx = i;
+    }
+
+  strsort_items( items, n );
+
+  for ( mc_size_t i = 0; i < n; i++ )
+    strs[ i ] = items[ i ].str;
+
+  mc_free( items );
+}
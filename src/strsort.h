@@ -0,0 +1,34 @@
+#ifndef STRSORT_H
+#define STRSORT_H
+
+/**
+ * @file strsort.h
+ *
+ * String sort defs.
+ */
+
+
+#include "mc.h"
+#include "global.h"
+
+#include <stdint.h>
+
+
+/** Range size below which insertion sort is used. */
+#define STRSORT_SMALL 32
+
+
+/** Sort item, i.e. string with its prefix key and original index. */
+typedef struct strsort_item_s {
+  uint64_t key;      /**< String prefix at current offset (big endian). */
+  char* str;         /**< String. */
+  mc_size_t idx;     /**< Original position (free for user). */
+} strsort_item_t;
+
+
+/* autoc:c_func_decl:begin */
+void strsort_items( strsort_item_t* items, mc_size_t n );
+void strsort( char** strs, mc_size_t n );
+/* autoc:c_func_decl:end */
+
+#endif
@@ -32,9 +32,22 @@
 #include "mcc.h"
 #include "mcs.h"
 #include "mcp.h"
+#include "mca.h"
+#include "mcb.h"
+#include "mci.h"
 #include "global.h"
 #include "screen.h"
 #include "prompt.h"
+#include "worker.h"
+#include "match.h"
+#include "jobs.h"
+#include "dirlist.h"
+#include "strsort.h"
+#include "strset.h"
+#include "pathtree.h"
+#include "field.h"
+#include "journal.h"
+#include "stats.h"
 
 #ifdef HAVE_UNISTD_H
 # include <unistd.h>
@@ -45,6 +58,30 @@
 #endif
 
 #include <sys/wait.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+
+#ifdef HAVE_MMAP
+# include <sys/mman.h>
+#endif
+
+#ifdef HAVE_POSIX_SPAWN
+# include <spawn.h>
+#endif
+
+#include <poll.h>
+
+#ifdef TAKE_BENCH
+# include <sys/resource.h>
+# ifdef HAVE_MALLINFO2
+#  include <malloc.h>
+# endif
+#endif
+
+
+/** Process environment (passed to commands). */
+extern char** environ;
 
 
 /*
@@ -66,39 +103,137 @@
  *       line_start, line_end, enter, interrupt, kill_line
  *   - Unlimited prompt buffer
  *
- *
- * - Extra feature:
- *   - Long line display (not done yet, 150312_1750)
- *
  */
 
 
 // #define TAKE_SKIP_INTERACTION
 
 
+/** Chunk size for reading input lines. */
+#define TAKE_INPUT_CHUNK (4*1024*1024)
+
+/** Time slot (ms) for reading progressive input between key presses. */
+#define TAKE_LOAD_SLOT 30
+
+/** Block size for reading preselection files. */
+#define TAKE_READ_SIZE (64*1024)
+
+/** Linux limit for a single exec argument (MAX_ARG_STRLEN), which
+    applies to "sh -c" commands. */
+#define TAKE_ARG_STRLEN_MAX (128*1024-1)
+
+/** POSIX minimum for ARG_MAX. */
+#define TAKE_ARG_MAX_MIN 4096
+
+/** Line index stride of file preview, i.e. every Nth line offset
+    is stored. */
+#define TAKE_PREVIEW_STRIDE 64
+
+/** File prefix size that is checked for binary content in preview. */
+#define TAKE_PREVIEW_SNIFF 4096
+
+/** Stream buffer size for command output file. */
+#define TAKE_OUTPUT_BUFFER (1024*1024)
+
+/** Snapshot file identification (see snapshot_header_t). */
+#define TAKE_SNAPSHOT_MAGIC "TAKESNAP"
+
+/** Snapshot file format version. */
+#define TAKE_SNAPSHOT_VERSION 1
+
+/** Exit status when some of the output-commands failed. */
+#define TAKE_EXIT_CMD_FAILURE 2
+
+
 /** Line index type with possibility to have negative indeces (for
     calculation, i.e. not to be used for indexing. */
 typedef int64_t line_index_t;
 
 
-/** Selectable line type. NOTE: Also used for help and command view. */
-typedef struct select_line_s
+/** Mark operation type. */
+typedef enum mark_op_e { mark_set, mark_reset, mark_toggle } mark_op_t;
+
+
+/**
+ * Chunked line reader. Input is read in big chunks to the arena of
+ * Select_lines and the lines are referenced in place, i.e. newlines
+ * are replaced with nulls and no line is copied.
+ */
+typedef struct line_reader_s
+{
+  int fd;            /**< Input file descriptor. */
+  pid_t pid;         /**< Input command process (or 0). */
+  bool_t eof;        /**< Input producer has finished. */
+  char* buf;         /**< Current chunk. */
+  bool_t own;        /**< Chunk is reused and owned by reader (not arena). */
+  mc_size_t size;    /**< Chunk size. */
+  mc_size_t used;    /**< Chunk usage (read bytes). */
+  mc_size_t start;   /**< Start of the unfinished line in chunk. */
+} line_reader_t;
+
+
+/**
+ * Marking rules for preselection. Rules are applied to lines when
+ * they arrive, i.e. also to the lines of progressive input that are
+ * not read yet.
+ */
+typedef struct arrival_rules_s
+{
+  bool_t mark_all;   /**< Mark all lines. */
+  mcp_p patterns;    /**< Mark lines matching any of Matcher objects. */
+  mcp_p undone;      /**< Match rules removed by undo (for redo). */
+  strset_t* names;   /**< Mark lines included in set (or NULL). */
+  mcb_p toggles;     /**< Toggle lines by index. */
+} arrival_rules_t;
+
+
+/**
+ * Display metadata of visible list line. Metadata is kept in a table
+ * slot of the list position, i.e. scrolling keeps the metadata of the
+ * lines that stay visible.
+ */
+typedef struct row_info_s
 {
-  char* text;      /**< Line content. */
-  bool_t marked;   /**< Selected flag. */
-} select_line_t;
+  const char* line;   /**< Stored line (cache key, NULL if not set). */
+  screen_text_t layout; /**< Text layout for horizontal offsets. */
+} row_info_t;
 
 
-/** Collection of selectable lines with viewing info. */
+/**
+ * Collection of selectable lines with viewing info. NOTE: Also used
+ * for help and command view.
+ *
+ * Line content and selection are stored separately. "lines" is an
+ * array of text references (to arena) and "marks" has the selected
+ * flag of each line as a bit.
+ */
 typedef struct select_lines_s
 {
-  mcp_p lines;              /**< Line container. */
+  mcp_p lines;              /**< Line content container. */
+  mcb_p marks;              /**< Line selected flags. */
+  line_index_t marked;      /**< Selected line count (kept in sync with marks). */
+  mca_p arena;              /**< Storage for line content. */
   line_index_t firstline;   /**< First visible line index. */
   line_index_t curline;     /**< Current line index. */
   win_info* list_wi;        /**< Screen window ref. */
   prompt_t* prompt;         /**< Prompt ref. */
   prompt_t* line_status;    /**< Line mode Status. */
   prompt_t* find_status;    /**< Find mode Status. */
+  line_reader_t* reader;    /**< Progressive input (NULL if input is complete). */
+  arrival_rules_t* rules;   /**< Preselection rules (NULL if not active). */
+  mci_p view;               /**< Visible lines (filtering), NULL for all lines. */
+  size_t hscroll;           /**< Horizontal scroll (display columns). */
+  row_info_t* rows;         /**< Metadata table for visible lines (by position). */
+  int row_cnt;              /**< Metadata table size (power of 2). */
+  line_index_t max_lines;   /**< Input line limit (0 for no limit). */
+  int64_t max_bytes;        /**< Input size limit (0 for no limit). */
+  int64_t bytes;            /**< Size of input lines (with newlines). */
+  bool_t limited;           /**< Input was stopped at limit. */
+  pathtree_t* paths;        /**< Shared-prefix line storage (NULL if lines are texts). */
+  char* text;               /**< Text reconstruction buffer (shared-prefix storage). */
+  mc_size_t text_size;      /**< Text buffer size. */
+  field_index_t* fields;    /**< Line fields (NULL without delimiter). */
+  journal_t* journal;       /**< Undo journal for mark operations. */
 } select_lines_t;
 
 
@@ -110,15 +245,34 @@ typedef struct select_lines_s
 /** Lines container. */
 static select_lines_t* sl = NULL;
 
-/** Command list. */
-static select_lines_t* cmds = NULL;
-
 
 
 /** Arbitrary length string buffer. Used from multiple functions. */
 static mcc_p strbuf = NULL;
 
 
+/** Patterns are plain strings (no regex). */
+static bool_t literal_patterns = mc_false;
+
+
+/** Input loading was cancelled by interrupt. */
+static volatile sig_atomic_t list_cancelled = mc_false;
+
+
+/** Output processing command (NULL for default). */
+static char* output_command = NULL;
+
+/** Output selected lines in selection order (instead of line order). */
+static bool_t order_selection = mc_false;
+
+
+/** Report statistics at exit. */
+static bool_t stats_enabled = mc_false;
+
+/** File for statistics (JSON), NULL for stderr. */
+static char* stats_file = NULL;
+
+
 
 /** Default breakpoint. */
 void gdb_break( void ) { return; }
@@ -126,6 +280,11 @@ void gdb_break( void ) { return; }
 
 /* Forward decl. */
 select_lines_t* select_lines_rem( select_lines_t* sl );
+void select_lines_load_close( select_lines_t* sl );
+void select_lines_rules_rem( select_lines_t* sl );
+void select_lines_load_start( select_lines_t* sl, int fd, pid_t pid );
+void select_lines_load_done( select_lines_t* sl );
+void take_error( const char* format, ... );
 
 
 
@@ -141,8 +300,6 @@ void mem_cleanup( void )
   if ( sl )
     select_lines_rem( sl );
 
-  if ( cmds )
-    select_lines_rem( cmds );
 
 #ifdef ml_do_debug
   ml_dbug_close();
@@ -165,6 +322,26 @@ void take_exit( int status )
     {
       si = screen_close( si );
     }
+
+  if ( stats_enabled )
+    {
+      /* Terminal is restored, i.e. report is visible. */
+      FILE* fh;
+
+      if ( !stats_file )
+        stats_report( stderr );
+      else if ( ( fh = fopen( stats_file, "a" ) ) )
+        {
+          stats_report_json( fh );
+          fclose( fh );
+        }
+      else
+        take_error( "Could not open statistics file: %s", stats_file );
+    }
+
+  /* Screen windows are closed, i.e. no list nodes are left. */
+  ll_pool = mca_pool_del( ll_pool );
+
   como_end();
   exit( status );
 }
@@ -210,25 +387,6 @@ void take_error( const char* format, ... )
 }
 
 
-/**
- * Create new line object.
- *
- * @param text Line content.
- *
- * @return Line object.
- */
-select_line_t* select_line_new( char* text )
-{
-  select_line_t* ret;
-
-  ret = mc_new( select_line_t );
-  ret->text = text;
-  ret->marked = mc_false;
-
-  return ret;
-}
-
-
 /**
  * Create Select_lines, i.e. lines container.
  *
@@ -241,6 +399,9 @@ select_lines_t* select_lines_new( void )
   ret = mc_new( select_lines_t );
 
   ret->lines = mcp_new();
+  ret->marks = mcb_new();
+  ret->marked = 0;
+  ret->arena = mca_new();
   ret->firstline = 0;
   ret->curline = 0;
 
@@ -249,6 +410,24 @@ select_lines_t* select_lines_new( void )
   ret->line_status = NULL;
   ret->find_status = NULL;
 
+  ret->reader = NULL;
+  ret->rules = NULL;
+  ret->view = NULL;
+
+  ret->hscroll = 0;
+  ret->rows = NULL;
+  ret->row_cnt = 0;
+
+  ret->max_lines = 0;
+  ret->max_bytes = 0;
+  ret->bytes = 0;
+  ret->limited = mc_false;
+  ret->paths = NULL;
+  ret->text = NULL;
+  ret->text_size = 0;
+  ret->fields = NULL;
+  ret->journal = journal_new();
+
   return ret;
 }
 
@@ -262,14 +441,31 @@ select_lines_t* select_lines_new( void )
  */
 select_lines_t* select_lines_rem( select_lines_t* sl )
 {
-  select_line_t* line;
+  if ( sl->reader )
+    select_lines_load_close( sl );
 
-  mc_for_n( sl->lines->used )
+  if ( sl->rules )
+    select_lines_rules_rem( sl );
+
+  if ( sl->rows )
     {
-      line = sl->lines->data[i];
-      mc_free( line->text );
-      mc_free( line );
+      for ( int i = 0; i < sl->row_cnt; i++ )
+        screen_text_free( &sl->rows[ i ].layout );
+      mc_free( sl->rows );
     }
+
+  if ( sl->fields )
+    field_index_del( sl->fields );
+
+  journal_del( sl->journal );
+
+  /* Line content is all in the arena (or in path tree). */
+  if ( sl->paths )
+    pathtree_del( sl->paths );
+  if ( sl->text )
+    mc_free( sl->text );
+  mca_del( sl->arena );
+  mcb_del( sl->marks );
   mcp_del( sl->lines );
   mc_free( sl );
   return NULL;
@@ -277,18 +473,187 @@ select_lines_t* select_lines_rem( select_lines_t* sl )
 
 
 /**
- * Update line_status label with current line number.
+ * Add line to Select_lines. Text is not copied, and it must remain
+ * valid for the lifetime of Select_lines (e.g. in the arena).
  *
  * @param sl Select_lines object.
+ * @param text Line content.
  */
-void line_status_update( select_lines_t* sl )
+void select_lines_add( select_lines_t* sl, char* text )
+{
+  mcp_append( sl->lines, text );
+  mcb_resize( sl->marks, sl->lines->used );
+}
+
+
+/**
+ * Return line content. With shared-prefix storage the line is
+ * reconstructed to buffer, i.e. content is valid until the buffer is
+ * used again.
+ *
+ * @param sl Select_lines object.
+ * @param idx Line index.
+ * @param buf Text buffer (shared-prefix storage).
+ * @param size Text buffer size.
+ *
+ * @return Line content.
+ */
+static inline char* select_lines_text_buf( select_lines_t* sl, line_index_t idx,
+                                           char** buf, mc_size_t* size )
+{
+  char* text = mcp_nth( sl->lines, idx );
+
+  if ( sl->paths )
+    return pathtree_text( sl->paths, text, buf, size );
+  else
+    return text;
+}
+
+
+/**
+ * Return line content (see select_lines_text_buf()), reconstructed
+ * to the Select_lines buffer.
+ *
+ * @param sl Select_lines object.
+ * @param idx Line index.
+ *
+ * @return Line content.
+ */
+#define select_lines_text(sl,idx) select_lines_text_buf( (sl), (idx), &(sl)->text, &(sl)->text_size )
+
+
+/**
+ * Return line selected status.
+ *
+ * @param sl Select_lines object.
+ * @param idx Line index.
+ *
+ * @return True if selected.
+ */
+#define select_lines_marked(sl,idx) mcb_get( (sl)->marks, (idx) )
+
+
+/**
+ * Return visible line count. With filter view curline and firstline
+ * are positions in the view.
+ *
+ * @param sl Select_lines object.
+ *
+ * @return Line count.
+ */
+#define select_lines_count(sl) ((sl)->view ? (line_index_t) (sl)->view->used : (sl)->lines->used)
+
+
+/**
+ * Return line index for visible line position.
+ *
+ * @param sl Select_lines object.
+ * @param pos Position in view.
+ *
+ * @return Line index.
+ */
+#define select_lines_at(sl,pos) ((sl)->view ? mci_nth( (sl)->view, (pos) ) : (pos))
+
+
+/**
+ * Perform mark operation for lines in range [begin,end). Operation is
+ * recorded to undo journal.
+ *
+ * @param sl Select_lines object.
+ * @param begin Range start.
+ * @param end Range end (exclusive).
+ * @param op Mark operation.
+ */
+void select_lines_mark_range( select_lines_t* sl,
+                              line_index_t begin,
+                              line_index_t end,
+                              mark_op_t op )
+{
+  line_index_t cnt;
+
+  if ( begin < 0 )
+    begin = 0;
+  if ( end > (line_index_t) sl->lines->used )
+    end = sl->lines->used;
+  if ( begin >= end )
+    return;
+
+  if ( op == mark_toggle )
+    {
+      /* Toggle is recorded as range only. */
+      mcb_toggle_range( sl->marks, begin, end );
+      cnt = journal_toggle( sl->journal, sl->marks, begin, end );
+      sl->marked += cnt - ( end - begin - cnt );
+      return;
+    }
+
+  journal_begin( sl->journal, sl->marks, begin, end );
+
+  switch ( op )
+    {
+    case mark_set: mcb_set_range( sl->marks, begin, end ); break;
+    case mark_reset: mcb_clr_range( sl->marks, begin, end ); break;
+    default: break;
+    }
+
+  cnt = journal_end( sl->journal, sl->marks );
+  sl->marked += ( op == mark_set ) ? cnt : -cnt;
+}
+
+
+/**
+ * Return the number of selected lines.
+ *
+ * @param sl Select_lines object.
+ *
+ * @return Selected count.
+ */
+line_index_t select_lines_marked_count( select_lines_t* sl )
+{
+  return sl->marked;
+}
+
+
+/**
+ * Add copy of text as line to Select_lines.
+ *
+ * @param sl Select_lines object.
+ * @param text Line content.
+ */
+void select_lines_add_copy( select_lines_t* sl, const char* text )
+{
+  select_lines_add( sl, mca_strdup( sl->arena, text ) );
+}
+
+
+/**
+ * Set line_status label to line number and line count, with optional
+ * selected line count.
+ *
+ * @param sl Select_lines object.
+ * @param line Line number.
+ * @param total Line count.
+ * @param selected Selected line count (negative for none).
+ * @param more More lines are coming (count is incomplete).
+ */
+void line_status_set( select_lines_t* sl, line_index_t line,
+                      line_index_t total, line_index_t selected, bool_t more )
 {
 
-  /* Create line number display. */
+  /* Create line number display (with line count). Incomplete count
+     is indicated with "+". Selected count is in brackets before. */
+  char count[ 96 ];
+  char* c = count;
+  if ( selected >= 0 )
+    c += sprintf( c, "[%ld] ", (long) selected );
+  sprintf( c, "%ld/%ld%s",
+           (long) line,
+           (long) total,
+           more ? "+" : "" );
   mcc_reset( strbuf );
-  mcc_printf( strbuf, "%*d",
+  mcc_printf( strbuf, "%*s",
               screen_win_x_size( sl->line_status->wi ),
-              (int)sl->curline + 1 );
+              count );
 
   /* Cut from left the part that does not fit into the field. */
   int overflow = strbuf->used - screen_win_x_size( sl->line_status->wi );
@@ -303,6 +668,19 @@ void line_status_update( select_lines_t* sl )
 }
 
 
+/**
+ * Update line_status label with current line number.
+ *
+ * @param sl Select_lines object.
+ */
+void line_status_update( select_lines_t* sl )
+{
+  /* Loading of input is indicated with "+". */
+  line_status_set( sl, sl->curline + 1, select_lines_count( sl ),
+                   sl->marked, sl->reader != NULL );
+}
+
+
 /**
  * Display Select_lines on screen. Marked lines have '*' in front of
  * the text.
@@ -311,7 +689,9 @@ void line_status_update( select_lines_t* sl )
  */
 void select_lines_display( select_lines_t* sl )
 {
-  select_line_t* line;
+  char* text;
+  bool_t marked;
+  row_info_t* row;
   win_info* wi = sl->list_wi;
 
   line_status_update( sl );
@@ -323,32 +703,58 @@ void select_lines_display( select_lines_t* sl )
 
   screen_clear_win( wi );
 
-  /* Show all visible lines or upto end of list. */
+  if ( sl->row_cnt < 2 * WI_Y_SIZE(wi) )
+    {
+      /* Visible positions map to separate slots, when table has
+         room for two windows. */
+      int size = sl->row_cnt ? sl->row_cnt : 16;
+
+      while ( size < 2 * WI_Y_SIZE(wi) )
+        size *= 2;
+
+      for ( int i = 0; i < sl->row_cnt; i++ )
+        screen_text_free( &sl->rows[ i ].layout );
+      sl->rows = mc_realloc( sl->rows, size * sizeof( row_info_t ) );
+      for ( int i = 0; i < size; i++ )
+        {
+          sl->rows[ i ].line = NULL;
+          screen_text_init( &sl->rows[ i ].layout );
+        }
+      sl->row_cnt = size;
+    }
+
+  /* Show all visible lines or upto end of list. Only the visible
+     part of line is rendered. */
   for ( int i = WI_Y_MIN(wi);
         i < WI_Y_SIZE(wi) &&
-          ( sl->firstline + i ) < sl->lines->used;
+          ( sl->firstline + i ) < select_lines_count( sl );
         i++ )
     {
-      line = mcc_nth( sl->lines, sl->firstline + i );
-      mcc_reset( strbuf );
+      line_index_t idx = select_lines_at( sl, sl->firstline + i );
+      text = select_lines_text( sl, idx );
+      marked = select_lines_marked( sl, idx );
+
+      /* Stored line is the key, since reconstructed text (path
+         tree) is in shared buffer. */
+      row = &sl->rows[ ( sl->firstline + i ) & ( sl->row_cnt - 1 ) ];
+      if ( row->line != mcp_nth( sl->lines, idx ) )
+        {
+          row->line = mcp_nth( sl->lines, idx );
+          screen_text_reset( &row->layout );
+        }
 
 #ifdef ENABLE_MARK_COLOR
 
-      mcc_printf( strbuf, "%s", line->text );
       screen_setpos( wi, 0, i );
-      if ( line->marked )
-        screen_set_color_str( wi, (char*) mcc_to_str( strbuf ), SCR_COLOR_RED );
-      else
-        screen_set_color_str( wi, (char*) mcc_to_str( strbuf ), SCR_COLOR_DEFAULT );
+      screen_set_text( wi, text, SCREEN_TEXT_NUL, sl->hscroll, &row->layout,
+                       marked ? SCR_COLOR_RED : SCR_COLOR_DEFAULT );
 
 # else
-      if ( line->marked )
-        mcc_printf( strbuf, "* %s", line->text );
-      else
-        mcc_printf( strbuf, "  %s", line->text );
 
       screen_setpos( wi, 0, i );
-      screen_set_str2( wi, (char*) mcc_to_str( strbuf ) );
+      screen_set_text( wi, marked ? "* " : "  ", 2, 0, NULL, -1 );
+      if ( screen_setpos( wi, 2, i ) )
+        screen_set_text( wi, text, SCREEN_TEXT_NUL, sl->hscroll, &row->layout, -1 );
 #endif
 
     }
@@ -369,12 +775,10 @@ void select_lines_display( select_lines_t* sl )
  */
 void select_lines_toggle_mark( select_lines_t* sl )
 {
-  select_line_t* line;
-  line = mcc_nth( sl->lines, sl->curline );
-  if ( line->marked )
-    line->marked = mc_false;
-  else
-    line->marked = mc_true;
+  line_index_t idx = select_lines_at( sl, sl->curline );
+
+  mcb_toggle( sl->marks, idx );
+  sl->marked += journal_toggle( sl->journal, sl->marks, idx, idx + 1 ) ? 1 : -1;
 }
 
 
@@ -386,9 +790,14 @@ void select_lines_toggle_mark( select_lines_t* sl )
  */
 void select_lines_set_mark_to( select_lines_t* sl, bool_t marked )
 {
-  select_line_t* line;
-  line = mcc_nth( sl->lines, sl->curline );
-  line->marked = marked;
+  line_index_t idx = select_lines_at( sl, sl->curline );
+
+  if ( mcb_get( sl->marks, idx ) != ( marked ? 1 : 0 ) )
+    {
+      mcb_assign( sl->marks, idx, marked );
+      journal_toggle( sl->journal, sl->marks, idx, idx + 1 );
+      sl->marked += marked ? 1 : -1;
+    }
 }
 
 
@@ -415,39 +824,69 @@ void select_lines_reset_mark( select_lines_t* sl )
 
 
 /**
- * Move n step down on line list.
+ * Move to given position on line list. Position is limited to list
+ * range. If position is not in the current view, it becomes the
+ * first or the last line in the view, depending on move direction
+ * (i.e. view is scrolled as little as possible).
  *
  * @param sl Select_lines object.
- * @param n Move count.
+ * @param pos Target position.
  *
- * @return Number of step performed.
+ * @return Number of steps performed (negative if moved up).
  */
-int select_lines_move_down_n( select_lines_t* sl, int n )
+line_index_t select_lines_goto( select_lines_t* sl, line_index_t pos )
 {
-  int i;
+  line_index_t steps;
   win_info* wi = sl->list_wi;
 
-  for ( i = 0; i < n; i++ )
+  if ( pos > select_lines_count( sl ) - 1 )
+    pos = select_lines_count( sl ) - 1;
+  if ( pos < 0 )
+    pos = 0;
+
+  steps = pos - sl->curline;
+
+  if ( pos < sl->firstline )
     {
-      if ( sl->curline < sl->lines->used-1 )
-        {
-          if ( screen_at_win_y_end( wi ) )
-            {
-              sl->firstline++;
-            }
-          else
-            {
-              wi->y++;
-            }
-          sl->curline++;
-        }
-      else
-        {
-          break;
-        }
+      /* Scroll up, target is at top. */
+      sl->firstline = pos;
+      wi->y = 0;
+    }
+  else if ( pos > sl->firstline + WI_Y_MAX(wi) )
+    {
+      /* Scroll down, target is at bottom. */
+      sl->firstline = pos - WI_Y_MAX(wi);
+      wi->y = WI_Y_MAX(wi);
+    }
+  else
+    {
+      wi->y = pos - sl->firstline;
     }
 
-  return i;
+  sl->curline = pos;
+
+  return steps;
+}
+
+
+/**
+ * Move n step down on line list.
+ *
+ * @param sl Select_lines object.
+ * @param n Move count.
+ *
+ * @return Number of step performed.
+ */
+line_index_t select_lines_move_down_n( select_lines_t* sl, line_index_t n )
+{
+  if ( n <= 0 )
+    return 0;
+
+  /* Avoid overflow with huge counts. */
+  if ( n > select_lines_count( sl ) )
+    n = select_lines_count( sl );
+
+  return select_lines_goto( sl, sl->curline + n );
 }
 
 
@@ -475,32 +914,15 @@ bool_t select_lines_move_down( select_lines_t* sl )
  *
  * @return Number of step performed.
  */
-int select_lines_move_up_n( select_lines_t* sl, int n )
+line_index_t select_lines_move_up_n( select_lines_t* sl, line_index_t n )
 {
-  int i;
-  win_info* wi = sl->list_wi;
+  if ( n <= 0 )
+    return 0;
 
-  for ( i = 0; i < n; i++ )
-    {
-      if ( sl->curline > 0 )
-        {
-          if ( screen_at_win_y_start( wi ) )
-            {
-              sl->firstline--;
-            }
-          else
-            {
-              wi->y--;
-            }
-          sl->curline--;
-        }
-      else
-        {
-          break;
-        }
-    }
+  if ( n > sl->curline )
+    n = sl->curline;
 
-  return i;
+  return -select_lines_goto( sl, sl->curline - n );
 }
 
 
@@ -521,654 +943,2335 @@ bool_t select_lines_move_up( select_lines_t* sl )
 
 
 /**
- * Create list content from shell command.
+ * Initialize line reader.
  *
- * @param sl Select_lines object.
- * @param cmd Shell command.
+ * @param lr Line reader.
+ * @param fd Input file descriptor.
  */
-void list_from_command( select_lines_t* sl, char* cmd )
+void line_reader_init( line_reader_t* lr, int fd )
 {
-  FILE* fh;
-  char* text;
-  ssize_t ret;
-  size_t linelen;
-  select_line_t* line;
-
-  fh = popen( cmd, "r" );
+  lr->fd = fd;
+  lr->pid = 0;
+  lr->eof = mc_false;
+  lr->buf = NULL;
+  lr->own = mc_false;
+  lr->size = 0;
+  lr->used = 0;
+  lr->start = 0;
+}
 
-  if ( !fh )
-    take_fatal( "Could not execute: %s", cmd );
 
-  mc_loop
+/**
+ * Close line reader input. Input command is terminated, unless it
+ * has finished already, and the command process is waited for.
+ *
+ * @param lr Line reader.
+ */
+void line_reader_close( line_reader_t* lr )
+{
+  if ( lr->own )
     {
-      text = NULL;
-      linelen = 0;
-      ret = getline( &text, &linelen, fh );
-      if ( ret != -1 )
-        {
-          dbug( "getline org text: \"%s\"\n", text );
-          /* Remove newline. */
-          if ( ret > 0 && text[ ret-1 ] == '\n' )
-            text[ ret-1 ] = 0;
-          dbug( "getline mod text: \"%s\"\n", text );
-          line = select_line_new( text );
-          mcp_append( sl->lines, line );
-        }
-      else
-        {
-          /* End of input. */
-          free( text );
-          break;
-        }
+      mc_free( lr->buf );
+      lr->buf = NULL;
+      lr->own = mc_false;
     }
 
-  pclose( fh );
+  if ( lr->pid > 0 )
+    {
+      if ( !lr->eof )
+        kill( lr->pid, SIGTERM );
+      close( lr->fd );
+      while ( waitpid( lr->pid, NULL, 0 ) < 0 && errno == EINTR )
+        ;
+      lr->pid = 0;
+    }
 }
 
 
 /**
- * qsort callback function for sorting strings.
- * 
- * @param a First str to compare.
- * @param b Second str to compare.
- * 
- * @return strcmp return values.
+ * Check if input line fits in the input limits. Input is marked
+ * limited if not.
+ *
+ * @param sl Select_lines object.
+ * @param len Line length (without newline).
+ *
+ * @return True if line fits.
  */
-int list_sort_cmp( const void* a, const void* b )
+static inline bool_t select_lines_input_fits( select_lines_t* sl, mc_size_t len )
 {
-    const char **ia = (const char **) a;
-    const char **ib = (const char **) b;
-    return strcmp( *ia, *ib );
+  if ( ( sl->max_lines > 0 && sl->lines->used >= sl->max_lines )
+       || ( sl->max_bytes > 0 && sl->bytes + len + 1 > sl->max_bytes ) )
+    {
+      sl->limited = mc_true;
+      return mc_false;
+    }
+
+  sl->bytes += len + 1;
+
+  return mc_true;
 }
 
 
 /**
- * Create line content from current directory entries in ascending
- * order. "." and ".."  are not used.
+ * Add line text to Select_lines. Text is copied to path tree with
+ * shared-prefix storage, otherwise text is used in place.
  *
  * @param sl Select_lines object.
- * @param dirname Directory name for listing.
+ * @param text Line text (null terminated, unless copied).
+ * @param len Text length.
  */
-void list_from_dir( select_lines_t* sl, char* dirname )
+static inline void select_lines_add_text( select_lines_t* sl, char* text, mc_size_t len )
 {
-  DIR* dir;
-  struct dirent* entry;
-
-  dir = opendir( dirname );
-
-  if ( dir )
-    {
-      mcp_p unsorted = mcp_new_size( 128 );
-      select_line_t* line;
-      char* tmpname;
-
-      while ( ( entry = readdir( dir ) ) != NULL )
-        {
-          /* Skip pwd and upper dir. */
-          if ( strcmp( ".", entry->d_name ) &&
-               strcmp( "..", entry->d_name ) )
-            {
-              tmpname = mc_strdup( entry->d_name );
-              mcp_append( unsorted, tmpname );
-            }
-        }
-
-      closedir( dir );
+  if ( sl->paths )
+    select_lines_add( sl, pathtree_add( sl->paths, text, len ) );
+  else
+    select_lines_add( sl, text );
+}
 
-      /* Sort entries into alphabetical order. */
-      qsort( (void*) unsorted->data,
-             unsorted->used,
-             mcp_sizeof,
-             list_sort_cmp );
 
-      /* Add sorted entries to lines list with dirname. */
-      mcc_p filename = mcc_new_size( 128 );
-      for ( int i = 0; i < unsorted->used; i++ )
-        {
-          tmpname = mcp_nth( unsorted, i );
-          mcc_reprintf( filename, "%s/%s", dirname, tmpname );
-          mc_del( tmpname );
-          line = select_line_new( mc_strdup( (char*) mcc_as_str( filename ) ) );
-          mcp_append( sl->lines, line );
-        }
-      mcc_del( filename );
+/**
+ * Add lines from text region to Select_lines. Newlines are
+ * replaced with nulls, unless lines are copied to path tree (region
+ * is not modified). Lines are added until input limit is reached.
+ *
+ * @param sl Select_lines object.
+ * @param buf Region start.
+ * @param len Region length.
+ *
+ * @return Index to the start of the unfinished (or first not added)
+ *   line in region.
+ */
+mc_size_t select_lines_add_region( select_lines_t* sl, char* buf, mc_size_t len )
+{
+  char* start = buf;
+  char* end = buf + len;
+  char* nl;
 
-      mcp_del( unsorted );
+  while ( ( nl = memchr( start, '\n', end - start ) )
+          && select_lines_input_fits( sl, nl - start ) )
+    {
+      if ( !sl->paths )
+        *nl = 0;
+      select_lines_add_text( sl, start, nl - start );
+      start = nl + 1;
     }
+
+  return start - buf;
 }
 
 
 /**
- * Create line content by reading stdin (piped input).
+ * Read available input to Select_lines. Reading blocks until some
+ * data is available, unless input is in non-blocking mode.
  *
  * @param sl Select_lines object.
+ * @param lr Line reader.
+ *
+ * @return Number of bytes read, 0 at end of input, and -1 if no data
+ *   is available (non-blocking).
  */
-void list_from_stdin( select_lines_t* sl )
+ssize_t line_reader_read( select_lines_t* sl, line_reader_t* lr )
 {
-  FILE* fh = stdin;
-  char* text;
   ssize_t ret;
-  size_t linelen;
-  select_line_t* line;
 
-  mc_loop
+  if ( sl->limited )
+    /* Rest of input is ignored. */
+    return 0;
+
+  if ( lr->used == lr->size )
     {
-      text = NULL;
-      linelen = 0;
-      ret = getline( &text, &linelen, fh );
-      if ( ret != -1 )
+      /* Chunk is full (or missing), move the unfinished line to a new
+         chunk. Chunk is enlarged for very long lines. */
+      mc_size_t tail = lr->used - lr->start;
+      mc_size_t size = TAKE_INPUT_CHUNK;
+      char* buf;
+
+      while ( tail >= size / 2 )
+        size *= 2;
+
+      if ( sl->paths )
         {
-          /* Remove newline. */
-          if ( ret > 0 && text[ ret-1 ] == '\n')
-            text[ ret-1 ] = 0;
-          line = select_line_new( text );
-          mcp_append( sl->lines, line );
+          /* Lines are copied to path tree, i.e. the same chunk is
+             reused for all input. */
+          if ( tail > 0 )
+            memmove( lr->buf, lr->buf + lr->start, tail );
+          if ( size > lr->size )
+            lr->buf = mc_realloc( lr->buf, size );
+          else
+            size = lr->size;
+          lr->own = mc_true;
         }
       else
         {
-          /* End of input. */
-          break;
+          buf = mca_alloc( sl->arena, size );
+          if ( tail > 0 )
+            mc_memcpy( lr->buf + lr->start, buf, tail );
+          lr->buf = buf;
         }
-    }
-}
 
+      lr->size = size;
+      lr->used = tail;
+      lr->start = 0;
+    }
 
-/**
- * Replace the "@" special chars with selected lines. Also replace
- * "@_" with "@" on output.
- *
- * @param [in] cmd Command string.
- * @param [in] arg Replacement for special chars.
- * @param [out] buf String buffer for replacement result.
- */
-void process_cmd_escapes( char* cmd, char* arg, mcc_p buf )
-{
-  /* Char index for cmd string. */
-  int ci;
+  do
+    {
+      ret = read( lr->fd, lr->buf + lr->used, lr->size - lr->used );
+    }
+  while ( ret < 0 && errno == EINTR );
 
-  mcc_reset( buf );
+  if ( ret < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) )
+    return -1;
 
-  ci = 0;
+  if ( ret > 0 )
+    stats.input_bytes += ret;
 
-  mc_loop
+  if ( ret <= 0 )
     {
-      if ( cmd[ ci ] == 0 )
-        /* End of command. */
-        break;
+      lr->eof = mc_true;
 
-      if ( cmd[ ci ] == '@' )
+      /* End of input, terminate the last line (if any). */
+      if ( lr->used > lr->start
+           && select_lines_input_fits( sl, lr->used - lr->start ) )
         {
-          if ( cmd[ ci+1 ] == '_' )
+          if ( sl->paths )
             {
-              /* Literal @ to output. */
-              mcc_append( buf, '@' );
-              ci += 2;
+              select_lines_add_text( sl, lr->buf + lr->start,
+                                     lr->used - lr->start );
+            }
+          else if ( lr->used < lr->size )
+            {
+              lr->buf[ lr->used ] = 0;
+              select_lines_add( sl, lr->buf + lr->start );
             }
           else
             {
-              /* Replace with arg. */
-              mcc_append_n( buf, arg, strlen( arg ) );
-              ci++;
+              select_lines_add( sl, mca_strndup( sl->arena,
+                                                 lr->buf + lr->start,
+                                                 lr->used - lr->start ) );
             }
+          lr->start = lr->used;
         }
-      else
-        {
-          /* Copy to output. */
-          mcc_append( buf, cmd[ ci ] );
-          ci++;
-        }
+      return 0;
     }
+
+  lr->start += select_lines_add_region( sl,
+                                        lr->buf + lr->start,
+                                        lr->used + ret - lr->start );
+  lr->used += ret;
+
+  if ( sl->limited )
+    /* Input limit reached, i.e. end of input for reader. */
+    return 0;
+
+  return ret;
 }
 
 
+#ifdef HAVE_MMAP
+
 /**
- * Execute command or just place the command to output stream (if
- * non-null).
+ * Release mapped input (arena callback).
  *
- * @param cmd Command to execute (or store).
- * @param fh Output stream (or NULL).
+ * @param data Mapping.
+ * @param size Mapping size.
  */
-void execute_cmd( const char* cmd, FILE* fh )
+void list_unmap( void* data, mc_size_t size )
 {
-  if ( fh )
-    {
-      fputs( cmd, fh );
-      fputc( '\n', fh );
-    }
-  else
-    {
+  munmap( data, size );
+}
 
-#ifdef HAVE_VFORK
+#endif
 
-      /* When take includes a long list, a lot of memory is
-         allocated. vfork does not duplicate the memory allocation and
-         thus system (execl) calls start significantly faster. */
 
-      pid_t child;
-      child = vfork();
-      if ( child == 0 )
-        {
-          execl( "/bin/sh", "sh", "-c", cmd, (char*) 0 );
-        }
-      else if ( child == -1 )
-        {
-          /* Failure. */
-          take_error( "Could not execute: \"%s\"\n  reason: \"%s\"",
-                      cmd,
-                      strerror( errno )
-                      );
-        }
-      else
-        {
-          int status;
-          waitpid( child, &status, 0 );
-        }
+/**
+ * Create list content from file descriptor. Input is read in chunks
+ * until end of input.
+ *
+ * @param sl Select_lines object.
+ * @param fd File descriptor.
+ */
+void list_from_fd( select_lines_t* sl, int fd )
+{
+  line_reader_t lr;
 
-# else
+  line_reader_init( &lr, fd );
+  while ( line_reader_read( sl, &lr ) > 0 )
+    ;
+  line_reader_close( &lr );
+}
 
-      system( cmd );
 
-#endif
-      
-    }
+/**
+ * Interrupt handler for input loading, i.e. loading is cancelled.
+ *
+ * @param signo Signal number.
+ */
+void list_cancel_handler( int signo )
+{
+  list_cancelled = mc_true;
 }
 
 
 /**
- * View lines from "view_sl" on top of "sl". After viewing the "sl"
- * status is reverted back on display. Used for help and commands
- * view.
+ * Start shell command with output to a pipe.
  *
- * @param sl Select_lines object.
- * @param view_sl View list.
+ * @param cmd Shell command.
+ * @param [out] fd Read end of command output pipe.
+ *
+ * @return Command process.
  */
-void select_lines_view( select_lines_t* sl, select_lines_t* view_sl )
+pid_t list_spawn_command( char* cmd, int* fd )
 {
-  win_info* wi;
+  char* argv[] = { "sh", "-c", cmd, NULL };
+  int fds[ 2 ];
+  pid_t pid;
 
-  /* Current view list for window resize purposes. */
-  screen_win_resize_context = view_sl;
+  if ( pipe( fds ) != 0 )
+    take_fatal( "Could not create pipe for: %s", cmd );
 
-  /* Copy window state. */
-  view_sl->list_wi = sl->list_wi;
-  view_sl->prompt = sl->prompt;
-  view_sl->line_status = sl->line_status;
-  view_sl->find_status = sl->find_status;
-  wi = view_sl->list_wi;
+  /* Later commands should not inherit the read end. */
+  fcntl( fds[ 0 ], F_SETFD, FD_CLOEXEC );
 
+#ifdef HAVE_POSIX_SPAWN
 
-  /* Display all lines. */
-  select_lines_display( view_sl );
+  posix_spawn_file_actions_t actions;
+  int err;
 
+  posix_spawn_file_actions_init( &actions );
+  posix_spawn_file_actions_adddup2( &actions, fds[ 1 ], STDOUT_FILENO );
+  posix_spawn_file_actions_addclose( &actions, fds[ 1 ] );
 
-  int key;
-  bool_t done = mc_false;
+  err = posix_spawn( &pid, "/bin/sh", &actions, NULL, argv, environ );
+  posix_spawn_file_actions_destroy( &actions );
 
-  /* Get user input. */
-  mc_loop
+  if ( err != 0 )
+    take_fatal( "Could not execute: %s", cmd );
+
+# else
+
+  pid = fork();
+  if ( pid < 0 )
+    take_fatal( "Could not execute: %s", cmd );
+
+  if ( pid == 0 )
     {
-      key = screen_get_key();
+      dup2( fds[ 1 ], STDOUT_FILENO );
+      close( fds[ 1 ] );
+      execv( "/bin/sh", argv );
+      _exit( 127 );
+    }
 
-      switch ( key )
-        {
+#endif
 
-        case ESC:
-        case CTRL_G:
-        case NEWLINE:
-          done = mc_true;
-          break;
+  close( fds[ 1 ] );
+  *fd = fds[ 0 ];
 
-        case 'n':
-          if ( wi->y != WI_Y_MAX( wi ) )
-            select_lines_move_down_n( view_sl, WI_Y_MAX( wi ) - wi->y );
-          else
-            select_lines_move_down_n( view_sl, WI_Y_SIZE( wi ) );
-          break;
+  return pid;
+}
 
-        case 'p':
-          if ( wi->y != 0 )
-            select_lines_move_up_n( view_sl, wi->y );
-          else
-            select_lines_move_up_n( view_sl, WI_Y_SIZE( wi ) );
-          break;
 
+/**
+ * Create list content from shell command. Command output is read
+ * through a pipe until end of output or input limit. Interrupt
+ * (CTRL-C) cancels loading, and the lines read so far are kept.
+ *
+ * @param sl Select_lines object.
+ * @param cmd Shell command.
+ */
+void list_from_command( select_lines_t* sl, char* cmd )
+{
+  line_reader_t lr;
+  struct pollfd pfd;
+  int fd;
+
+  line_reader_init( &lr, -1 );
+  lr.pid = list_spawn_command( cmd, &fd );
+  lr.fd = fd;
 
-        default:
+  list_cancelled = mc_false;
+  signal( SIGINT, list_cancel_handler );
+
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+
+  while ( !list_cancelled )
+    {
+      if ( poll( &pfd, 1, -1 ) < 0 )
+        {
+          if ( errno == EINTR )
+            continue;
           break;
         }
 
-      if ( done )
+      if ( line_reader_read( sl, &lr ) == 0 )
         break;
-
-      select_lines_display( view_sl );
-
     }
 
-  /* Revert back to original. */
-  screen_win_resize_context = sl;
+  signal( SIGINT, SIG_DFL );
 
+  line_reader_close( &lr );
 }
 
 
 /**
- * Show command help on screen.
- *
- * NOTE: Keep the help list in sync with the manual page.
+ * Start progressive list content from shell command. The rest of
+ * content is read while user interacts.
  *
  * @param sl Select_lines object.
+ * @param cmd Shell command.
  */
-void show_command_help( select_lines_t* sl )
+void list_stream_from_command( select_lines_t* sl, char* cmd )
 {
-  char* help_list[ ] = {
-    "\"J\": Toggle selection and move down",
-    "\"K\": Toggle selection and move up",
-    "\"j\": Move down",
-    "\"k\": Move up",
-    "\"n\": Move down page",
-    "\"p\": Move up page",
-    "\"b\": Move to beginning of list",
-    "\"e\": Move to end of list",
-    "\"g\": Goto to line",
-    "\"s\": Select current",
-    "\"r\": Reject current,"
-    "\"t\": Toggle current",
-    "\"S\": Select all items",
-    "\"R\": Reject all items",
-    "\"T\": Toggle all items",
-    "\"c\": Toggle the next \"count\" items",
-    "\"m\": Select items matching the prompted regexp (case insensitive)",
-    "\"M\": Select items matching the prompted regexp (case sensitive)",
-    "\"f\": Find mode with case sensitive matching (Keys: j,k,s,r,t,RET,ESC)",
-    "\"F\": Find mode with case insensitive matching (Keys: j,k,s,r,t,RET,ESC)",
-    "\"v\": View the list of commands that would be executed",
-    "\"i\": View the current list entry content (if a text file)",
-    "\"l\": Center list view on screen around current line",
-    "\"h\": Show command help",
-    "\"x\": Quit and execute output-command for selection",
-    "\"q\": Quit and skip output-command execution",
-    NULL
-  };
+  pid_t pid;
+  int fd;
 
-  select_lines_t* help_sl;
+  pid = list_spawn_command( cmd, &fd );
+  select_lines_load_start( sl, fd, pid );
+}
 
-  help_sl = select_lines_new();
 
-  select_line_t* line;
-  for ( int i = 0; help_list[i]; i++ )
-    {
-      line = select_line_new( mc_strdup( help_list[i] ) );
-      mcp_append( help_sl->lines, line );
-    }
+/**
+ * Create list content from file.
+ *
+ * @param sl Select_lines object.
+ * @param filename File to read.
+ */
+void list_from_file( select_lines_t* sl, char* filename )
+{
+  int fd;
 
-  select_lines_view( sl, help_sl );
+  fd = open( filename, O_RDONLY );
 
-  select_lines_rem( help_sl );
+  if ( fd < 0 )
+    take_fatal( "Could not open input file: %s", filename );
+
+  list_from_fd( sl, fd );
+
+  close( fd );
 }
 
 
 /**
- * Show file content on screen.
+ * Dirlist callback for adding entry path to lines.
  *
- * @param sl Select_lines object.
- * @param filename Filename for file to display.
+ * @param context Select_lines object.
+ * @param dir Directory path.
+ * @param dirlen Directory path length.
+ * @param name Entry name.
  */
-void show_file_content( select_lines_t* sl, char* filename )
+void list_add_path( void* context, const char* dir, mc_size_t dirlen, const char* name )
 {
-  select_lines_t* file_sl;
-  FILE* fh;
+  select_lines_t* sl = context;
+  mc_size_t len = dirlen + 1 + strlen( name );
+  char* path;
 
-  fh = fopen( filename, "r" );
-  if ( !fh )
-    /* Can't open file, abort. */
+  if ( !select_lines_input_fits( sl, len ) )
     return;
 
-  file_sl = select_lines_new();
-
-  select_line_t* line;
-  ssize_t ret;
-  char* text;
-  size_t linelen;
-
-  mc_loop
+  /* Path is built to text buffer for path tree (copied), otherwise
+     to arena. */
+  if ( sl->paths )
     {
-      text = NULL;
-      linelen = 0;
-      ret = getline( &text, &linelen, fh );
-
-      if ( ret != -1 )
-        {
-          /* Remove newline. */
-          if ( ret > 0 && text[ ret-1 ] == '\n')
-            text[ ret-1 ] = 0;
-          line = select_line_new( text );
-          mcp_append( file_sl->lines, line );
-        }
-      else
+      if ( len + 1 > sl->text_size )
         {
-          /* End of input. */
-          break;
+          sl->text_size = ( len + 1 ) * 2;
+          sl->text = mc_realloc( sl->text, sl->text_size );
         }
+      path = sl->text;
+    }
+  else
+    {
+      path = mca_alloc( sl->arena, len + 1 );
     }
 
-  select_lines_view( sl, file_sl );
-  select_lines_rem( file_sl );
+  mc_memcpy( dir, path, dirlen );
+  path[ dirlen ] = '/';
+  mc_memcpy( name, path + dirlen + 1, len - dirlen );
+
+  select_lines_add_text( sl, path, len );
 }
 
 
 /**
- * Create a list of shell command executions for selected items.
+ * Reserve room for directory listing entries (callback).
  *
- * @param sl Select_lines object.
- *
- * @return Command list.
+ * @param context Select_lines object.
+ * @param count Entry count.
  */
-select_lines_t* select_lines_create_commands( select_lines_t* sl )
+void list_reserve_paths( void* context, mc_size_t count )
 {
-  select_lines_t* cmds;
-  como_opt_t* opt;
-  char* command = NULL;
-
-  cmds = select_lines_new();
+  select_lines_t* sl = context;
 
-  if ( ( opt = como_given( "command" ) ) )
-    command = opt->value[0];
+  mcp_reserve( sl->lines, count );
 
-  if ( ( opt = como_given( "auto" ) ) )
-    command = opt->value[0];
+  /* Allocate marks at once, allocation is kept when size is reverted. */
+  mcb_resize( sl->marks, sl->lines->used + count );
+  mcb_resize( sl->marks, sl->lines->used );
+}
 
 
-  if ( !command )
+/**
+ * Create line content from directory entries in ascending order. "."
+ * and ".."  are not used.
+ *
+ * @param sl Select_lines object.
+ * @param dirname Directory name for listing.
+ * @param recursive Include subdirectory content (after each subdirectory).
+ */
+void list_from_dir( select_lines_t* sl, char* dirname, bool_t recursive )
+{
+  dirlist_list( dirname, recursive, list_reserve_paths, list_add_path, sl );
+}
+
+
+/**
+ * Create line content by reading stdin (piped input).
+ *
+ * @param sl Select_lines object.
+ */
+void list_from_stdin( select_lines_t* sl )
+{
+  list_from_fd( sl, fileno( stdin ) );
+}
+
+
+/**
+ * Start progressive list content from stdin (piped input).
+ *
+ * @param sl Select_lines object.
+ */
+void list_stream_from_stdin( select_lines_t* sl )
+{
+  select_lines_load_start( sl, fileno( stdin ), 0 );
+}
+
+
+/**
+ * Snapshot file header. Header is followed by line offsets (uint64_t
+ * per line), line texts (null terminated, padded to 8 bytes) and mark
+ * words. Snapshot uses native byte order, i.e. it is valid only on
+ * similar hosts.
+ */
+typedef struct snapshot_header_s {
+  char magic[ 8 ];        /**< TAKE_SNAPSHOT_MAGIC. */
+  uint32_t version;       /**< TAKE_SNAPSHOT_VERSION. */
+  uint32_t word_size;     /**< Mark word size (byte order check included). */
+  uint64_t lines;         /**< Line count. */
+  uint64_t text_size;     /**< Size of texts (padded). */
+  uint64_t curline;       /**< Current line. */
+  uint64_t firstline;     /**< First visible line. */
+} snapshot_header_t;
+
+
+/**
+ * Write lines, marks and position to snapshot file. Snapshot is
+ * written to temporary file which then replaces the snapshot file,
+ * since line texts may be mapped from the same file (resume).
+ *
+ * @param sl Select_lines object (input complete).
+ * @param filename Snapshot file.
+ */
+void select_lines_save( select_lines_t* sl, char* filename )
+{
+  snapshot_header_t hdr;
+  static const char pad[ 8 ] = { 0 };
+  mc_size_t n = sl->lines->used;
+  uint64_t offset = 0;
+  char* tmpname;
+  FILE* fh;
+
+  tmpname = mc_new_n( char, strlen( filename ) + 5 );
+  sprintf( tmpname, "%s.tmp", filename );
+
+  fh = fopen( tmpname, "w" );
+  if ( !fh )
+    take_fatal( "Could not open snapshot file: %s", tmpname );
+  setvbuf( fh, NULL, _IOFBF, TAKE_OUTPUT_BUFFER );
+
+  memset( &hdr, 0, sizeof( hdr ) );
+  memcpy( hdr.magic, TAKE_SNAPSHOT_MAGIC, 8 );
+  hdr.version = TAKE_SNAPSHOT_VERSION;
+  hdr.word_size = sizeof( mcb_word_t ) | 0x01020300;
+  hdr.lines = n;
+  hdr.curline = sl->curline;
+  hdr.firstline = sl->firstline;
+
+  for ( mc_size_t i = 0; i < n; i++ )
+    offset += strlen( select_lines_text( sl, i ) ) + 1;
+  hdr.text_size = ( offset + 7 ) & ~(uint64_t) 7;
+
+  fwrite( &hdr, sizeof( hdr ), 1, fh );
+
+  offset = 0;
+  for ( mc_size_t i = 0; i < n; i++ )
+    {
+      fwrite( &offset, sizeof( offset ), 1, fh );
+      offset += strlen( select_lines_text( sl, i ) ) + 1;
+    }
+
+  for ( mc_size_t i = 0; i < n; i++ )
+    {
+      fputs( select_lines_text( sl, i ), fh );
+      fputc( 0, fh );
+    }
+  fwrite( pad, 1, hdr.text_size - offset, fh );
+
+  fwrite( sl->marks->data, sizeof( mcb_word_t ), mcb_words( n ), fh );
+
+  if ( fflush( fh ) != 0 || fsync( fileno( fh ) ) != 0 || ferror( fh ) )
+    {
+      fclose( fh );
+      unlink( tmpname );
+      take_fatal( "Could not write snapshot file: %s", tmpname );
+    }
+
+  if ( fclose( fh ) != 0 || rename( tmpname, filename ) != 0 )
+    {
+      unlink( tmpname );
+      take_fatal( "Could not write snapshot file: %s", filename );
+    }
+
+  mc_free( tmpname );
+}
+
+
+/**
+ * Load lines, marks and position from snapshot file. Snapshot is
+ * mapped to memory (if possible), i.e. line texts are used in place.
+ *
+ * @param sl Select_lines object (empty).
+ * @param filename Snapshot file.
+ */
+void select_lines_resume( select_lines_t* sl, char* filename )
+{
+  snapshot_header_t* hdr;
+  struct stat st;
+  char* data = NULL;
+  uint64_t* offsets;
+  char* texts;
+  mc_size_t n;
+  int fd;
+
+  fd = open( filename, O_RDONLY );
+  if ( fd < 0 || fstat( fd, &st ) != 0 )
+    take_fatal( "Could not open snapshot file: %s", filename );
+
+  if ( (size_t) st.st_size < sizeof( snapshot_header_t ) )
+    take_fatal( "Invalid snapshot file: %s", filename );
+
+#ifdef HAVE_MMAP
+  data = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+  if ( data != MAP_FAILED )
+    mca_adopt( sl->arena, data, st.st_size, list_unmap );
+  else
+    data = NULL;
+#endif
+
+  if ( !data )
+    {
+      mc_size_t done = 0;
+      ssize_t len;
+
+      data = mca_alloc( sl->arena, st.st_size );
+      while ( done < (mc_size_t) st.st_size )
+        {
+          len = read( fd, data + done, st.st_size - done );
+          if ( len < 0 && errno == EINTR )
+            continue;
+          if ( len <= 0 )
+            take_fatal( "Could not read snapshot file: %s", filename );
+          done += len;
+        }
+    }
+
+  close( fd );
+
+  hdr = (snapshot_header_t*) data;
+
+  /* Sizes are checked unsigned before use, i.e. also crafted headers
+     are rejected. */
+  if ( memcmp( hdr->magic, TAKE_SNAPSHOT_MAGIC, 8 )
+       || hdr->lines > (uint64_t) st.st_size / sizeof( uint64_t )
+       || hdr->text_size > (uint64_t) st.st_size
+       || hdr->curline > hdr->lines
+       || hdr->firstline > hdr->lines )
+    take_fatal( "Invalid snapshot file: %s", filename );
+
+  n = hdr->lines;
+
+  if ( hdr->version != TAKE_SNAPSHOT_VERSION
+       || hdr->word_size != ( sizeof( mcb_word_t ) | 0x01020300 )
+       || hdr->text_size % 8
+       || (uint64_t) st.st_size != ( sizeof( snapshot_header_t )
+                                     + n * sizeof( uint64_t )
+                                     + hdr->text_size
+                                     + mcb_words( n ) * sizeof( mcb_word_t ) ) )
+    take_fatal( "Invalid snapshot file: %s", filename );
+
+  offsets = (uint64_t*) ( data + sizeof( snapshot_header_t ) );
+  texts = (char*) ( offsets + n );
+
+  if ( n > 0 && texts[ hdr->text_size - 1 ] != 0 )
+    take_fatal( "Invalid snapshot file: %s", filename );
+
+  mcp_resize( sl->lines, n );
+  for ( mc_size_t i = 0; i < n; i++ )
+    {
+      if ( offsets[ i ] >= hdr->text_size )
+        take_fatal( "Invalid snapshot file: %s", filename );
+      mcp_append( sl->lines, texts + offsets[ i ] );
+    }
+
+  mcb_resize( sl->marks, n );
+  memcpy( sl->marks->data, texts + hdr->text_size, mcb_words( n ) * sizeof( mcb_word_t ) );
+  if ( n % MCB_WORD_BITS )
+    /* Bits after the last line have to be clear. */
+    sl->marks->data[ n / MCB_WORD_BITS ] &= ( (mcb_word_t) 1 << ( n % MCB_WORD_BITS ) ) - 1;
+  sl->marked = mcb_count( sl->marks );
+
+  if ( hdr->curline < (uint64_t) n )
+    sl->curline = hdr->curline;
+  if ( hdr->firstline <= (uint64_t) sl->curline )
+    sl->firstline = hdr->firstline;
+}
+
+
+/**
+ * Sort lines and/or remove duplicate lines. Without sort, the first
+ * occurrence of each line is kept in input order.
+ *
+ * @param sl Select_lines object (input complete).
+ * @param sort Sort lines (byte order).
+ * @param uniq Remove duplicates.
+ */
+void select_lines_sort( select_lines_t* sl, bool_t sort, bool_t uniq )
+{
+  mc_size_t n = sl->lines->used;
+  char** lines = (char**) sl->lines->data;
+  strsort_item_t* items;
+  mc_size_t cnt = 0;
+
+  if ( n < 2 )
+    return;
+
+  items = mc_new_n( strsort_item_t, n );
+  for ( mc_size_t i = 0; i < n; i++ )
+    {
+      items[ i ].str = lines[ i ];
+      items[ i ].idx = i;
+    }
+
+  /* Stable sort, i.e. first of equal lines is the first occurrence. */
+  strsort_items( items, n );
+
+  if ( sort )
+    {
+      for ( mc_size_t i = 0; i < n; i++ )
+        {
+          if ( uniq && cnt > 0 && !strcmp( lines[ cnt-1 ], items[ i ].str ) )
+            continue;
+          lines[ cnt++ ] = items[ i ].str;
+        }
+    }
+  else
+    {
+      mcb_p keep = mcb_new();
+      mcb_resize( keep, n );
+
+      for ( mc_size_t i = 0; i < n; i++ )
+        {
+          if ( i == 0 || strcmp( items[ i-1 ].str, items[ i ].str ) )
+            mcb_set( keep, items[ i ].idx );
+        }
+
+      for ( mc_size_t i = mcb_next( keep, 0 );
+            i != (mc_size_t) MCB_INVALID_INDEX;
+            i = mcb_next( keep, i+1 ) )
+        lines[ cnt++ ] = lines[ i ];
+
+      mcb_del( keep );
+    }
+
+  mc_free( items );
+
+  mcp_delete_n_end( sl->lines, n - cnt );
+  mcb_resize( sl->marks, sl->lines->used );
+  journal_clear( sl->journal );
+}
+
+
+/**
+ * Index fields of new lines (if lines have fields).
+ *
+ * @param sl Select_lines object.
+ */
+void select_lines_fields_update( select_lines_t* sl )
+{
+  if ( sl->fields )
+    field_index_update( sl->fields, (char**) sl->lines->data, sl->lines->used );
+}
+
+
+/**
+ * Parse sort field, i.e. field number with optional "r" for
+ * descending order.
+ *
+ * @param [in] str Sort field.
+ * @param [out] field Field number.
+ * @param [out] reverse Descending order.
+ *
+ * @return True if sort field is valid.
+ */
+bool_t select_lines_parse_field( const char* str, int* field, bool_t* reverse )
+{
+  char* end;
+  long num;
+
+  num = strtol( str, &end, 10 );
+  *reverse = ( *end == 'r' );
+  if ( *reverse )
+    end++;
+
+  if ( end == str || *end || num < 1 || num > FIELD_MAX )
+    return mc_false;
+
+  *field = num;
+
+  return mc_true;
+}
+
+
+/**
+ * Sort lines by field (see field_sort). Selection and the current
+ * line follow the lines, and the field index is reordered (not
+ * created again).
+ *
+ * @param sl Select_lines object (input complete).
+ * @param field Sort field (from 1).
+ * @param reverse Descending order.
+ */
+void select_lines_sort_field( select_lines_t* sl, int field, bool_t reverse )
+{
+  mc_size_t n = sl->lines->used;
+  char** lines = (char**) sl->lines->data;
+  mc_size_t* order;
+  char** sorted;
+  mcb_p marks;
+  line_index_t cur = sl->curline;
+
+  if ( n < 2 )
+    return;
+
+  select_lines_fields_update( sl );
+
+  order = mc_new_n( mc_size_t, n );
+  field_sort( sl->fields, lines, n, field, reverse, order );
+
+  sorted = mc_new_n( char*, n );
+  marks = mcb_new_size( mcb_words( n ) );
+  mcb_resize( marks, n );
+
+  for ( mc_size_t i = 0; i < n; i++ )
+    {
+      sorted[ i ] = lines[ order[ i ] ];
+      if ( mcb_get( sl->marks, order[ i ] ) )
+        mcb_set( marks, i );
+      if ( (line_index_t) order[ i ] == cur )
+        sl->curline = i;
+    }
+
+  /* Selection order follows the lines (undo refers to old line
+     positions). */
+  journal_permute( sl->journal, sl->marks, order, n );
+
+  mc_memcpy( sorted, lines, n * sizeof( char* ) );
+  mcb_del( sl->marks );
+  sl->marks = marks;
+  field_index_permute( sl->fields, order, n );
+
+  mc_free( sorted );
+  mc_free( order );
+}
+
+
+/**
+ * Pre-compiled output-command, i.e. literal segments of the command
+ * with "@" slots between them. "@_" is stored as literal "@". With
+ * field index, "@<field>" slots are replaced with line field.
+ */
+typedef struct cmd_template_s {
+  mcp_p literals;      /**< Literal segments (slot count + 1). */
+  mci_p lens;          /**< Literal segment lengths. */
+  mci_p fields;        /**< Field of each slot (0 for whole item). */
+  bool_t used[ FIELD_MAX + 1 ]; /**< Fields used in slots. */
+  size_t literal_len;  /**< Total length of literals. */
+} cmd_template_t;
+
+
+/**
+ * Replacement for command template slots of one field.
+ */
+typedef struct cmd_arg_s {
+  const char* str;     /**< Replacement. */
+  size_t len;          /**< Replacement length. */
+  mcc_p buf;           /**< Storage for joined items (or NULL). */
+} cmd_arg_t;
+
+
+/**
+ * Create command template from command string.
+ *
+ * @param cmd Command string.
+ * @param fields Field slots are used.
+ *
+ * @return Command template.
+ */
+cmd_template_t* cmd_template_new( const char* cmd, bool_t fields )
+{
+  cmd_template_t* t;
+  mcc_p seg;
+  int field;
+
+  t = mc_new( cmd_template_t );
+  t->literals = mcp_new_size( 4 );
+  t->lens = mci_new_size( 4 );
+  t->fields = mci_new_size( 4 );
+  memset( t->used, 0, sizeof( t->used ) );
+  t->literal_len = 0;
+
+  seg = mcc_new_size( 64 );
+
+  for ( const char* c = cmd; *c; c++ )
+    {
+      if ( *c == '@' )
+        {
+          if ( c[1] == '_' )
+            {
+              /* Literal @ to output. */
+              mcc_append( seg, '@' );
+              c++;
+            }
+          else
+            {
+              field = 0;
+              if ( fields )
+                {
+                  while ( isdigit( (uchar) c[1] ) && field <= FIELD_MAX )
+                    field = field * 10 + ( *++c - '0' );
+                  if ( field > FIELD_MAX )
+                    take_fatal( "Invalid field in command: %s", cmd );
+                }
+
+              /* Slot for arg, i.e. literal segment ends. */
+              mcp_append( t->literals, mc_strdup( mcc_to_str( seg ) ) );
+              mci_append( t->lens, seg->used );
+              mci_append( t->fields, field );
+              t->used[ field ] = mc_true;
+              t->literal_len += seg->used;
+              mcc_reset( seg );
+            }
+        }
+      else
+        {
+          mcc_append( seg, *c );
+        }
+    }
+
+  mcp_append( t->literals, mc_strdup( mcc_to_str( seg ) ) );
+  mci_append( t->lens, seg->used );
+  t->literal_len += seg->used;
+
+  mcc_del( seg );
+
+  return t;
+}
+
+
+/**
+ * Free command template.
+ *
+ * @param t Command template.
+ */
+void cmd_template_rem( cmd_template_t* t )
+{
+  for ( mc_size_t i = 0; i < t->literals->used; i++ )
+    mc_free( t->literals->data[ i ] );
+
+  mcp_del( t->literals );
+  mci_del( t->lens );
+  mci_del( t->fields );
+  mc_free( t );
+}
+
+
+/**
+ * Return the length of command after slot replacement.
+ *
+ * @param t Command template.
+ * @param args Replacements by field.
+ *
+ * @return Command length.
+ */
+size_t cmd_template_len( cmd_template_t* t, const cmd_arg_t* args )
+{
+  size_t len = t->literal_len;
+
+  for ( mc_size_t i = 0; i < t->fields->used; i++ )
+    len += args[ mci_nth( t->fields, i ) ].len;
+
+  return len;
+}
+
+
+/**
+ * Create command by replacing the slots with args.
+ *
+ * @param [in] t Command template.
+ * @param [in] args Replacements by field.
+ * @param [out] buf String buffer for replacement result.
+ */
+void cmd_template_expand( cmd_template_t* t, const cmd_arg_t* args, mcc_p buf )
+{
+  const cmd_arg_t* arg;
+
+  mcc_reset( buf );
+
+  for ( mc_size_t i = 0; i < t->literals->used; i++ )
+    {
+      if ( i > 0 )
+        {
+          arg = &args[ mci_nth( t->fields, i-1 ) ];
+          mcc_append_n( buf, (char*) arg->str, arg->len );
+        }
+      mcc_append_n( buf, t->literals->data[ i ], mci_nth( t->lens, i ) );
+    }
+}
+
+
+/**
+ * Write command (as line) to stream by replacing the slots with
+ * args. Command is not created in memory.
+ *
+ * @param t Command template.
+ * @param args Replacements by field.
+ * @param fh Output stream.
+ */
+void cmd_template_write( cmd_template_t* t, const cmd_arg_t* args, FILE* fh )
+{
+  const cmd_arg_t* arg;
+
+  for ( mc_size_t i = 0; i < t->literals->used; i++ )
+    {
+      if ( i > 0 )
+        {
+          arg = &args[ mci_nth( t->fields, i-1 ) ];
+          fwrite( arg->str, 1, arg->len, fh );
+        }
+      fwrite( t->literals->data[ i ], 1, mci_nth( t->lens, i ), fh );
+    }
+  fputc( '\n', fh );
+}
+
+
+/**
+ * Return the maximum length for command, so that command execution
+ * does not exceed system limits (ARG_MAX).
+ *
+ * @return Max command length.
+ */
+size_t cmd_max_len( void )
+{
+  long arg_max;
+
+  arg_max = sysconf( _SC_ARG_MAX );
+  if ( arg_max < TAKE_ARG_MAX_MIN )
+    arg_max = TAKE_ARG_MAX_MIN;
+
+  /* Environment is passed to commands as well. */
+  for ( char** env = environ; *env; env++ )
+    arg_max -= strlen( *env ) + 1 + sizeof( char* );
+
+  /* Headroom for shell arguments (as in xargs). */
+  arg_max -= 2048;
+
+  if ( arg_max > TAKE_ARG_STRLEN_MAX )
+    arg_max = TAKE_ARG_STRLEN_MAX;
+  if ( arg_max < TAKE_ARG_MAX_MIN / 2 )
+    arg_max = TAKE_ARG_MAX_MIN / 2;
+
+  return arg_max;
+}
+
+
+/**
+ * Execute command. Execution is started in job pool and it may still
+ * be running after return.
+ *
+ * @param jobs Job pool.
+ * @param cmd Command to execute.
+ */
+void execute_cmd( jobs_t* jobs, const char* cmd )
+{
+  if ( !jobs_start( jobs, cmd ) )
+    {
+      /* Failure. */
+      take_error( "Could not execute: \"%s\"\n  reason: \"%s\"",
+                  cmd,
+                  strerror( errno )
+                  );
+    }
+}
+
+
+/**
+ * View lines from "view_sl" on top of "sl". After viewing the "sl"
+ * status is reverted back on display. Used for help and commands
+ * view.
+ *
+ * @param sl Select_lines object.
+ * @param view_sl View list.
+ */
+void select_lines_view( select_lines_t* sl, select_lines_t* view_sl )
+{
+  win_info* wi;
+
+  /* Current view list for window resize purposes. */
+  screen_win_resize_context = view_sl;
+
+  /* Copy window state. */
+  view_sl->list_wi = sl->list_wi;
+  view_sl->prompt = sl->prompt;
+  view_sl->line_status = sl->line_status;
+  view_sl->find_status = sl->find_status;
+  wi = view_sl->list_wi;
+
+
+  /* Display all lines. */
+  select_lines_display( view_sl );
+
+
+  int key;
+  bool_t done = mc_false;
+
+  /* Get user input. */
+  mc_loop
+    {
+      key = screen_get_key();
+
+      switch ( key )
+        {
+
+        case ESC:
+        case CTRL_G:
+        case NEWLINE:
+          done = mc_true;
+          break;
+
+        case 'n':
+          if ( wi->y != WI_Y_MAX( wi ) )
+            select_lines_move_down_n( view_sl, WI_Y_MAX( wi ) - wi->y );
+          else
+            select_lines_move_down_n( view_sl, WI_Y_SIZE( wi ) );
+          break;
+
+        case 'p':
+          if ( wi->y != 0 )
+            select_lines_move_up_n( view_sl, wi->y );
+          else
+            select_lines_move_up_n( view_sl, WI_Y_SIZE( wi ) );
+          break;
+
+
+        default:
+          break;
+        }
+
+      if ( done )
+        break;
+
+      select_lines_display( view_sl );
+
+    }
+
+  /* Revert back to original. */
+  screen_win_resize_context = sl;
+
+}
+
+
+/**
+ * Show command help on screen.
+ *
+ * NOTE: Keep the help list in sync with the manual page.
+ *
+ * @param sl Select_lines object.
+ */
+void show_command_help( select_lines_t* sl )
+{
+  char* help_list[ ] = {
+    "\"J\": Toggle selection and move down",
+    "\"K\": Toggle selection and move up",
+    "\"j\": Move down",
+    "\"k\": Move up",
+    "\"n\": Move down page",
+    "\"p\": Move up page",
+    "\"b\": Move to beginning of list",
+    "\"e\": Move to end of list",
+    "\"g\": Goto to line",
+    "\"s\": Select current",
+    "\"r\": Reject current,"
+    "\"t\": Toggle current",
+    "\"S\": Select all items",
+    "\"R\": Reject all items",
+    "\"T\": Toggle all items",
+    "\"c\": Toggle the next \"count\" items",
+    "\"u\": Undo the last selection change",
+    "C-r: Redo the last undone selection change",
+    "\"m\": Select items matching the prompted regexp (case insensitive)",
+    "\"M\": Select items matching the prompted regexp (case sensitive)",
+    "\"o\": Sort items by the prompted field (with --delimiter)",
+    "\"f\": Find mode with case sensitive matching (Keys: j,k,s,r,t,RET,ESC)",
+    "\"F\": Find mode with case insensitive matching (Keys: j,k,s,r,t,RET,ESC)",
+    "\"/\": Filter mode with fuzzy matching (Keys: C-n,C-p,C-t,RET,ESC)",
+    "\"v\": View the list of commands that would be executed",
+    "\"i\": View the current list entry content (Keys: j,k,n,p,b,e,RET,ESC)",
+    "\"l\": Center list view on screen around current line",
+    "\">\": Scroll long lines right",
+    "\"<\": Scroll long lines left",
+    "\"h\": Show command help",
+    "ESC: Stop input loading (with --stream) or pattern matching",
+    "\"x\": Quit and execute output-command for selection",
+    "\"q\": Quit and skip output-command execution",
+    NULL
+  };
+
+  select_lines_t* help_sl;
+
+  help_sl = select_lines_new();
+
+  for ( int i = 0; help_list[i]; i++ )
+    select_lines_add_copy( help_sl, help_list[i] );
+
+  select_lines_view( sl, help_sl );
+
+  select_lines_rem( help_sl );
+}
+
+
+/**
+ * File preview. File is mapped to memory and lines are indexed only
+ * upto the viewed part. Offset of every TAKE_PREVIEW_STRIDE:th line
+ * is stored in the index.
+ */
+typedef struct file_view_s {
+  select_lines_t* sl;       /**< Owner of windows. */
+  char* data;               /**< File content. */
+  size_t size;              /**< File size. */
+  mci_p index;              /**< Sparse line offset index. */
+  line_index_t lines;       /**< Number of lines found so far. */
+  size_t scanned;           /**< Scan position, i.e. start of next line. */
+  line_index_t firstline;   /**< First visible line. */
+} file_view_t;
+
+
+/**
+ * Find lines from file until "line" is found (or file ends).
+ *
+ * @param fv File_view object.
+ * @param line Line index.
+ */
+void file_view_scan( file_view_t* fv, line_index_t line )
+{
+  char* nl;
+
+  while ( fv->lines <= line && fv->scanned < fv->size )
+    {
+      if ( fv->lines % TAKE_PREVIEW_STRIDE == 0 )
+        mci_append( fv->index, fv->scanned );
+      fv->lines++;
+
+      nl = memchr( fv->data + fv->scanned, '\n', fv->size - fv->scanned );
+      if ( nl )
+        fv->scanned = ( nl - fv->data ) + 1;
+      else
+        fv->scanned = fv->size;
+    }
+}
+
+
+/**
+ * Return line content from file (line has to be scanned).
+ *
+ * @param [in] fv File_view object.
+ * @param [in] line Line index.
+ * @param [out] len Line length.
+ *
+ * @return Line start (not terminated).
+ */
+char* file_view_line( file_view_t* fv, line_index_t line, size_t* len )
+{
+  char* pos;
+  char* end = fv->data + fv->size;
+  char* nl;
+
+  /* Nearest indexed line and then skip the rest. */
+  pos = fv->data + mci_nth( fv->index, line / TAKE_PREVIEW_STRIDE );
+  for ( int i = 0; i < line % TAKE_PREVIEW_STRIDE; i++ )
+    pos = (char*) memchr( pos, '\n', end - pos ) + 1;
+
+  nl = memchr( pos, '\n', end - pos );
+  *len = ( nl ? nl : end ) - pos;
+
+  return pos;
+}
+
+
+/**
+ * Display the visible part of file.
+ *
+ * @param fv File_view object.
+ */
+void file_view_display( file_view_t* fv )
+{
+  select_lines_t* sl = fv->sl;
+  win_info* wi = sl->list_wi;
+  char* text;
+  size_t len;
+
+  /* One extra line in order to know if there is more. */
+  file_view_scan( fv, fv->firstline + WI_Y_SIZE(wi) );
+
+  line_status_set( sl, fv->firstline + 1, fv->lines, -1,
+                   fv->scanned < fv->size );
+  prompt_refresh( sl->line_status );
+  prompt_refresh( sl->find_status );
+  prompt_refresh( sl->prompt );
+
+  screen_clear_win( wi );
+
+  for ( int i = WI_Y_MIN(wi);
+        i < WI_Y_SIZE(wi) && ( fv->firstline + i ) < fv->lines;
+        i++ )
+    {
+      text = file_view_line( fv, fv->firstline + i, &len );
+
+      /* Only the visible part of line is rendered. */
+      if ( screen_setpos( wi, 2, i ) )
+        screen_set_text( wi, text, len, 0, NULL, -1 );
+    }
+
+  screen_setpos( wi, 0, 0 );
+  screen_refresh( wi );
+}
+
+
+/**
+ * Callback for terminal window resizing during file preview.
+ *
+ * @param data Callback context (i.e. File_view object).
+ */
+void file_view_resize_callback( void* data )
+{
+  file_view_display( data );
+}
+
+
+/**
+ * Scroll file view to line (limited to file).
+ *
+ * @param fv File_view object.
+ * @param line First visible line.
+ */
+void file_view_goto( file_view_t* fv, line_index_t line )
+{
+  file_view_scan( fv, line );
+
+  if ( line > fv->lines - 1 )
+    line = fv->lines - 1;
+  if ( line < 0 )
+    line = 0;
+
+  fv->firstline = line;
+}
+
+
+/**
+ * Release file content of file view.
+ *
+ * @param fv File_view object.
+ */
+void file_view_unmap( file_view_t* fv )
+{
+#ifdef HAVE_MMAP
+  munmap( fv->data, fv->size );
+#else
+  mc_free( fv->data );
+#endif
+  fv->data = NULL;
+}
+
+
+/**
+ * Check if file content looks like text, i.e. the beginning of file
+ * does not contain NUL chars.
+ *
+ * @param data File content.
+ * @param size File size.
+ *
+ * @return True for text.
+ */
+bool_t file_is_text( const char* data, size_t size )
+{
+  if ( size > TAKE_PREVIEW_SNIFF )
+    size = TAKE_PREVIEW_SNIFF;
+
+  return ( memchr( data, 0, size ) == NULL );
+}
+
+
+/**
+ * Show file content on screen. File is viewed page by page and only
+ * the viewed part of file is read, thus file size does not matter.
+ *
+ * @param sl Select_lines object.
+ * @param filename Filename for file to display.
+ */
+void show_file_content( select_lines_t* sl, char* filename )
+{
+  file_view_t fv;
+  struct stat st;
+  int fd;
+
+  fd = open( filename, O_RDONLY );
+  if ( fd < 0 )
+    /* Can't open file, abort. */
+    return;
+
+  if ( fstat( fd, &st ) != 0 || !S_ISREG( st.st_mode ) )
+    {
+      close( fd );
+      return;
+    }
+
+  fv.sl = sl;
+  fv.size = st.st_size;
+  fv.data = NULL;
+
+  if ( fv.size > 0 )
+    {
+#ifdef HAVE_MMAP
+      fv.data = mmap( NULL, fv.size, PROT_READ, MAP_PRIVATE, fd, 0 );
+      if ( fv.data == MAP_FAILED )
+        fv.data = NULL;
+#else
+      /* No mapping, read the whole file. */
+      ssize_t ret;
+      fv.data = mc_new_n( char, fv.size );
+      for ( size_t pos = 0; pos < fv.size; pos += ret )
+        {
+          ret = read( fd, fv.data + pos, fv.size - pos );
+          if ( ret <= 0 )
+            {
+              fv.size = pos;
+              break;
+            }
+        }
+#endif
+    }
+
+  close( fd );
+
+  if ( fv.size > 0 && ( !fv.data || !file_is_text( fv.data, fv.size ) ) )
+    {
+      if ( fv.data )
+        file_view_unmap( &fv );
+      prompt_msg( sl->prompt, "Not a text file!" );
+      return;
+    }
+
+  fv.index = mci_new();
+  fv.lines = 0;
+  fv.scanned = 0;
+  fv.firstline = 0;
+
+  /* Preview handles window resizing. */
+  void* resize_context = screen_win_resize_context;
+  screen_callback resize_callback = screen_post_win_resize;
+  screen_win_resize_context = &fv;
+  screen_post_win_resize = file_view_resize_callback;
+
+  win_info* wi = sl->list_wi;
+  int key;
+  bool_t done = mc_false;
+
+  file_view_display( &fv );
+
+  mc_loop
+    {
+      key = screen_get_key();
+
+      switch ( key )
+        {
+
+        case ESC:
+        case CTRL_G:
+        case NEWLINE:
+        case 'q':
+          done = mc_true;
+          break;
+
+        case 'j':
+          file_view_goto( &fv, fv.firstline + 1 );
+          break;
+
+        case 'k':
+          file_view_goto( &fv, fv.firstline - 1 );
+          break;
+
+        case 'n':
+          file_view_goto( &fv, fv.firstline + WI_Y_SIZE( wi ) );
+          break;
+
+        case 'p':
+          file_view_goto( &fv, fv.firstline - WI_Y_SIZE( wi ) );
+          break;
+
+        case 'b':
+          file_view_goto( &fv, 0 );
+          break;
+
+        case 'e':
+          /* Index the whole file. */
+          file_view_scan( &fv, fv.size );
+          file_view_goto( &fv, fv.lines - WI_Y_SIZE( wi ) );
+          break;
+
+        default:
+          break;
+        }
+
+      if ( done )
+        break;
+
+      if ( !screen_skip_refresh() )
+        file_view_display( &fv );
+    }
+
+  screen_win_resize_context = resize_context;
+  screen_post_win_resize = resize_callback;
+
+  mci_del( fv.index );
+  if ( fv.data )
+    file_view_unmap( &fv );
+}
+
+
+/** Output-command generation modes. */
+typedef enum cmd_mode_e { cmd_each, cmd_join, cmd_group } cmd_mode_t;
+
+
+/**
+ * Generator for output-command args, i.e. commands are created one
+ * at a time from the selection.
+ */
+typedef struct cmd_gen_s {
+  select_lines_t* sl;      /**< Lines with selection. */
+  cmd_template_t* tmpl;    /**< Command template. */
+  cmd_mode_t mode;         /**< Generation mode. */
+  char* join_str;          /**< Join string (cmd_join). */
+  line_index_t max_items;  /**< Max items per command, 0 for no limit (cmd_group). */
+  size_t max_len;          /**< Max command length (cmd_group). */
+  line_index_t next;       /**< Next selected line. */
+  mci_p order;             /**< Selected lines in selection order (or NULL). */
+  mc_size_t pos;           /**< Next position in order. */
+  bool_t done;             /**< All commands generated (cmd_join). */
+  char* text;              /**< Text buffer for item (shared-prefix storage). */
+  mc_size_t text_size;     /**< Text buffer size. */
+  cmd_arg_t args[ FIELD_MAX + 1 ]; /**< Slot replacements by field (0 for whole item). */
+} cmd_gen_t;
+
+
+/**
+ * Initialize command generator for selected items, using
+ * output_command and join options.
+ *
+ * @param g Command generator.
+ * @param sl Select_lines object.
+ */
+void cmd_gen_init( cmd_gen_t* g, select_lines_t* sl )
+{
+  como_opt_t* opt;
+  char* command = output_command;
+
+  if ( !command )
     /* No command to use, so use the default command. */
     command = "echo @";
 
+  g->sl = sl;
+  g->tmpl = cmd_template_new( command, ( sl->fields != NULL ) );
+  g->mode = cmd_each;
+  g->join_str = NULL;
+  g->max_items = 0;
+  g->max_len = 0;
+  g->order = NULL;
+  g->pos = 0;
+  g->done = mc_false;
+  g->text = NULL;
+  g->text_size = 0;
+
+  if ( order_selection )
+    {
+      g->order = journal_order( sl->journal, sl->marks );
+      g->next = ( g->order->used > 0 ) ? mci_nth( g->order, 0 ) : MCB_INVALID_INDEX;
+    }
+  else
+    {
+      g->next = mcb_next( sl->marks, 0 );
+    }
+
+  for ( int f = 0; f <= FIELD_MAX; f++ )
+    {
+      g->args[ f ].str = "";
+      g->args[ f ].len = 0;
+      g->args[ f ].buf = NULL;
+    }
+
+  if ( (opt = como_given( "join" ) ) )
+    {
+      /* Join all selected items with join string. */
+      g->mode = cmd_join;
+      if ( opt->valuecnt > 0 )
+        g->join_str = opt->value[ 0 ];
+      else
+        g->join_str = " ";
+    }
+  else if ( (opt = como_given( "xargs" ) ) )
+    {
+      /* Join groups of selected items with SPACE, so that each
+         command fits to command length limit. Optional option value
+         limits the number of items per command. */
+      g->mode = cmd_group;
+      g->max_len = cmd_max_len();
+      g->join_str = " ";
+      if ( opt->valuecnt > 0 )
+        g->max_items = strtol( opt->value[ 0 ], NULL, 0 );
+    }
+
+  if ( g->mode != cmd_each )
+    {
+      for ( int f = 0; f <= FIELD_MAX; f++ )
+        {
+          if ( g->tmpl->used[ f ] )
+            g->args[ f ].buf = mcc_new_size( 1024 );
+        }
+    }
+}
+
+
+/**
+ * Free command generator resources.
+ *
+ * @param g Command generator.
+ */
+void cmd_gen_rem( cmd_gen_t* g )
+{
+  cmd_template_rem( g->tmpl );
+  for ( int f = 0; f <= FIELD_MAX; f++ )
+    {
+      if ( g->args[ f ].buf )
+        mcc_del( g->args[ f ].buf );
+    }
+  if ( g->order )
+    mci_del( g->order );
+  if ( g->text )
+    mc_free( g->text );
+}
+
+
+/**
+ * Advance to the next selected line, in line order or in selection
+ * order.
+ *
+ * @param g Command generator.
+ */
+static inline void cmd_gen_advance( cmd_gen_t* g )
+{
+  if ( g->order )
+    {
+      g->pos++;
+      g->next = ( g->pos < g->order->used ) ? mci_nth( g->order, g->pos ) : MCB_INVALID_INDEX;
+    }
+  else
+    {
+      g->next = mcb_next( g->sl->marks, g->next+1 );
+    }
+}
+
+
+/**
+ * Return item part for slot, i.e. line or its field.
+ *
+ * @param [in] g Command generator.
+ * @param [in] idx Line index.
+ * @param [in] field Field (0 for whole line).
+ * @param [out] len Part length.
+ *
+ * @return Part (empty if line has no such field).
+ */
+static const char* cmd_gen_item( cmd_gen_t* g, line_index_t idx, int field, size_t* len )
+{
+  const char* text = select_lines_text_buf( g->sl, idx, &g->text, &g->text_size );
+  const char* str;
+  mc_size_t field_len;
+
+  if ( field == 0 )
+    {
+      *len = strlen( text );
+      return text;
+    }
+
+  str = field_get( g->sl->fields, text, idx, field, &field_len );
+  if ( !str )
+    {
+      *len = 0;
+      return "";
+    }
 
+  *len = field_len;
 
-  if ( (opt = como_given( "join" ) ) )
+  return str;
+}
+
+
+/**
+ * Add item to joined args.
+ *
+ * @param g Command generator.
+ * @param idx Line index.
+ * @param first Item is the first one in command.
+ */
+static void cmd_gen_join_item( cmd_gen_t* g, line_index_t idx, bool_t first )
+{
+  const char* str;
+  size_t len;
+
+  for ( int f = 0; f <= FIELD_MAX; f++ )
     {
-      char* join_str;
+      if ( !g->args[ f ].buf )
+        continue;
 
-      /* Join all selected items with join string. */
+      if ( !first )
+        mcc_append_n( g->args[ f ].buf, g->join_str, strlen( g->join_str ) );
+      str = cmd_gen_item( g, idx, f, &len );
+      mcc_append_n( g->args[ f ].buf, (char*) str, len );
+    }
+}
 
-      if ( opt->valuecnt > 0 )
-        join_str = opt->value[ 0 ];
-      else
-        join_str = " ";
 
-      select_line_t* line;
-      bool_t nonfirst = mc_false;
+/**
+ * Return the length that item adds to command (cmd_group).
+ *
+ * @param g Command generator.
+ * @param idx Line index.
+ *
+ * @return Length with separators.
+ */
+static size_t cmd_gen_item_len( cmd_gen_t* g, line_index_t idx )
+{
+  size_t total = 0;
+  size_t len;
+
+  for ( mc_size_t i = 0; i < g->tmpl->fields->used; i++ )
+    {
+      cmd_gen_item( g, idx, mci_nth( g->tmpl->fields, i ), &len );
+      total += 1 + len;
+    }
+
+  return total;
+}
 
-      mcc_reset( strbuf );
-      for ( line_index_t i = 0; i < sl->lines->used; i++ )
+
+/**
+ * Produce args for the next command. For single item commands args
+ * refer to the line directly.
+ *
+ * @param g Command generator.
+ *
+ * @return True if args were produced (false at end).
+ */
+bool_t cmd_gen_next( cmd_gen_t* g )
+{
+  line_index_t items = 0;
+
+  switch ( g->mode )
+    {
+
+    case cmd_each:
+      if ( g->next == MCB_INVALID_INDEX )
+        return mc_false;
+      for ( int f = 0; f <= FIELD_MAX; f++ )
         {
-          line = mcp_nth( sl->lines, i );
-          if ( line->marked )
-            {
-              if ( nonfirst )
-                mcc_append_n( strbuf, join_str, strlen( join_str ) );
-              else
-                nonfirst = mc_true;
+          if ( g->tmpl->used[ f ] )
+            g->args[ f ].str = cmd_gen_item( g, g->next, f, &g->args[ f ].len );
+        }
+      cmd_gen_advance( g );
+      return mc_true;
+
+    case cmd_join:
+      /* Single command, even for empty selection. */
+      if ( g->done )
+        return mc_false;
+      for ( int f = 0; f <= FIELD_MAX; f++ )
+        {
+          if ( g->args[ f ].buf )
+            mcc_reset( g->args[ f ].buf );
+        }
+      for ( ; g->next != MCB_INVALID_INDEX;
+            cmd_gen_advance( g ) )
+        {
+          cmd_gen_join_item( g, g->next, ( items == 0 ) );
+          items++;
+        }
+      g->done = mc_true;
+      break;
 
-              mcc_append_n( strbuf, line->text, strlen( line->text ) );
+    case cmd_group:
+      if ( g->next == MCB_INVALID_INDEX )
+        return mc_false;
+      for ( int f = 0; f <= FIELD_MAX; f++ )
+        {
+          if ( g->args[ f ].buf )
+            {
+              mcc_reset( g->args[ f ].buf );
+              g->args[ f ].len = 0;
+            }
+        }
+      for ( ; g->next != MCB_INVALID_INDEX;
+            cmd_gen_advance( g ) )
+        {
+          if ( items > 0 &&
+               ( ( g->max_items > 0 && items >= g->max_items ) ||
+                 cmd_template_len( g->tmpl, g->args )
+                 + cmd_gen_item_len( g, g->next ) > g->max_len ) )
+            /* Group is full. */
+            break;
+
+          cmd_gen_join_item( g, g->next, ( items == 0 ) );
+          for ( int f = 0; f <= FIELD_MAX; f++ )
+            {
+              if ( g->args[ f ].buf )
+                g->args[ f ].len = g->args[ f ].buf->used;
             }
+          items++;
+        }
+      break;
+    }
+
+  for ( int f = 0; f <= FIELD_MAX; f++ )
+    {
+      if ( g->args[ f ].buf )
+        {
+          g->args[ f ].str = mcc_to_str( g->args[ f ].buf );
+          g->args[ f ].len = g->args[ f ].buf->used;
         }
+    }
+
+  return mc_true;
+}
+
+
+/**
+ * Create a list of shell command executions for selected items.
+ *
+ * @param sl Select_lines object.
+ *
+ * @return Command list.
+ */
+select_lines_t* select_lines_create_commands( select_lines_t* sl )
+{
+  select_lines_t* cmds;
+  cmd_gen_t gen;
+
+  cmds = select_lines_new();
+
+  cmd_gen_init( &gen, sl );
+
+  while ( cmd_gen_next( &gen ) )
+    {
+      cmd_template_expand( gen.tmpl, gen.args, strbuf );
+      select_lines_add_copy( cmds, mcc_to_str( strbuf ) );
+    }
+
+  cmd_gen_rem( &gen );
+
+  return cmds;
+}
+
+
+/**
+ * Poll function for background matching in interactive mode (see
+ * worker_run_poll()). Progress is shown in line status, and ESC or
+ * CTRL-G cancels matching. Other keys are discarded.
+ *
+ * @param context Select_lines object.
+ * @param done Matched chunk count.
+ * @param tasks Chunk count.
+ *
+ * @return False if matching is cancelled.
+ */
+bool_t select_lines_progress( void* context, int done, int tasks )
+{
+  select_lines_t* sl = context;
+  char msg[ 32 ];
+  int key;
+
+  while ( ( key = screen_poll_key() ) != -1 )
+    {
+      if ( key == ESC || key == CTRL_G )
+        return mc_false;
+    }
+
+  sprintf( msg, "matching %d%%", ( done * 100 ) / tasks );
+  prompt_label( sl->line_status, msg );
+  prompt_refresh( sl->line_status );
+  screen_refresh( sl->list_wi );
+
+  return mc_true;
+}
+
 
-      char* tmpstr;
+/**
+ * Select all lines that match the regex pattern. Matching is done in
+ * background and it can be cancelled (see select_lines_progress()),
+ * in which case marks are not changed.
+ *
+ * @param sl Select_lines object.
+ * @param pattern Regex pattern.
+ * @param case_sensitive Case sensitivity option.
+ */
+void select_lines_mark_matching( select_lines_t* sl,
+                                 char* pattern,
+                                 bool_t case_sensitive )
+{
+  matcher_t* m;
 
-      /* Take of strbuf before its overwritten. */
-      tmpstr = mc_strdup( mcc_to_str( strbuf ) );
+  m = matcher_new( pattern, case_sensitive, literal_patterns, sl->fields, sl->paths );
 
-      /* Create command. */
-      process_cmd_escapes( command, tmpstr, strbuf );
+  if ( !m )
+    {
+      prompt_msg( sl->prompt, "Error in regexp!" );
+      return;
+    }
 
-      /* Free the copy. */
-      mc_free( tmpstr );
+  journal_begin( sl->journal, sl->marks, 0, sl->lines->used );
 
-      line = select_line_new( mc_strdup( mcc_to_str( strbuf ) ) );
-      mcp_append( cmds->lines, line );
+  if ( !matcher_mark( m, (char**) sl->lines->data, 0, sl->lines->used,
+                      sl->marks, select_lines_progress, sl ) )
+    {
+      /* Marks are not changed, i.e. nothing is recorded. */
+      journal_end( sl->journal, sl->marks );
+      prompt_msg( sl->prompt, "Matching cancelled!" );
+      matcher_rem( m );
+      return;
     }
+
+  /* Matching only sets marks. Rule is recorded for undo. */
+  sl->marked += journal_end_rule( sl->journal, sl->marks,
+                                  sl->rules ? m : NULL );
+
+  if ( sl->rules )
+    /* Mark also the lines that are not read yet. */
+    mcp_append( sl->rules->patterns, m );
   else
+    matcher_rem( m );
+}
+
+
+/**
+ * Move match rule from rule list to another, i.e. undo of "m" removes
+ * the rule for the lines that are not read yet, and redo adds it
+ * back. Rule is not moved if it is not in list.
+ *
+ * @param from Rule list of rule.
+ * @param to Rule list for rule.
+ * @param rule Matcher object.
+ */
+void select_lines_rule_move( mcp_p from, mcp_p to, void* rule )
+{
+  mc_size_t pos = mcp_find_idx( from, rule );
+
+  if ( pos == (mc_size_t) MCP_INVALID_INDEX )
+    return;
+
+  mcp_delete_at( from, pos );
+  mcp_append( to, rule );
+}
+
+
+/**
+ * Create empty preselection rules for Select_lines.
+ *
+ * @param sl Select_lines object.
+ */
+void select_lines_rules_new( select_lines_t* sl )
+{
+  sl->rules = mc_new( arrival_rules_t );
+  sl->rules->mark_all = mc_false;
+  sl->rules->patterns = mcp_new();
+  sl->rules->undone = mcp_new();
+  sl->rules->names = NULL;
+  sl->rules->toggles = mcb_new();
+}
+
+
+/**
+ * Free preselection rules of Select_lines.
+ *
+ * @param sl Select_lines object.
+ */
+void select_lines_rules_rem( select_lines_t* sl )
+{
+  for ( int i = 0; i < sl->rules->patterns->used; i++ )
+    matcher_rem( mcp_nth( sl->rules->patterns, i ) );
+
+  mcp_del( sl->rules->patterns );
+  for ( int i = 0; i < sl->rules->undone->used; i++ )
+    matcher_rem( mcp_nth( sl->rules->undone, i ) );
+  mcp_del( sl->rules->undone );
+  if ( sl->rules->names )
+    strset_del( sl->rules->names );
+  mcb_del( sl->rules->toggles );
+  mc_free( sl->rules );
+  sl->rules = NULL;
+}
+
+
+/**
+ * Poll function for preselection matching before interaction, i.e.
+ * interrupt (CTRL-C) cancels matching (see list_cancel_handler()).
+ *
+ * @param context Select_lines object.
+ * @param done Matched chunk count.
+ * @param tasks Chunk count.
+ *
+ * @return False if matching is cancelled.
+ */
+bool_t select_lines_presel_progress( void* context, int done, int tasks )
+{
+  return !list_cancelled;
+}
+
+
+/**
+ * Apply preselection rules to lines in range [begin,end). With poll
+ * function pattern matching is done in background, and the patterns
+ * whose matching is cancelled are dropped from rules.
+ *
+ * @param sl Select_lines object.
+ * @param begin Range start.
+ * @param end Range end (exclusive).
+ * @param poll Poll function for matching (or NULL).
+ */
+void select_lines_rules_apply( select_lines_t* sl,
+                               line_index_t begin,
+                               line_index_t end,
+                               worker_poll_func_t poll )
+{
+  arrival_rules_t* rules = sl->rules;
+  matcher_t* m;
+  line_index_t cnt = mcb_count_range( sl->marks, begin, end );
+
+  /* Preselection is not recorded to undo journal, but the marked
+     lines are logged to selection order. */
+  journal_begin( sl->journal, sl->marks, begin, end );
+
+  if ( rules->mark_all )
+    mcb_set_range( sl->marks, begin, end );
+
+  for ( int p = 0; p < rules->patterns->used; p++ )
+    {
+      m = mcp_nth( rules->patterns, p );
+      if ( !matcher_mark( m, (char**) sl->lines->data, begin, end,
+                          sl->marks, poll, sl ) )
+        {
+          matcher_rem( m );
+          mcp_delete_at( rules->patterns, p-- );
+        }
+    }
+
+  if ( rules->names )
+    strset_mark( rules->names, (char**) sl->lines->data, sl->paths,
+                 begin, end, sl->marks );
+
+  for ( line_index_t i = mcb_next( rules->toggles, begin );
+        i != MCB_INVALID_INDEX && i < end;
+        i = mcb_next( rules->toggles, i+1 ) )
     {
+      mcb_toggle( sl->marks, i );
+    }
+
+  journal_end_log( sl->journal, sl->marks );
+  sl->marked += mcb_count_range( sl->marks, begin, end ) - cnt;
+}
+
+
+/**
+ * Record input statistics when input is complete (or closed).
+ *
+ * @param sl Select_lines object.
+ */
+void select_lines_load_done( select_lines_t* sl )
+{
+  stats.input_lines = sl->lines->used;
+  stats.load_time = stats_now() - stats.load_start;
+}
+
+
+/**
+ * Start progressive input from file descriptor. Reading blocks until
+ * the first line is available. If input is not complete after that,
+ * the rest is read with select_lines_load().
+ *
+ * @param sl Select_lines object.
+ * @param fd Input file descriptor.
+ * @param pid Input command process (or 0).
+ */
+void select_lines_load_start( select_lines_t* sl, int fd, pid_t pid )
+{
+  line_reader_t* lr;
 
-      /* Create command for each selected item individually. */
+  lr = mc_new( line_reader_t );
+  line_reader_init( lr, fd );
+  lr->pid = pid;
+  sl->reader = lr;
 
-      select_line_t* line;
-      for ( line_index_t i = 0; i < sl->lines->used; i++ )
+  while ( sl->lines->used == 0 )
+    {
+      if ( line_reader_read( sl, lr ) == 0 )
         {
-          line = mcp_nth( sl->lines, i );
-          if ( line->marked )
-            {
-              /* Create command. */
-              process_cmd_escapes( command, line->text, strbuf );
-              line = select_line_new( mc_strdup( mcc_to_str( strbuf ) ) );
-              mcp_append( cmds->lines, line );
-            }
+          /* Input was complete already. */
+          select_lines_load_close( sl );
+          return;
+        }
+    }
+
+  fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK );
+}
+
+
+/**
+ * Close progressive input. Input command is terminated if input is
+ * not complete, i.e. loading is cancelled.
+ *
+ * @param sl Select_lines object.
+ */
+void select_lines_load_close( select_lines_t* sl )
+{
+  line_reader_close( sl->reader );
+
+  mc_free( sl->reader );
+  sl->reader = NULL;
+
+  select_lines_load_done( sl );
+}
+
+
+/**
+ * Read the available part of progressive input. Reading is limited to
+ * a short time slot in order to keep the user interface responsive.
+ * Preselection rules are applied to the new lines.
+ *
+ * @param sl Select_lines object.
+ *
+ * @return True if lines were added.
+ */
+bool_t select_lines_load( select_lines_t* sl )
+{
+  line_index_t begin = sl->lines->used;
+  struct timespec start, now;
+  ssize_t ret;
+
+  clock_gettime( CLOCK_MONOTONIC, &start );
+
+  mc_loop
+    {
+      ret = line_reader_read( sl, sl->reader );
+
+      if ( ret == 0 )
+        {
+          select_lines_load_close( sl );
+          break;
         }
 
+      if ( ret < 0 )
+        /* No data available now. */
+        break;
+
+      clock_gettime( CLOCK_MONOTONIC, &now );
+      if ( ( now.tv_sec - start.tv_sec ) * 1000 +
+           ( now.tv_nsec - start.tv_nsec ) / 1000000 >= TAKE_LOAD_SLOT )
+        break;
     }
 
-  return cmds;
+  select_lines_fields_update( sl );
+
+  if ( sl->rules )
+    {
+      select_lines_rules_apply( sl, begin, sl->lines->used, NULL );
+
+      /* All rules are used when input is complete. */
+      if ( !sl->reader )
+        select_lines_rules_rem( sl );
+    }
+
+  return ( begin != sl->lines->used );
+}
+
+
+/**
+ * Read the rest of progressive input.
+ *
+ * @param sl Select_lines object.
+ */
+void select_lines_load_all( select_lines_t* sl )
+{
+  int fd = sl->reader->fd;
+
+  fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) & ~O_NONBLOCK );
+
+  while ( sl->reader )
+    select_lines_load( sl );
+}
+
+
+/**
+ * Cancel progressive input, i.e. the lines read so far are kept.
+ *
+ * @param sl Select_lines object.
+ */
+void select_lines_load_cancel( select_lines_t* sl )
+{
+  select_lines_load_close( sl );
+
+  /* Rules are applied to all arrived lines already. */
+  if ( sl->rules )
+    select_lines_rules_rem( sl );
+
+  screen_idle = NULL;
 }
 
 
 /**
- * Remove Regex object.
+ * Screen idle callback for progressive input (screen_idle).
  *
- * @param re Regex object.
+ * @param data Callback context (i.e. Select_lines object).
  */
-void regex_rem( regex_t* re )
+void select_lines_load_idle( void* data )
 {
-  if ( re )
+  select_lines_t* sl = data;
+
+  if ( select_lines_load( sl ) || !sl->reader )
     {
-      regfree( re );
-      mc_free( re );
+      /* Show new lines (unless some other list is viewed). */
+      if ( screen_win_resize_context == sl )
+        select_lines_display( sl );
     }
+
+  if ( !sl->reader )
+    /* Input complete. */
+    screen_idle = NULL;
 }
 
 
+/** Match index for find mode. */
+typedef struct find_index_s {
+  matcher_t* m;            /**< Matcher for pattern. */
+  mci_p hits;              /**< Matching lines in ascending order. */
+  line_index_t indexed;    /**< Number of lines in index scope. */
+} find_index_t;
+
+
 /**
- * Create Regex object from pattern either in case sensitive or
- * insensitive mode.
+ * Include new lines to Find_index. All lines are matched at first
+ * update and later only the lines that have arrived after previous
+ * update (progressive input). Matching is done in background and it
+ * can be cancelled (see select_lines_progress()), in which case the
+ * index is not changed.
  *
- * @param pattern Regex pattern.
- * @param case_sensitive Case sensitivity option.
+ * @param sl Select_lines object.
+ * @param fi Find_index object.
  *
- * @return Regex object (or NULL on failure).
+ * @return False if matching was cancelled.
  */
-regex_t* regex_new( char* pattern, bool_t case_sensitive )
+bool_t find_index_update( select_lines_t* sl, find_index_t* fi )
 {
-  regex_t* re;
-  int ret;
-
-  re = mc_new( regex_t );
-
-  if ( case_sensitive )
-    ret = regcomp( re, pattern,
-                   REG_EXTENDED | REG_NOSUB );
-  else
-    ret = regcomp( re, pattern,
-                   REG_EXTENDED | REG_ICASE | REG_NOSUB );
-
-  if ( ret != 0 )
+  if ( fi->indexed < sl->lines->used )
     {
-      /* Failure. */
-      regex_rem( re );
-      re = NULL;
+      if ( !matcher_index( fi->m, (char**) sl->lines->data,
+                           fi->indexed, sl->lines->used, fi->hits,
+                           select_lines_progress, sl ) )
+        return mc_false;
+      fi->indexed = sl->lines->used;
     }
 
-  return re;
+  return mc_true;
 }
 
 
 /**
- * Select all lines that match the regex pattern.
+ * Show match position (or count) in prompt.
  *
  * @param sl Select_lines object.
- * @param pattern Regex pattern.
- * @param case_sensitive Case sensitivity option.
+ * @param fi Find_index object.
  */
-void select_lines_mark_matching( select_lines_t* sl,
-                                 char* pattern,
-                                 bool_t case_sensitive )
+void find_index_status( select_lines_t* sl, find_index_t* fi )
 {
-  regex_t* re;
+  mc_size_t pos;
+  char msg[ 64 ];
 
-  re = regex_new( pattern, case_sensitive );
-
-  if ( !re )
-    {
-      prompt_msg( sl->prompt, "Error in regexp!" );
-      return;
-    }
+  pos = mci_lower_bound( fi->hits, sl->curline );
 
-  select_line_t* line;
-  for ( line_index_t i = 0; i < sl->lines->used; i++ )
-    {
-      line = mcp_nth( sl->lines, i );
-      if ( regexec( re, line->text, 0, NULL, 0 ) == 0 )
-        line->marked = mc_true;
-    }
+  if ( pos < fi->hits->used && mci_nth( fi->hits, pos ) == sl->curline )
+    sprintf( msg, "match %ld/%ld", (long) pos + 1, (long) fi->hits->used );
+  else
+    sprintf( msg, "matches: %ld", (long) fi->hits->used );
 
-  regex_rem( re );
+  prompt_label( sl->prompt, msg );
 }
 
 
 /**
- * Find the next (either forward or backward) line matching the Regex
- * object.
+ * Find the next (either forward or backward) line matching the
+ * Find_index pattern. Current line is included to search.
  *
  * @param sl Select_lines object.
- * @param re Regex object.
+ * @param fi Find_index object.
  * @param forward Seach direction.
  *
  * @return The number of steps required to selected direction to reach
  *   the line (-1 if re not found).
  */
-line_index_t select_lines_find_next( select_lines_t* sl, regex_t* re, bool_t forward )
+line_index_t select_lines_find_next( select_lines_t* sl, find_index_t* fi, bool_t forward )
 {
-  line_index_t offset, limit;
+  mc_size_t pos;
+
+  find_index_update( sl, fi );
+
+  pos = mci_lower_bound( fi->hits, sl->curline );
 
   if ( forward )
     {
-      offset = 1;
-      limit = sl->lines->used;
+      if ( pos < fi->hits->used )
+        return mci_nth( fi->hits, pos ) - sl->curline;
     }
   else
     {
-      offset = -1;
-      limit = -1;
-    }
-
-  select_line_t* line;
-  line_index_t ret = 0;
-
-  for ( line_index_t idx = sl->curline;
-        idx != limit;
-        idx = idx + offset )
-    {
-      line = mcp_nth( sl->lines, idx );
-      if ( regexec( re, line->text, 0, NULL, 0 ) == 0 )
-        return ret;
-      ret++;
+      /* Last match before or at current line. */
+      if ( pos < fi->hits->used && mci_nth( fi->hits, pos ) == sl->curline )
+        return 0;
+      if ( pos > 0 )
+        return sl->curline - mci_nth( fi->hits, pos - 1 );
     }
 
   return -1;
@@ -1204,7 +3307,7 @@ void select_lines_find_interactive( select_lines_t* sl,
   int key;
   bool_t done = mc_false;
   bool_t use_org = mc_false;
-  regex_t* re;
+  find_index_t fi;
   line_index_t offset;
   bool_t first_search = mc_true;
 
@@ -1212,15 +3315,28 @@ void select_lines_find_interactive( select_lines_t* sl,
   org_sl = *sl;
   prev_sl = *sl;
 
-  re = regex_new( pattern, case_sensitive );
+  fi.m = matcher_new( pattern, case_sensitive, literal_patterns, sl->fields, sl->paths );
 
-  if ( !re )
+  if ( !fi.m )
     {
       prompt_msg( sl->prompt, "Error in regexp!" );
       return;
     }
 
+  /* Matching lines are indexed once, and searches are lookups. */
+  fi.hits = mci_new();
+  fi.indexed = 0;
+  if ( !find_index_update( sl, &fi ) )
+    {
+      prompt_msg( sl->prompt, "Matching cancelled!" );
+      matcher_rem( fi.m );
+      mci_del( fi.hits );
+      select_lines_display( sl );
+      return;
+    }
+
   prompt_label( sl->find_status, "F" );
+  find_index_status( sl, &fi );
   select_lines_display( sl );
 
 
@@ -1265,7 +3381,7 @@ void select_lines_find_interactive( select_lines_t* sl,
           /* For first search also the current line is searched. */
           if ( first_search || select_lines_move_down( sl ) )
             {
-              if ( ( offset = select_lines_find_next( sl, re, mc_true ) ) != -1 )
+              if ( ( offset = select_lines_find_next( sl, &fi, mc_true ) ) != -1 )
                 /* Found new matching line. */
                 select_lines_move_down_n( sl, offset );
               else
@@ -1285,7 +3401,7 @@ void select_lines_find_interactive( select_lines_t* sl,
 
           if ( first_search || select_lines_move_up( sl ) )
             {
-              if ( ( offset = select_lines_find_next( sl, re, mc_false ) ) != -1 )
+              if ( ( offset = select_lines_find_next( sl, &fi, mc_false ) ) != -1 )
                 select_lines_move_up_n( sl, offset );
               else
                 select_lines_save_position( &prev_sl, sl );
@@ -1303,18 +3419,196 @@ void select_lines_find_interactive( select_lines_t* sl,
       if ( done )
         break;
 
-      select_lines_display( sl );
+      if ( !screen_skip_refresh() )
+        {
+          find_index_status( sl, &fi );
+          select_lines_display( sl );
+        }
 
     }
 
   if ( use_org )
     select_lines_save_position( &org_sl, sl );
 
-  regex_rem( re );
+  matcher_rem( fi.m );
+  mci_del( fi.hits );
+
+  prompt_label( sl->prompt, NULL );
+  prompt_label( sl->find_status, NULL );
+
+  select_lines_display( sl );
+}
+
+
+/** Cached filter result for pattern prefix. */
+typedef struct filter_level_s {
+  int len;        /**< Pattern prefix length. */
+  mci_p hits;     /**< Matching lines. */
+} filter_level_t;
+
+
+/**
+ * Update filter view for changed pattern. Filter levels are results
+ * for prefixes of the previous pattern. Levels that are not a prefix
+ * of the new pattern are dropped, and the new result is computed
+ * from the longest remaining level, since lines matching the pattern
+ * also match its prefix.
+ *
+ * @param sl Select_lines object.
+ * @param levels Filter levels.
+ * @param prev Previous pattern.
+ * @param pattern New pattern.
+ */
+void select_lines_filter_update( select_lines_t* sl,
+                                 mcp_p levels,
+                                 mcc_p prev,
+                                 const char* pattern )
+{
+  filter_level_t* top;
+  int common = 0;
+  int len = strlen( pattern );
+  const char* prevstr = mcc_to_str( prev );
+
+  while ( common < len && prevstr[ common ] == pattern[ common ] )
+    common++;
+
+  /* Drop levels that are not prefixes of the new pattern. */
+  while ( !mcp_empty( levels ) &&
+          ( (filter_level_t*) mcp_peek( levels ) )->len > common )
+    {
+      top = mcp_pop( levels );
+      mci_del( top->hits );
+      mc_free( top );
+    }
+
+  top = mcp_empty( levels ) ? NULL : mcp_peek( levels );
+
+  if ( len > 0 && ( !top || top->len < len ) )
+    {
+      filter_level_t* level;
+
+      level = mc_new( filter_level_t );
+      level->len = len;
+      level->hits = match_fuzzy_filter( pattern,
+                                        (char**) sl->lines->data,
+                                        sl->paths,
+                                        sl->lines->used,
+                                        top ? top->hits : NULL );
+      mcp_push( levels, level );
+      top = level;
+    }
+
+  mcc_reset( prev );
+  mcc_printf( prev, "%s", pattern );
+
+  sl->view = ( len > 0 ) ? top->hits : NULL;
+  sl->firstline = 0;
+  sl->curline = 0;
+}
+
+
+/**
+ * Interactive filtering of list lines. Only lines that match the
+ * typed fuzzy pattern are shown. RET moves to the current line in
+ * the full list and ESC reverts back to the original line.
+ *
+ * @param sl Select_lines object.
+ */
+void select_lines_filter_interactive( select_lines_t* sl )
+{
+  select_lines_t org_sl;
+  int key;
+  bool_t done = mc_false;
+  bool_t use_org = mc_false;
+  line_index_t line = -1;
+  mcp_p levels;
+  mcc_p prev;
+
+  /* Save filter start position. */
+  org_sl = *sl;
+
+  levels = mcp_new();
+  prev = mcc_new_size( 16 );
+
+  prompt_label( sl->prompt, "filter: " );
+  prompt_open_buffer( sl->prompt );
+  prompt_label( sl->find_status, "/" );
+  select_lines_display( sl );
+
+  mc_loop
+    {
+      key = screen_get_key();
+
+      switch ( key )
+        {
+
+        case ESC:
+        case CTRL_G:
+          done = mc_true;
+          use_org = mc_true;
+          break;
+
+        case NEWLINE:
+          done = mc_true;
+          /* Stay on current line (if any). */
+          use_org = ( select_lines_count( sl ) == 0 );
+          break;
+
+        case CTRL_N:
+          select_lines_move_down( sl );
+          break;
+
+        case CTRL_P:
+          select_lines_move_up( sl );
+          break;
+
+        case CTRL_T:
+          if ( select_lines_count( sl ) > 0 )
+            select_lines_toggle_mark( sl );
+          break;
+
+        default:
+          if ( prompt_edit( sl->prompt, key ) == prompt_edit_change )
+            select_lines_filter_update( sl, levels, prev,
+                                        mcc_to_str( sl->prompt->buf ) );
+          break;
+        }
+
+      if ( done )
+        break;
+
+      if ( !screen_skip_refresh() )
+        select_lines_display( sl );
+    }
+
+  if ( !use_org )
+    line = select_lines_at( sl, sl->curline );
+
+  sl->view = NULL;
+  select_lines_save_position( &org_sl, sl );
+
+  while ( !mcp_empty( levels ) )
+    {
+      filter_level_t* level = mcp_pop( levels );
+      mci_del( level->hits );
+      mc_free( level );
+    }
+  mcp_del( levels );
+  mcc_del( prev );
 
+  prompt_close_buffer( sl->prompt );
+  prompt_label( sl->prompt, NULL );
   prompt_label( sl->find_status, NULL );
 
   select_lines_display( sl );
+
+  if ( line >= 0 )
+    {
+      /* Move to selected line in full list. */
+      select_lines_goto( sl, line );
+    }
+
+  select_lines_display( sl );
 }
 
 
@@ -1374,7 +3668,6 @@ bool_t interaction( select_lines_t* sl )
   int key;
   bool_t execute = mc_false;
   bool_t done = mc_false;
-  select_line_t* line;
 
   win_info* wi = sl->list_wi;
 
@@ -1387,7 +3680,8 @@ bool_t interaction( select_lines_t* sl )
       key = screen_get_key();
 
       /* Clear pending user messages. */
-      prompt_msg( sl->prompt, NULL );
+      if ( sl->prompt->label )
+        prompt_msg( sl->prompt, NULL );
 
       switch ( key )
         {
@@ -1402,6 +3696,15 @@ bool_t interaction( select_lines_t* sl )
           execute = mc_true;
           break;
 
+        case ESC:
+        case CTRL_G:
+          if ( sl->reader )
+            {
+              select_lines_load_cancel( sl );
+              prompt_msg( sl->prompt, "Input loading stopped" );
+            }
+          break;
+
         case 'J':
           select_lines_toggle_mark( sl );
           select_lines_move_down( sl );
@@ -1435,11 +3738,11 @@ bool_t interaction( select_lines_t* sl )
           break;
 
         case 'b':
-          select_lines_move_up_n( sl, sl->curline );
+          select_lines_goto( sl, 0 );
           break;
 
         case 'e':
-          select_lines_move_down_n( sl, sl->lines->used - 1 - sl->curline );
+          select_lines_goto( sl, select_lines_count( sl ) - 1 );
           break;
 
         case 'g':
@@ -1467,10 +3770,7 @@ bool_t interaction( select_lines_t* sl )
 
                   default:
                     cnt = strtol( &(input[0]), NULL, 0 );
-                    if ( cnt > (sl->curline+1) )
-                      select_lines_move_down_n( sl, cnt - (sl->curline+1) );
-                    else
-                      select_lines_move_up_n( sl, (sl->curline+1) - cnt );
+                    select_lines_goto( sl, cnt - 1 );
                     break;
                   }
               }
@@ -1489,28 +3789,38 @@ bool_t interaction( select_lines_t* sl )
           select_lines_toggle_mark( sl );
           break;
 
+        case 'u':
+          {
+            void* rule;
+
+            if ( !journal_undo( sl->journal, sl->marks, &sl->marked, &rule ) )
+              prompt_msg( sl->prompt, "Nothing to undo!" );
+            else if ( rule && sl->rules )
+              select_lines_rule_move( sl->rules->patterns, sl->rules->undone, rule );
+          }
+          break;
+
+        case CTRL_R:
+          {
+            void* rule;
+
+            if ( !journal_redo( sl->journal, sl->marks, &sl->marked, &rule ) )
+              prompt_msg( sl->prompt, "Nothing to redo!" );
+            else if ( rule && sl->rules )
+              select_lines_rule_move( sl->rules->undone, sl->rules->patterns, rule );
+          }
+          break;
+
         case 'S':
-          for ( line_index_t i = 0; i < sl->lines->used; i++ )
-            {
-              line = mcp_nth( sl->lines, i );
-              line->marked = mc_true;
-            }
+          select_lines_mark_range( sl, 0, sl->lines->used, mark_set );
           break;
 
         case 'R':
-          for ( line_index_t i = 0; i < sl->lines->used; i++ )
-            {
-              line = mcp_nth( sl->lines, i );
-              line->marked = mc_false;
-            }
+          select_lines_mark_range( sl, 0, sl->lines->used, mark_reset );
           break;
 
         case 'T':
-          for ( line_index_t i = 0; i < sl->lines->used; i++ )
-            {
-              line = mcp_nth( sl->lines, i );
-              line->marked = !line->marked;
-            }
+          select_lines_mark_range( sl, 0, sl->lines->used, mark_toggle );
           break;
 
         case 'c':
@@ -1521,32 +3831,39 @@ bool_t interaction( select_lines_t* sl )
 
             if ( input )
               {
-                line_index_t cnt;
-                void (*set_func) ( select_lines_t* sl );
+                line_index_t cnt, end;
+                mark_op_t op;
 
                 switch ( input[0] )
                   {
 
                   case '+':
                     cnt = strtol( &(input[1]), NULL, 0 );
-                    set_func = select_lines_set_mark;
+                    op = mark_set;
                     break;
 
                   case '-':
                     cnt = strtol( &(input[1]), NULL, 0 );
-                    set_func = select_lines_reset_mark;
+                    op = mark_reset;
                     break;
 
                   default:
                     cnt = strtol( &(input[0]), NULL, 0 );
-                    set_func = select_lines_toggle_mark;
+                    op = mark_toggle;
                     break;
                   }
 
-                for ( line_index_t i = 0; i < cnt; i++ )
+                /* Clamp before adding (strtol saturates at LONG_MAX). */
+                if ( cnt > select_lines_count( sl ) - sl->curline )
+                  cnt = select_lines_count( sl ) - sl->curline;
+
+                if ( cnt > 0 )
                   {
-                    set_func( sl );
-                    select_lines_move_down( sl );
+                    /* Mark the lines from current line onwards (full
+                       list, i.e. positions are line indeces). */
+                    end = sl->curline + cnt;
+                    select_lines_mark_range( sl, sl->curline, end, op );
+                    select_lines_move_down_n( sl, cnt );
                   }
               }
           }
@@ -1567,6 +3884,43 @@ bool_t interaction( select_lines_t* sl )
           }
           break;
 
+        case 'o':
+          {
+            char* input;
+            int field;
+            bool_t reverse;
+
+            if ( !sl->fields )
+              {
+                prompt_msg( sl->prompt, "No delimiter was given!" );
+                break;
+              }
+
+            if ( sl->reader )
+              {
+                prompt_msg( sl->prompt, "Input is still loading!" );
+                break;
+              }
+
+            input = prompt_interact( sl->prompt, "sort field (#, #r): " );
+
+            if ( input )
+              {
+                if ( select_lines_parse_field( input, &field, &reverse ) )
+                  {
+                    select_lines_sort_field( sl, field, reverse );
+                    sl->firstline = 0;
+                    select_lines_center_view( sl );
+                  }
+                else
+                  {
+                    prompt_msg( sl->prompt, "Invalid sort field!" );
+                  }
+                mc_free( input );
+              }
+          }
+          break;
+
         case 'f':
         case 'F':
           {
@@ -1585,30 +3939,34 @@ bool_t interaction( select_lines_t* sl )
           }
           break;
 
+        case '/':
+          select_lines_filter_interactive( sl );
+          break;
+
         case 'l':
           select_lines_center_view( sl );
           break;
 
+        case '>':
+          /* Scroll long lines by half window. */
+          sl->hscroll += WI_X_SIZE(wi) / 2;
+          break;
+
+        case '<':
+          if ( sl->hscroll > WI_X_SIZE(wi) / 2 )
+            sl->hscroll -= WI_X_SIZE(wi) / 2;
+          else
+            sl->hscroll = 0;
+          break;
+
         case 'v':
           select_lines_view_commands( sl );
           break;
 
         case 'i':
           {
-            /* Inspect the file at cursor and ensure that it constains
-               ASCII text. */
-
-            select_line_t* line;
-
-            line = mcp_nth( sl->lines, sl->curline );
-            
-            mcc_reset( strbuf );
-            mcc_printf( strbuf, "file %s | grep -q \"ASCII text\"", line->text );
-
-            if ( system( (char*) mcc_to_str( strbuf ) ) == 0 )
-              {
-                show_file_content( sl, line->text );
-              }
+            /* Preview the file at cursor (if it contains text). */
+            show_file_content( sl, select_lines_text( sl, sl->curline ) );
           }
           break;
 
@@ -1623,7 +3981,9 @@ bool_t interaction( select_lines_t* sl )
       if ( done )
         break;
 
-      select_lines_display( sl );
+      /* Display once for a batch of pending keys. */
+      if ( !screen_skip_refresh() )
+        select_lines_display( sl );
 
     }
 
@@ -1669,12 +4029,22 @@ bool_t setup_and_interact( select_lines_t* sl )
   screen_post_win_resize = win_resize_callback;
   screen_fatal_error = take_fatal;
 
+  if ( sl->reader )
+    {
+      /* Read progressive input while waiting for keys. */
+      screen_idle = select_lines_load_idle;
+      screen_idle_context = sl;
+    }
+
   sl->list_wi = screen_open_window_geom( si, 0, 1, 0, 1, mc_false );
 
+  /* Position may be restored from snapshot. */
+  select_lines_goto( sl, sl->curline );
+
 
   /* Status display offset from window right towards left. */
   int find_status_field_pos = 4;
-  int line_status_field_pos = find_status_field_pos + 10;
+  int line_status_field_pos = find_status_field_pos + 28;
 
   prompt_wi = screen_open_window_geom( sl->list_wi->si,
                                        0,
@@ -1706,6 +4076,8 @@ bool_t setup_and_interact( select_lines_t* sl )
   bool_t execute;
   execute = interaction( sl );
 
+  screen_idle = NULL;
+
 //  si = screen_close( si );
   gdb_break();
 
@@ -1733,15 +4105,55 @@ bool_t setup_and_interact( select_lines_t* sl )
  */
 void select_lines_presel_all( select_lines_t* sl )
 {
-  select_line_t* line;
-  for ( line_index_t i = 0; i < sl->lines->used; i++ )
+  sl->rules->mark_all = mc_true;
+}
+
+
+/**
+ * Pre-select lines matching regex patterns.
+ *
+ * @param sl Select_lines object.
+ * @param list Null terminated list of patterns.
+ * @param case_sensitive Case sensitivity option.
+ */
+void select_lines_presel_matching( select_lines_t* sl,
+                                   char** list,
+                                   bool_t case_sensitive )
+{
+  matcher_t* m;
+
+  for ( int i = 0; list[ i ]; i++ )
     {
-      line = mcp_nth( sl->lines, i );
-      line->marked = mc_true;
+      m = matcher_new( list[ i ], case_sensitive, literal_patterns, sl->fields, sl->paths );
+
+      if ( !m )
+        take_fatal( "Error in regexp: %s", list[ i ] );
+
+      mcp_append( sl->rules->patterns, m );
     }
 }
 
 
+/**
+ * Pre-select (toggle) line by index.
+ *
+ * @param sl Select_lines object.
+ * @param idx Line index.
+ */
+void select_lines_presel_toggle( select_lines_t* sl, line_index_t idx )
+{
+  mcb_p toggles = sl->rules->toggles;
+
+  if ( idx < 0 )
+    return;
+
+  if ( idx >= toggles->used )
+    mcb_resize( toggles, idx + 1 );
+
+  mcb_toggle( toggles, idx );
+}
+
+
 /**
  * Pre-select (toggle) all lines in list.
  * 
@@ -1751,110 +4163,146 @@ void select_lines_presel_all( select_lines_t* sl )
 void select_lines_presel_listed( select_lines_t* sl, char** list )
 {
   line_index_t idx;
-  select_line_t* line;
 
   for ( int i = 0; list[i]; i++ )
     {
       idx = (line_index_t) ( strtol( list[ i ], NULL, 0 ) - 1 );
-      if ( idx < sl->lines->used )
-        {
-          line = mcp_nth( sl->lines, idx );
-          line->marked = !line->marked;
-        }
+      select_lines_presel_toggle( sl, idx );
     }
 }
 
 
-/** presel_file parser enum. */
-enum number_fsm_e { find_first, find_end };
-
-
 /**
  * Pre-select (toggle) all lines listed in filename. Any space
- * character can be separator between number.
+ * character can be separator between number. File is read in
+ * blocks.
  * 
  * @param sl Select_lines object.
  * @param filename File containing lines to select.
  */
 void select_lines_presel_file( select_lines_t* sl, char* filename )
 {
-  FILE* fh;
-  int ch;
-  enum number_fsm_e fsm = find_first;
+  char buf[ TAKE_READ_SIZE ];
+  ssize_t len;
+  line_index_t idx;
+  int fd;
 
-  fh = fopen( filename, "r" );
-  if ( !fh )
-    take_fatal( "Could not open output file: %s", filename );
-  
-  /*
-   * Implement presel_file parsing as FSM. The spaces between numbers
-   * can be any whitespace (SPACE or NEWLINE etc).
-   */
+  fd = open( filename, O_RDONLY );
+  if ( fd < 0 )
+    take_fatal( "Could not open preselection file: %s", filename );
 
+  /* Digits of current number are collected to strbuf, since a number
+     may continue to the next block. */
   mcc_reset( strbuf );
 
-  ch = fgetc( fh );
-
   mc_loop
     {
+      len = read( fd, buf, TAKE_READ_SIZE );
+      if ( len < 0 && errno == EINTR )
+        continue;
 
-      switch ( fsm )
+      for ( ssize_t i = 0; i < len; i++ )
         {
+          if ( isdigit( (unsigned char) buf[ i ] ) )
+            {
+              mcc_append( strbuf, buf[ i ] );
+            }
+          else if ( strbuf->used > 0 )
+            {
+              /* Mark line with found number. */
+              idx = strtol( mcc_to_str( strbuf ), NULL, 0 ) - 1;
+              mcc_reset( strbuf );
+              select_lines_presel_toggle( sl, idx );
+            }
+        }
+
+      if ( len <= 0 )
+        break;
+    }
 
-        case find_first:
+  /* Number at the end of file. */
+  if ( strbuf->used > 0 )
+    {
+      idx = strtol( mcc_to_str( strbuf ), NULL, 0 ) - 1;
+      mcc_reset( strbuf );
+      select_lines_presel_toggle( sl, idx );
+    }
 
-          /* Find first char of number. */
+  close( fd );
+}
 
-          if ( isdigit( ch ) )
-            /* Eat out spaces. */
-            fsm = find_end;
-          else
-            ch = fgetc( fh );
 
-          break;
+/**
+ * Pre-select lines that are listed (by content) in filename. Each
+ * line of file is one name. Names are stored to a hash set, hence
+ * marking is one lookup per line. File is read in blocks.
+ * 
+ * @param sl Select_lines object.
+ * @param filename File containing line contents to select.
+ */
+void select_lines_presel_names( select_lines_t* sl, char* filename )
+{
+  char buf[ TAKE_READ_SIZE ];
+  ssize_t len;
+  char* begin;
+  char* nl;
+  char* end;
+  int fd;
 
+  fd = open( filename, O_RDONLY );
+  if ( fd < 0 )
+    take_fatal( "Could not open preselection file: %s", filename );
 
-        case find_end:
+  if ( !sl->rules->names )
+    sl->rules->names = strset_new();
 
-          /* Collect chars until space or EOF is reached. */
+  /* Partial line from previous block is collected to strbuf. */
+  mcc_reset( strbuf );
 
-          {
-            select_line_t* line;
-            line_index_t idx;
+  mc_loop
+    {
+      len = read( fd, buf, TAKE_READ_SIZE );
+      if ( len < 0 && errno == EINTR )
+        continue;
+      if ( len <= 0 )
+        break;
 
-            if ( isdigit( ch ) )
-              {
-                mcc_append( strbuf, (char) ch );
-              }
-            else
-              {
-                /* Mark line with found number. */
-                idx = strtol( mcc_to_str( strbuf ), NULL, 0 ) - 1;
-                mcc_reset( strbuf );
-                if ( idx < sl->lines->used )
-                  {
-                    line = mcp_nth( sl->lines, idx );
-                    line->marked = !line->marked;
-                  }
-                
-                fsm = find_first;
-              }
+      begin = buf;
+      end = buf + len;
 
-            ch = fgetc( fh );
-          }
-          break;
-          
-        default: break;
+      while ( ( nl = memchr( begin, '\n', end - begin ) ) )
+        {
+          if ( strbuf->used > 0 )
+            {
+              mcc_append_n( strbuf, begin, nl - begin );
+              strset_add( sl->rules->names, strbuf->data, strbuf->used );
+              mcc_reset( strbuf );
+            }
+          else if ( nl > begin )
+            {
+              strset_add( sl->rules->names, begin, nl - begin );
+            }
+          begin = nl + 1;
         }
-      
-      if ( ch == EOF )
-        break;
+
+      mcc_append_n( strbuf, begin, end - begin );
+    }
+
+  /* Last line without newline. */
+  if ( strbuf->used > 0 )
+    {
+      strset_add( sl->rules->names, strbuf->data, strbuf->used );
+      mcc_reset( strbuf );
     }
+
+  close( fd );
 }
 
 
 
 
+#ifndef TAKE_BENCH
+
 /**
  * Main function sections:
  * - Process command line arguments.
@@ -1876,14 +4324,34 @@ int main( int argc, char** argv )
    /* Define command line options. */
    como_maincmd( "take", "Tero Isannainen", "2015",
      { COMO_OPT_SINGLE, "input", "-i", "Input list generation command." },
+     { COMO_OPT_SINGLE, "file", "-f", "Input list from file." },
      { COMO_OPT_ANY, "list", "-l", "Directory listing as input (default: <curdir>)." },
+     { COMO_SWITCH, "recursive", "-r", "Directory listing includes subdirectories recursively." },
+     { COMO_SWITCH, "sort", "-S", "Sort input lines (byte order)." },
+     { COMO_SWITCH, "uniq", "-U", "Remove duplicate input lines (first occurrence is kept)." },
+     { COMO_SWITCH, "compact", "-C", "Store input paths with shared directory prefixes (large path lists)." },
+     { COMO_OPT_SINGLE, "delimiter", "-d", "Split lines to fields by <delimiter> (SPACE: whitespace, \\t: TAB)." },
+     { COMO_OPT_SINGLE, "key", "-k", "Sort lines by field <key> (e.g. \"5\" or descending \"5r\")." },
+     { COMO_OPT_SINGLE, "resume", "-R", "Lines, selection and position from <resume> snapshot (no input)." },
      { COMO_OPT_SINGLE, "command", "-c", "Output processing command. Display selection if not given." },
+     { COMO_OPT_SINGLE, "order", "-o", "Output order of selected lines: line (default) or selection." },
      { COMO_OPT_SINGLE, "auto", "-a", "Current dir entries as input and execute <auto>." },
      { COMO_OPT_ANY, "join", "-j", "Join selection with <join> (default <join>: \" \")." },
      { COMO_SWITCH, "presel", "-p", "Preselect all." },
+     { COMO_OPT_MULTI, "match", "-m", "Preselect lines matching regexp (case insensitive)." },
+     { COMO_OPT_MULTI, "match_case", "-M", "Preselect lines matching regexp (case sensitive)." },
+     { COMO_SWITCH, "literal", "-L", "Patterns are plain strings (no regexp)." },
      { COMO_OPT_MULTI, "presel_list", "-pl", "Preselect listed lines (1..n)." },
      { COMO_OPT_SINGLE, "presel_file", "-pf", "Preselect listed lines from <presel_file>." },
+     { COMO_OPT_SINGLE, "presel_names", "-ps", "Preselect lines whose content is listed in <presel_names>." },
+     { COMO_OPT_ANY, "xargs", "-X", "Execute command for groups of items joined with SPACE (max <xargs> items)." },
+     { COMO_OPT_SINGLE, "jobs", "-J", "Execute <jobs> output-commands in parallel (default: 1)." },
      { COMO_SWITCH, "batch", "-b", "Batch mode (requires preselection)." },
+     { COMO_SWITCH, "stream", "-w", "Start interaction while input is still read." },
+     { COMO_OPT_SINGLE, "max_lines", "-ml", "Read at most <max_lines> input lines." },
+     { COMO_OPT_SINGLE, "max_bytes", "-mb", "Read at most <max_bytes> of input (complete lines)." },
+     { COMO_OPT_SINGLE, "snapshot", "-Z", "Store lines, selection and position to <snapshot> at exit." },
+     { COMO_OPT_ANY, "stats", "-st", "Report statistics at exit (to stderr, or as JSON appended to <stats>)." },
      { COMO_SWITCH, "selected", "-s", "Show selected line number at exit." },
      { COMO_OPT_ANY, "no_exec", "-x", "No execution, display/store command(s) to <no_exec> (default: stdout)." }
      );
@@ -1893,12 +4361,24 @@ int main( int argc, char** argv )
 
    como_finish();
 
+   stats.start = stats_now();
+
+   if ( ( opt = como_given( "stats" ) ) )
+     {
+       stats_enabled = mc_true;
+       if ( opt->valuecnt > 0 )
+         stats_file = opt->value[0];
+     }
+
 
 #ifdef ml_do_debug
    ml_dbug_open( "debug.txt" );
 #endif
 
 
+  /* List nodes (screen windows) are allocated from a pool. */
+  ll_pool = mca_pool_new( sizeof( ll ) );
+
   /* Lines container. */
   sl = select_lines_new();
 
@@ -1907,41 +4387,162 @@ int main( int argc, char** argv )
   strbuf = mcc_new_size( 16 );
 
 
-  if ( ( opt = como_given( "list" ) ) )
+  literal_patterns = como_given( "literal" ) ? mc_true : mc_false;
+
+  if ( ( opt = como_given( "command" ) ) )
+    output_command = opt->value[0];
+
+  if ( ( opt = como_given( "auto" ) ) )
+    output_command = opt->value[0];
+
+  if ( ( opt = como_given( "order" ) ) )
+    {
+      if ( !strcmp( opt->value[0], "selection" ) )
+        order_selection = mc_true;
+      else if ( strcmp( opt->value[0], "line" ) )
+        take_fatal( "Invalid order: %s", opt->value[0] );
+    }
+
+
+  /* Progressive input is only useful with interaction. */
+  bool_t stream = como_given( "stream" ) && !como_given( "batch" );
+
+  /* Sorting and duplicate removal require complete input. */
+  bool_t sort = ( como_given( "sort" ) != NULL );
+  bool_t uniq = ( como_given( "uniq" ) != NULL );
+  int sort_field = 0;
+  bool_t sort_reverse = mc_false;
+
+  if ( ( opt = como_given( "key" ) ) )
+    {
+      if ( !select_lines_parse_field( opt->value[0], &sort_field, &sort_reverse ) )
+        take_fatal( "Invalid sort field: %s", opt->value[0] );
+      if ( !como_given( "delimiter" ) )
+        take_fatal( "Sort field requires delimiter" );
+    }
+
+  if ( sort || uniq || sort_field )
+    stream = mc_false;
+
+
+  bool_t recursive = ( como_given( "recursive" ) != NULL );
+
+  /* Input limits, i.e. rest of input is ignored (and input command
+     is terminated). */
+  if ( ( opt = como_given( "max_lines" ) ) )
+    {
+      sl->max_lines = strtoll( opt->value[0], NULL, 0 );
+      if ( sl->max_lines < 1 )
+        take_fatal( "Invalid line limit: %s", opt->value[0] );
+    }
+
+  if ( ( opt = como_given( "max_bytes" ) ) )
+    {
+      sl->max_bytes = strtoll( opt->value[0], NULL, 0 );
+      if ( sl->max_bytes < 1 )
+        take_fatal( "Invalid size limit: %s", opt->value[0] );
+    }
+
+  /* Paths share the stored directory parts. Lines are not stored as
+     texts, hence line sorting and fields are not available. */
+  if ( como_given( "compact" ) && !como_given( "resume" ) )
+    {
+      if ( sort || uniq || como_given( "delimiter" ) )
+        take_fatal( "Compact storage can not be used with sort, uniq or delimiter" );
+      sl->paths = pathtree_new();
+    }
+
+  if ( ( opt = como_given( "delimiter" ) ) )
+    {
+      char* delim = opt->value[0];
+
+      if ( !strcmp( delim, "\\t" ) )
+        delim = "\t";
+      if ( strlen( delim ) != 1 )
+        take_fatal( "Invalid delimiter: %s", opt->value[0] );
+      sl->fields = field_index_new( delim[0] );
+    }
+
+  stats.load_start = stats_now();
+
+  if ( ( opt = como_given( "resume" ) ) )
+    {
+      /* Lines and marks from previous session, i.e. no input. */
+      select_lines_resume( sl, opt->value[0] );
+      sort = uniq = mc_false;
+    }
+  else if ( ( opt = como_given( "list" ) ) )
     {
       if ( opt->valuecnt > 0 )
         /* User specified directory to list. */
-        list_from_dir( sl, opt->value[ 0 ] );
+        list_from_dir( sl, opt->value[ 0 ], recursive );
       else
-        list_from_dir( sl, "." );
+        list_from_dir( sl, ".", recursive );
     }
   else if ( como_given( "auto" ) )
     {
-      list_from_dir( sl, "." );
+      list_from_dir( sl, ".", recursive );
     }
   else if ( ( opt = como_given( "input" ) ) )
     {
-      list_from_command( sl, opt->value[0] );
+      if ( stream )
+        list_stream_from_command( sl, opt->value[0] );
+      else
+        list_from_command( sl, opt->value[0] );
+    }
+  else if ( ( opt = como_given( "file" ) ) )
+    {
+      list_from_file( sl, opt->value[0] );
     }
   else
     {
       /* Input from stdin. */
       if ( !isatty( fileno( stdin ) ) )
-        list_from_stdin( sl );
+        {
+          if ( stream )
+            list_stream_from_stdin( sl );
+          else
+            list_from_stdin( sl );
+        }
     }
 
 
+  if ( !sl->reader )
+    select_lines_load_done( sl );
+
   if ( sl->lines->used == 0 )
     {
       take_fatal( "No input for Take" );
     }
 
+  if ( sort || uniq )
+    select_lines_sort( sl, sort, uniq );
+
+  /* Fields are indexed once, when lines are in place. */
+  if ( sort_field )
+    select_lines_sort_field( sl, sort_field, sort_reverse );
+  select_lines_fields_update( sl );
+
+
+  /* Preselection is collected to rules, which are applied to lines
+     as they arrive. */
+  select_lines_rules_new( sl );
 
   if ( como_given( "presel" ) )
     {
       select_lines_presel_all( sl );
     }
 
+  if ( ( opt = como_given( "match" ) ) )
+    {
+      select_lines_presel_matching( sl, opt->value, mc_false );
+    }
+
+  if ( ( opt = como_given( "match_case" ) ) )
+    {
+      select_lines_presel_matching( sl, opt->value, mc_true );
+    }
+
   if ( ( opt = como_given( "presel_list" ) ) )
     {
       select_lines_presel_listed( sl, opt->value );
@@ -1952,6 +4553,29 @@ int main( int argc, char** argv )
       select_lines_presel_file( sl, opt->value[0] );
     }
 
+  if ( ( opt = como_given( "presel_names" ) ) )
+    {
+      select_lines_presel_names( sl, opt->value[0] );
+    }
+
+  if ( !como_given( "batch" ) )
+    {
+      /* Interrupt cancels slow preselection patterns, and interaction
+         starts without them. */
+      list_cancelled = mc_false;
+      signal( SIGINT, list_cancel_handler );
+      select_lines_rules_apply( sl, 0, sl->lines->used,
+                                select_lines_presel_progress );
+      signal( SIGINT, SIG_DFL );
+    }
+  else
+    {
+      select_lines_rules_apply( sl, 0, sl->lines->used, NULL );
+    }
+
+  if ( !sl->reader )
+    select_lines_rules_rem( sl );
+
 
   bool_t execute = mc_false;
 
@@ -1973,12 +4597,26 @@ int main( int argc, char** argv )
 #endif
 
 
+  if ( ( opt = como_given( "snapshot" ) ) )
+    {
+      /* Snapshot is stored also when execution is skipped. */
+      if ( sl->reader )
+        select_lines_load_all( sl );
+      select_lines_save( sl, opt->value[0] );
+    }
+
   if ( !execute )
     {
       /* Selection execution skipped. */
       take_exit( EXIT_FAILURE );
     }
 
+  if ( sl->reader )
+    {
+      /* Selection is complete only with complete input. */
+      select_lines_load_all( sl );
+    }
+
 
   /* Use the user selection for output. */
 
@@ -1993,6 +4631,8 @@ int main( int argc, char** argv )
             {
               take_fatal( "Could not open output file: %s", opt->value[0] );
             }
+          /* Large writes for streamed commands. */
+          setvbuf( no_exec_fh, NULL, _IOFBF, TAKE_OUTPUT_BUFFER );
         }
       else
         {
@@ -2010,11 +4650,20 @@ int main( int argc, char** argv )
       else
         fh = stdout;
 
-      select_line_t* line;
-      for ( line_index_t i = 0; i < sl->lines->used; i++ )
+      if ( order_selection )
         {
-          line = mcp_nth( sl->lines, i );
-          if ( line->marked )
+          mci_p order = journal_order( sl->journal, sl->marks );
+
+          for ( mc_size_t i = 0; i < order->used; i++ )
+            fprintf( fh, "%ld\n", (line_index_t) mci_nth( order, i ) + 1 );
+
+          mci_del( order );
+        }
+      else
+        {
+          for ( line_index_t i = mcb_next( sl->marks, 0 );
+                i != MCB_INVALID_INDEX;
+                i = mcb_next( sl->marks, i+1 ) )
             {
               fprintf( fh, "%ld\n", (i+1) );
             }
@@ -2033,20 +4682,428 @@ int main( int argc, char** argv )
         no_exec_fh = stdout;
     }
 
-  /* Execute selection using command(s). */
-  select_line_t* line;
+  /* Execute selection using command(s). Commands are generated
+     one at a time. */
+  cmd_gen_t gen;
+
+  cmd_gen_init( &gen, sl );
+
+  if ( no_exec_fh )
+    {
+      while ( cmd_gen_next( &gen ) )
+        cmd_template_write( gen.tmpl, gen.args, no_exec_fh );
+
+      cmd_gen_rem( &gen );
+
+      if ( no_exec_fh != stdout )
+        fclose( no_exec_fh );
+
+      take_exit( EXIT_SUCCESS );
+    }
+
+  int job_cnt = 1;
+  opt = como_opt( "jobs" );
+  if ( opt->given )
+    {
+      job_cnt = strtol( opt->value[0], NULL, 0 );
+      if ( job_cnt < 1 )
+        take_fatal( "Invalid job count: %s", opt->value[0] );
+    }
+
+  jobs_t* jobs = jobs_new( job_cnt );
+
+  while ( cmd_gen_next( &gen ) )
+    {
+      cmd_template_expand( gen.tmpl, gen.args, strbuf );
+      execute_cmd( jobs, mcc_to_str( strbuf ) );
+    }
+
+  cmd_gen_rem( &gen );
+  jobs_wait_all( jobs );
+
+  int64_t failed = jobs->failed;
+  int64_t started = jobs->started;
+  jobs_del( jobs );
+
+  if ( failed > 0 )
+    {
+      take_error( "%ld of %ld commands failed", (long) failed, (long) started );
+      take_exit( TAKE_EXIT_CMD_FAILURE );
+    }
+
+  take_exit( EXIT_SUCCESS );
+}
+
+#else /* TAKE_BENCH */
+
+
+/*
+ * Benchmark harness (take-bench), i.e. take with null screen
+ * backend. Interaction phases are driven with scripted keys, and
+ * each phase is measured for wall time, heap usage change and peak
+ * RSS.
+ */
+
+
+/** Line counts for benchmark (default). */
+static char* bench_default_lines[] = { "1e5", "1e6", "1e7", NULL };
+
+/** Page down key presses for the page phase. */
+#define TAKE_BENCH_PAGES 1000
+
+
+/** Benchmark phase measurement. */
+typedef struct bench_phase_s {
+  const char* name;        /**< Phase name. */
+  struct timespec start;   /**< Phase start time. */
+  int64_t heap;            /**< Heap usage at phase start (bytes). */
+} bench_phase_t;
+
+
+/**
+ * Return heap usage in bytes (or -1 if not available).
+ *
+ * @return Heap usage.
+ */
+int64_t bench_heap( void )
+{
+#ifdef HAVE_MALLINFO2
+  struct mallinfo2 mi = mallinfo2();
+  return (int64_t) ( mi.uordblks + mi.hblkhd );
+#else
+  return -1;
+#endif
+}
+
+
+/**
+ * Write all of buffer to fd, i.e. partial writes are continued.
+ *
+ * @param fd Output file descriptor.
+ * @param buf Data.
+ * @param len Data length.
+ *
+ * @return True if all data was written.
+ */
+bool_t bench_write( int fd, const char* buf, size_t len )
+{
+  ssize_t cnt;
+
+  while ( len > 0 )
+    {
+      cnt = write( fd, buf, len );
+      if ( cnt < 0 && errno == EINTR )
+        continue;
+      if ( cnt <= 0 )
+        return mc_false;
+      buf += cnt;
+      len -= cnt;
+    }
+
+  return mc_true;
+}
+
+
+/**
+ * Reset peak RSS, i.e. the next bench_peak_rss returns the peak after
+ * reset (Linux only, otherwise peak of process lifetime).
+ */
+void bench_peak_reset( void )
+{
+  int fd;
+
+  fd = open( "/proc/self/clear_refs", O_WRONLY );
+  if ( fd >= 0 )
+    {
+      /* Without clear_refs support peak is of process lifetime. */
+      bench_write( fd, "5", 1 );
+      close( fd );
+    }
+}
+
+
+/**
+ * Return peak RSS in kB.
+ *
+ * @return Peak RSS.
+ */
+int64_t bench_peak_rss( void )
+{
+  struct rusage ru;
+  char line[ 256 ];
+  int64_t peak = -1;
+  FILE* fh;
+
+  if ( ( fh = fopen( "/proc/self/status", "r" ) ) )
+    {
+      while ( fgets( line, sizeof( line ), fh ) )
+        {
+          if ( !strncmp( line, "VmHWM:", 6 ) )
+            {
+              peak = strtoll( line + 6, NULL, 10 );
+              break;
+            }
+        }
+      fclose( fh );
+    }
+
+  if ( peak < 0 && getrusage( RUSAGE_SELF, &ru ) == 0 )
+    peak = ru.ru_maxrss;
+
+  return peak;
+}
+
+
+/**
+ * Start phase measurement.
+ *
+ * @param ph Phase.
+ * @param name Phase name.
+ */
+void bench_begin( bench_phase_t* ph, const char* name )
+{
+  ph->name = name;
+  bench_peak_reset();
+  ph->heap = bench_heap();
+  clock_gettime( CLOCK_MONOTONIC, &ph->start );
+}
+
+
+/**
+ * End phase measurement and report it.
+ *
+ * @param ph Phase.
+ * @param lines Line count.
+ */
+void bench_end( bench_phase_t* ph, line_index_t lines )
+{
+  struct timespec now;
+  double elapsed;
+  int64_t heap;
+
+  clock_gettime( CLOCK_MONOTONIC, &now );
+  heap = bench_heap();
+
+  elapsed = ( now.tv_sec - ph->start.tv_sec ) +
+    ( now.tv_nsec - ph->start.tv_nsec ) / 1e9;
+
+  printf( "%-10s %10ld %10.3f %12ld %10ld\n",
+          ph->name,
+          (long) lines,
+          elapsed,
+          ( heap >= 0 ) ? (long) ( ( heap - ph->heap ) / 1024 ) : -1L,
+          (long) bench_peak_rss() );
+  fflush( stdout );
+}
+
+
+/**
+ * Write benchmark lines to fd (producer process), i.e. paths such as
+ * "dir42/file00012342.txt".
+ *
+ * @param fd Output file descriptor.
+ * @param lines Line count.
+ */
+void bench_produce( int fd, line_index_t lines )
+{
+  char buf[ TAKE_READ_SIZE ];
+  char* line;
+  size_t used = 0;
+  line_index_t num;
+
+  for ( line_index_t i = 0; i < lines; i++ )
+    {
+      if ( used + 32 > sizeof( buf ) )
+        {
+          if ( !bench_write( fd, buf, used ) )
+            return;
+          used = 0;
+        }
+
+      line = &buf[ used ];
+      memcpy( line, "dir00/file00000000.txt\n", 23 );
+      line[ 3 ] = '0' + ( i / 10 ) % 10;
+      line[ 4 ] = '0' + i % 10;
+      num = i;
+      for ( int j = 17; j >= 10; j--, num /= 10 )
+        line[ j ] = '0' + num % 10;
+      used += 23;
+    }
+
+  bench_write( fd, buf, used );
+}
+
+
+/**
+ * Load benchmark lines through a pipe from producer process.
+ *
+ * @param sl Select_lines object.
+ * @param lines Line count.
+ */
+void bench_load( select_lines_t* sl, line_index_t lines )
+{
+  int fds[ 2 ];
+  pid_t pid;
+
+  if ( pipe( fds ) != 0 )
+    take_fatal( "Could not create pipe" );
+
+  pid = fork();
+  if ( pid < 0 )
+    take_fatal( "Could not fork producer" );
+
+  if ( pid == 0 )
+    {
+      close( fds[ 0 ] );
+      bench_produce( fds[ 1 ], lines );
+      _exit( EXIT_SUCCESS );
+    }
+
+  close( fds[ 1 ] );
+  list_from_fd( sl, fds[ 0 ] );
+  close( fds[ 0 ] );
+  waitpid( pid, NULL, 0 );
+
+  /* Marks for loaded lines. */
+  select_lines_rules_new( sl );
+  select_lines_rules_apply( sl, 0, sl->lines->used, NULL );
+  select_lines_rules_rem( sl );
+}
+
+
+/**
+ * Interact with scripted keys.
+ *
+ * @param sl Select_lines object.
+ * @param keys Key presses (quit is implicit).
+ */
+void bench_interact( select_lines_t* sl, const char* keys )
+{
+  screen_script = keys;
+  setup_and_interact( sl );
+  screen_script = NULL;
+}
+
+
+/**
+ * Generate commands for selection to null device.
+ *
+ * @param sl Select_lines object.
+ */
+void bench_commands( select_lines_t* sl )
+{
+  cmd_gen_t gen;
+  FILE* fh;
+
+  fh = fopen( "/dev/null", "w" );
+  if ( !fh )
+    take_fatal( "Could not open: /dev/null" );
+  setvbuf( fh, NULL, _IOFBF, TAKE_OUTPUT_BUFFER );
+
+  cmd_gen_init( &gen, sl );
+  while ( cmd_gen_next( &gen ) )
+    cmd_template_write( gen.tmpl, gen.args, fh );
+  cmd_gen_rem( &gen );
+
+  fclose( fh );
+}
+
+
+/**
+ * Benchmark main, i.e. run phases for each line count:
+ * - load: Input through pipe.
+ * - toggle: Toggle all marks ("T").
+ * - mark: Mark matching lines ("m").
+ * - find: Find and move to the next 10 matches ("f", "j").
+ * - page: Page down ("n").
+ * - end: Goto end ("e").
+ * - commands: Generate commands for the selection.
+ *
+ * @param argc Arg count.
+ * @param argv Arg list content.
+ *
+ * @return Program return value.
+ */
+int main( int argc, char** argv )
+{
+   como_opt_t* opt;
+   char** counts;
+   char* pages;
+   line_index_t lines;
+   bench_phase_t ph;
+
+   como_maincmd( "take-bench", "Tero Isannainen", "2015",
+     { COMO_OPT_MULTI, "lines", "-n", "Line counts to benchmark (default: 1e5 1e6 1e7)." },
+     { COMO_OPT_SINGLE, "command", "-c", "Output processing command (default: \"echo @\")." },
+     { COMO_OPT_ANY, "join", "-j", "Join selection with <join> (default <join>: \" \")." },
+     { COMO_OPT_ANY, "xargs", "-X", "Commands for groups of items joined with SPACE (max <xargs> items)." }
+     );
+
+   como_finish();
+
+  ll_pool = mca_pool_new( sizeof( ll ) );
+  strbuf = mcc_new_size( 16 );
 
-  cmds = select_lines_create_commands( sl );
+  if ( ( opt = como_given( "command" ) ) )
+    output_command = opt->value[0];
+
+  if ( ( opt = como_given( "lines" ) ) )
+    counts = opt->value;
+  else
+    counts = bench_default_lines;
+
+  /* Every key press is refreshed to screen. */
+  screen_frame_interval = 0;
 
-  for ( line_index_t i = 0; i < cmds->lines->used; i++ )
+  pages = mc_new_n( char, TAKE_BENCH_PAGES + 1 );
+  memset( pages, 'n', TAKE_BENCH_PAGES );
+  pages[ TAKE_BENCH_PAGES ] = 0;
+
+  printf( "%-10s %10s %10s %12s %10s\n",
+          "phase", "lines", "time[s]", "heap[kB]", "peak[kB]" );
+
+  for ( int i = 0; counts[ i ]; i++ )
     {
-      line = mcp_nth( cmds->lines, i );
-      execute_cmd( line->text, no_exec_fh );
+      lines = (line_index_t) strtod( counts[ i ], NULL );
+      if ( lines < 1 )
+        take_fatal( "Invalid line count: %s", counts[ i ] );
+
+      sl = select_lines_new();
+
+      bench_begin( &ph, "load" );
+      bench_load( sl, lines );
+      bench_end( &ph, lines );
+
+      bench_begin( &ph, "toggle" );
+      bench_interact( sl, "T" );
+      bench_end( &ph, lines );
+
+      bench_begin( &ph, "mark" );
+      bench_interact( sl, "m7\\.txt$\n" );
+      bench_end( &ph, lines );
+
+      bench_begin( &ph, "find" );
+      bench_interact( sl, "f5\\.txt$\njjjjjjjjjj\n" );
+      bench_end( &ph, lines );
+
+      bench_begin( &ph, "page" );
+      bench_interact( sl, pages );
+      bench_end( &ph, lines );
+
+      bench_begin( &ph, "end" );
+      bench_interact( sl, "e" );
+      bench_end( &ph, lines );
+
+      bench_begin( &ph, "commands" );
+      bench_commands( sl );
+      bench_end( &ph, lines );
+
+      sl = select_lines_rem( sl );
     }
 
-  /* Close files. */
-  if ( no_exec_fh && no_exec_fh != stdout )
-    fclose( no_exec_fh );
+  mc_free( pages );
 
   take_exit( EXIT_SUCCESS );
 }
+
+#endif /* TAKE_BENCH */
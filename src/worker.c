@@ -0,0 +1,387 @@
+/**
+ * @file worker.c
+ *
+ * Worker pool for data parallel tasks. Tasks are indexed and workers
+ * pick the next free task until all are done. The calling thread is
+ * one of the workers, or with worker_run_poll() it polls for progress
+ * and cancellation while the workers run in background.
+ *
+ */
+
+
+#include "config.h"
+
+#include "mc.h"
+#include "global.h"
+#include "worker.h"
+#include "stats.h"
+
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+
+#ifdef HAVE_PTHREAD
+# include <pthread.h>
+# include <time.h>
+#endif
+
+
+/** Task queue shared by workers. */
+typedef struct worker_queue_s {
+  worker_func_t func;      /**< Task function. */
+  void* context;           /**< Task function context. */
+  int tasks;               /**< Task count. */
+  int next;                /**< Next free task. */
+  int done;                /**< Completed task count. */
+  int active;              /**< Running worker count. */
+#ifdef HAVE_PTHREAD
+  pthread_mutex_t lock;    /**< Lock for queue state. */
+  pthread_cond_t idle;     /**< Signaled when worker exits. */
+#endif
+} worker_queue_t;
+
+
+/** Worker thread argument. */
+typedef struct worker_arg_s {
+  worker_queue_t* queue;   /**< Shared queue. */
+  int worker;              /**< Worker index. */
+} worker_arg_t;
+
+
+/**
+ * Take next free task from queue.
+ *
+ * @param queue Task queue.
+ *
+ * @return Task index (or -1 if all tasks are taken).
+ */
+static int worker_next_task( worker_queue_t* queue )
+{
+  int task;
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock( &queue->lock );
+#endif
+
+  if ( queue->next < queue->tasks )
+    task = queue->next++;
+  else
+    task = -1;
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock( &queue->lock );
+#endif
+
+  return task;
+}
+
+
+/**
+ * Record completed task.
+ *
+ * @param queue Task queue.
+ */
+static void worker_task_done( worker_queue_t* queue )
+{
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock( &queue->lock );
+#endif
+
+  queue->done++;
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock( &queue->lock );
+#endif
+}
+
+
+/**
+ * Cancel the tasks that are not taken yet. Running tasks are
+ * completed.
+ *
+ * @param queue Task queue.
+ */
+static void worker_cancel( worker_queue_t* queue )
+{
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock( &queue->lock );
+#endif
+
+  queue->next = queue->tasks;
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock( &queue->lock );
+#endif
+}
+
+
+/**
+ * Worker main loop, i.e. execute tasks until queue is empty.
+ *
+ * @param data Worker argument.
+ *
+ * @return NULL.
+ */
+static void* worker_main( void* data )
+{
+  worker_arg_t* arg = data;
+  int task;
+
+  while ( ( task = worker_next_task( arg->queue ) ) >= 0 )
+    {
+      arg->queue->func( arg->queue->context, arg->worker, task );
+      worker_task_done( arg->queue );
+    }
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock( &arg->queue->lock );
+  arg->queue->active--;
+  pthread_cond_signal( &arg->queue->idle );
+  pthread_mutex_unlock( &arg->queue->lock );
+#endif
+
+  return NULL;
+}
+
+
+/**
+ * Return number of workers for tasks, i.e. number of online CPUs
+ * limited by task count.
+ *
+ * @param tasks Task count.
+ *
+ * @return Worker count (at least 1).
+ */
+int worker_count( int tasks ) /*acfd*/
+{
+  int cnt = 1;
+
+#if defined(HAVE_PTHREAD) && defined(_SC_NPROCESSORS_ONLN)
+  cnt = (int) sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+
+  if ( cnt > WORKER_MAX )
+    cnt = WORKER_MAX;
+
+  if ( cnt > tasks )
+    cnt = tasks;
+
+  if ( cnt < 1 )
+    cnt = 1;
+
+  return cnt;
+}
+
+
+/**
+ * Execute tasks with workers and wait for all tasks to complete. If
+ * thread creation fails, the remaining workers do all tasks.
+ *
+ * @param workers Worker count (see worker_count()).
+ * @param tasks Task count.
+ * @param func Task function.
+ * @param context Task function context.
+ */
+void worker_run( int workers, int tasks, worker_func_t func, void* context ) /*acfd*/
+{
+  worker_queue_t queue;
+  worker_arg_t arg[ WORKER_MAX ];
+
+  queue.func = func;
+  queue.context = context;
+  queue.tasks = tasks;
+  queue.next = 0;
+  queue.done = 0;
+  queue.active = 0;
+
+  if ( workers > WORKER_MAX )
+    workers = WORKER_MAX;
+
+  for ( int i = 0; i < workers; i++ )
+    {
+      arg[ i ].queue = &queue;
+      arg[ i ].worker = i;
+    }
+
+#ifdef HAVE_PTHREAD
+
+  pthread_t thread[ WORKER_MAX ];
+  int started = 1;
+
+  pthread_mutex_init( &queue.lock, NULL );
+  pthread_cond_init( &queue.idle, NULL );
+
+  /* Worker 0 is the calling thread. */
+  queue.active = 1;
+  for ( ; started < workers; started++ )
+    {
+      pthread_mutex_lock( &queue.lock );
+      queue.active++;
+      pthread_mutex_unlock( &queue.lock );
+
+      if ( pthread_create( &thread[ started ], NULL,
+                           worker_main, &arg[ started ] ) != 0 )
+        {
+          pthread_mutex_lock( &queue.lock );
+          queue.active--;
+          pthread_mutex_unlock( &queue.lock );
+          break;
+        }
+    }
+
+  worker_main( &arg[ 0 ] );
+
+  for ( int i = 1; i < started; i++ )
+    pthread_join( thread[ i ], NULL );
+
+  pthread_cond_destroy( &queue.idle );
+  pthread_mutex_destroy( &queue.lock );
+
+#else
+
+  worker_main( &arg[ 0 ] );
+
+#endif
+}
+
+
+#ifdef HAVE_PTHREAD
+
+/**
+ * Wait until all workers have exited or poll interval has elapsed.
+ *
+ * @param [in] queue Task queue.
+ * @param [out] done Completed task count.
+ *
+ * @return True if all workers have exited.
+ */
+static bool_t worker_wait( worker_queue_t* queue, int* done )
+{
+  struct timespec until;
+  bool_t idle;
+
+  clock_gettime( CLOCK_REALTIME, &until );
+  until.tv_nsec += WORKER_POLL_INTERVAL * 1000000L;
+  if ( until.tv_nsec >= 1000000000L )
+    {
+      until.tv_sec++;
+      until.tv_nsec -= 1000000000L;
+    }
+
+  pthread_mutex_lock( &queue->lock );
+  while ( queue->active > 0 )
+    {
+      if ( pthread_cond_timedwait( &queue->idle, &queue->lock, &until ) != 0 )
+        break;
+    }
+  idle = ( queue->active == 0 );
+  *done = queue->done;
+  pthread_mutex_unlock( &queue->lock );
+
+  return idle;
+}
+
+#endif
+
+
+/**
+ * Execute tasks with background workers, while the calling thread
+ * calls poll periodically (see WORKER_POLL_INTERVAL). If poll returns
+ * false, the tasks that are not started yet are skipped, and the
+ * running tasks are waited to complete. If thread creation fails,
+ * the calling thread executes the tasks and polls between tasks.
+ *
+ * @param workers Worker count (see worker_count()).
+ * @param tasks Task count.
+ * @param func Task function.
+ * @param context Task function context.
+ * @param poll Poll function.
+ * @param poll_context Poll function context.
+ *
+ * @return True if all tasks were completed (i.e. not cancelled).
+ */
+bool_t worker_run_poll( int workers, int tasks, worker_func_t func, void* context,
+                        worker_poll_func_t poll, void* poll_context ) /*acfd*/
+{
+  worker_queue_t queue;
+  int task;
+  int64_t polled;
+
+  queue.func = func;
+  queue.context = context;
+  queue.tasks = tasks;
+  queue.next = 0;
+  queue.done = 0;
+  queue.active = 0;
+
+#ifdef HAVE_PTHREAD
+
+  worker_arg_t arg[ WORKER_MAX ];
+  pthread_t thread[ WORKER_MAX ];
+  int started = 0;
+  int done;
+
+  if ( workers > WORKER_MAX )
+    workers = WORKER_MAX;
+
+  for ( int i = 0; i < workers; i++ )
+    {
+      arg[ i ].queue = &queue;
+      arg[ i ].worker = i;
+    }
+
+  pthread_mutex_init( &queue.lock, NULL );
+  pthread_cond_init( &queue.idle, NULL );
+
+  for ( ; started < workers; started++ )
+    {
+      pthread_mutex_lock( &queue.lock );
+      queue.active++;
+      pthread_mutex_unlock( &queue.lock );
+
+      if ( pthread_create( &thread[ started ], NULL,
+                           worker_main, &arg[ started ] ) != 0 )
+        {
+          pthread_mutex_lock( &queue.lock );
+          queue.active--;
+          pthread_mutex_unlock( &queue.lock );
+          break;
+        }
+    }
+
+  if ( started > 0 )
+    {
+      while ( !worker_wait( &queue, &done ) )
+        {
+          if ( !poll( poll_context, done, tasks ) )
+            worker_cancel( &queue );
+        }
+
+      for ( int i = 0; i < started; i++ )
+        pthread_join( thread[ i ], NULL );
+    }
+
+#endif
+
+  /* Without background workers the tasks are run here. */
+  polled = stats_now();
+  while ( ( task = worker_next_task( &queue ) ) >= 0 )
+    {
+      func( context, 0, task );
+      queue.done++;
+
+      if ( stats_now() - polled >= WORKER_POLL_INTERVAL * 1000000LL )
+        {
+          if ( !poll( poll_context, queue.done, tasks ) )
+            worker_cancel( &queue );
+          polled = stats_now();
+        }
+    }
+
+#ifdef HAVE_PTHREAD
+  pthread_cond_destroy( &queue.idle );
+  pthread_mutex_destroy( &queue.lock );
+#endif
+
+  return ( queue.done == tasks );
+}
@@ -0,0 +1,47 @@
+#ifndef WORKER_H
+#define WORKER_H
+
+/**
+ * @file worker.h
+ *
+ * Worker pool defs.
+ */
+
+
+/** Maximum number of worker threads. */
+#define WORKER_MAX 64
+
+/** Poll interval (ms) for background tasks (see worker_run_poll()). */
+#define WORKER_POLL_INTERVAL 50
+
+
+/**
+ * Task function for worker.
+ *
+ * @param context User context.
+ * @param worker Worker index (0..workers-1).
+ * @param task Task index (0..tasks-1).
+ */
+typedef void (*worker_func_t)( void* context, int worker, int task );
+
+
+/**
+ * Poll function for background tasks, i.e. progress report and
+ * cancellation check.
+ *
+ * @param context User context.
+ * @param done Completed task count.
+ * @param tasks Task count.
+ *
+ * @return False to cancel the remaining tasks.
+ */
+typedef bool_t (*worker_poll_func_t)( void* context, int done, int tasks );
+
+
+/* autoc:c_func_decl:begin */
+int worker_count( int tasks );
+void worker_run( int workers, int tasks, worker_func_t func, void* context );
+bool_t worker_run_poll( int workers, int tasks, worker_func_t func, void* context, worker_poll_func_t poll, void* poll_context );
+/* autoc:c_func_decl:end */
+
+#endif